@@ -0,0 +1,147 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.hpp"
+
+#include <json/writer.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+namespace atmos {
+namespace benchmarks {
+
+void
+BenchmarkRegistry::add(const std::string& name, const Setup& setup)
+{
+  m_benchmarks.push_back(std::make_pair(name, setup));
+}
+
+std::vector<std::string>
+BenchmarkRegistry::getNames() const
+{
+  std::vector<std::string> names;
+  for (const auto& benchmark : m_benchmarks) {
+    names.push_back(benchmark.first);
+  }
+  return names;
+}
+
+size_t
+BenchmarkRegistry::run(const std::string& filter, std::chrono::nanoseconds minTime) const
+{
+  Json::FastWriter fastWriter;
+  size_t nRun = 0;
+  for (const auto& benchmark : m_benchmarks) {
+    if (benchmark.first.find(filter) == std::string::npos) {
+      continue;
+    }
+    // FastWriter ends the object with a newline, which makes the output JSON Lines
+    std::cout << fastWriter.write(runOne(benchmark.first, benchmark.second, minTime))
+              << std::flush;
+    ++nRun;
+  }
+  return nRun;
+}
+
+Json::Value
+BenchmarkRegistry::runOne(const std::string& name, const Setup& setup,
+                          std::chrono::nanoseconds minTime)
+{
+  typedef std::chrono::steady_clock Clock;
+  Loop loop = setup();
+
+  // warms up the caches and finds a batch that takes long enough to time
+  const std::chrono::nanoseconds minBatchTime = minTime / 10;
+  uint64_t batchSize = 1;
+  while (true) {
+    const Clock::time_point startTime = Clock::now();
+    loop(batchSize);
+    if (Clock::now() - startTime >= minBatchTime || batchSize >= (uint64_t(1) << 40)) {
+      break;
+    }
+    batchSize *= 2;
+  }
+
+  std::vector<double> nsPerOp;
+  std::chrono::nanoseconds totalTime(0);
+  uint64_t nBytes = 0;
+  while (totalTime < minTime || nsPerOp.size() < 5) {
+    const Clock::time_point startTime = Clock::now();
+    nBytes += loop(batchSize);
+    const std::chrono::nanoseconds batchTime
+      = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime);
+    totalTime += batchTime;
+    nsPerOp.push_back(static_cast<double>(batchTime.count()) / batchSize);
+  }
+  std::sort(nsPerOp.begin(), nsPerOp.end());
+
+  const uint64_t nIterations = batchSize * nsPerOp.size();
+  Json::Value result;
+  result["name"] = name;
+  result["iterations"] = Json::Value::UInt64(nIterations);
+  result["batches"] = Json::Value::UInt64(nsPerOp.size());
+  result["nsPerOp"] = static_cast<double>(totalTime.count()) / nIterations;
+  result["minNsPerOp"] = nsPerOp.front();
+  result["p50NsPerOp"] = nsPerOp[nsPerOp.size() / 2];
+  result["p90NsPerOp"] = nsPerOp[nsPerOp.size() * 9 / 10];
+  result["bytesPerSecond"] = nBytes * 1e9 / totalTime.count();
+  return result;
+}
+
+std::vector<std::string>
+makeCmip5Names(size_t nNames, bool sorted, uint32_t seed)
+{
+  static const std::vector<std::string> products = {"output1", "output2"};
+  static const std::vector<std::string> models = {
+    "MOHC/HadCM3", "MOHC/HadGEM2-ES", "NCAR/CCSM4", "NASA-GISS/GISS-E2-R", "IPSL/IPSL-CM5A-LR",
+    "MPI-M/MPI-ESM-LR", "CNRM-CERFACS/CNRM-CM5", "NOAA-GFDL/GFDL-CM3"
+  };
+  static const std::vector<std::string> experiments = {
+    "historical", "rcp26", "rcp45", "rcp85", "piControl", "amip", "decadal1990", "abrupt4xCO2"
+  };
+  static const std::vector<std::string> frequencies = {"mon", "day", "6hr", "3hr", "fx"};
+  static const std::vector<std::string> realms = {"atmos", "ocean", "land", "seaIce", "aerosol"};
+  static const std::vector<std::string> tables = {"Amon", "Omon", "Lmon", "day", "6hrLev"};
+  static const std::vector<std::string> variables = {
+    "tas", "tasmax", "tasmin", "pr", "psl", "ua", "va", "hus", "tos", "sic", "mrso", "clt"
+  };
+
+  std::mt19937 random(seed);
+  auto pick = [&random] (const std::vector<std::string>& values) -> const std::string& {
+    return values[random() % values.size()];
+  };
+  std::vector<std::string> names;
+  names.reserve(nNames);
+  for (size_t i = 0; i < nNames; ++i) {
+    const std::string ensemble = "r" + std::to_string(random() % 10 + 1) +
+                                 "i" + std::to_string(random() % 3 + 1) +
+                                 "p" + std::to_string(random() % 3 + 1);
+    names.push_back("/CMIP5/" + pick(products) + "/" + pick(models) + "/" + pick(experiments) +
+                    "/" + pick(frequencies) + "/" + pick(realms) + "/" + pick(tables) + "/" +
+                    ensemble + "/" + pick(variables) + "/v" + std::to_string(20110000 + i));
+  }
+  if (sorted) {
+    std::sort(names.begin(), names.end());
+  }
+  return names;
+}
+
+} // namespace benchmarks
+} // namespace atmos
@@ -0,0 +1,118 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_BENCHMARKS_BENCHMARK_HPP
+#define ATMOS_BENCHMARKS_BENCHMARK_HPP
+
+#include <json/value.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace atmos {
+namespace benchmarks {
+
+/**
+ * Runs the timed loop of a benchmark nIterations times, and returns the bytes it has processed,
+ * or 0 if bytes do not matter to it
+ */
+typedef std::function<uint64_t(uint64_t nIterations)> Loop;
+
+/**
+ * Makes what a benchmark works on, outside of the timing, and returns its loop
+ */
+typedef std::function<Loop()> Setup;
+
+/**
+ * BenchmarkRegistry runs benchmarks in batches of iterations, and reports the time per
+ * iteration of each as one JSON object per line, e.g.
+ * {"batches":16,"bytesPerSecond":0.0,"iterations":2097152,"minNsPerOp":431.2,
+ *  "name":"json2Sql/4-conditions","nsPerOp":455.1,"p50NsPerOp":449.8,"p90NsPerOp":482.0}
+ *
+ * The batch size doubles until a batch takes at least a tenth of the minimum time, and
+ * batches run until the minimum time is spent, so the percentiles are over batches rather
+ * than single iterations and include no clock overhead.
+ */
+class BenchmarkRegistry {
+public:
+  void
+  add(const std::string& name, const Setup& setup);
+
+  /**
+   * @return names of the benchmarks, in the order they were added
+   */
+  std::vector<std::string>
+  getNames() const;
+
+  /**
+   * Helper function that runs the benchmarks whose name contains the filter, and writes their
+   * results to std::cout as they finish
+   *
+   * @param filter:  substring of the names to run, empty for all
+   * @param minTime: time each benchmark runs for, at least
+   * @return number of benchmarks that have run
+   */
+  size_t
+  run(const std::string& filter, std::chrono::nanoseconds minTime) const;
+
+  /**
+   * Helper function that times one benchmark
+   *
+   * @return the JSON object reported for it
+   */
+  static Json::Value
+  runOne(const std::string& name, const Setup& setup, std::chrono::nanoseconds minTime);
+
+private:
+  std::vector<std::pair<std::string, Setup>> m_benchmarks;
+};
+
+/**
+ * Helper function that makes names of CMIP5 datasets, in the layout the catalog publishes, e.g.
+ * /CMIP5/output1/MOHC/HadCM3/decadal1990/day/atmos/day/r3i2p1/tasmax. The same seed makes the
+ * same names.
+ *
+ * @param nNames: number of names
+ * @param sorted: whether the names are in name order, like the results of a query
+ */
+std::vector<std::string>
+makeCmip5Names(size_t nNames, bool sorted = true, uint32_t seed = 1);
+
+/**
+ * Helper function that keeps the compiler from optimizing away a computed value
+ */
+template<typename T>
+inline void
+doNotOptimize(const T& value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+void
+registerQueryBenchmarks(BenchmarkRegistry& registry);
+
+void
+registerSegmentBenchmarks(BenchmarkRegistry& registry);
+
+} // namespace benchmarks
+} // namespace atmos
+
+#endif // ATMOS_BENCHMARKS_BENCHMARK_HPP
@@ -0,0 +1,92 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <getopt.h>
+
+void
+usage()
+{
+  std::cout << "\n Usage:\n atmos-benchmarks "
+    "[-h] [-l] [-f filter] [-t milliseconds]\n"
+    "   [-f filter]         - only run the benchmarks whose name contains filter\n"
+    "   [-t milliseconds]   - time each benchmark runs for, at least (default 1000)\n"
+    "   [-l]                - list the benchmarks and exit\n"
+    "   [-h]                - print help and exit\n"
+    "\n"
+    " Results are written as one JSON object per benchmark and line.\n"
+    "\n";
+}
+
+int
+main(int argc, char** argv)
+{
+  int option;
+  std::string filter;
+  long minTime = 1000;
+  bool isListing = false;
+
+  while ((option = getopt(argc, argv, "f:t:lh")) != -1) {
+    switch (option) {
+      case 'f':
+        filter.assign(optarg);
+        break;
+      case 't':
+        minTime = std::atol(optarg);
+        if (minTime <= 0) {
+          usage();
+          return 1;
+        }
+        break;
+      case 'l':
+        isListing = true;
+        break;
+      case 'h':
+      default:
+        usage();
+        return 0;
+    }
+  }
+
+  argc -= optind;
+  argv += optind;
+  if (argc != 0) {
+    usage();
+    return 1;
+  }
+
+  atmos::benchmarks::BenchmarkRegistry registry;
+  atmos::benchmarks::registerQueryBenchmarks(registry);
+  atmos::benchmarks::registerSegmentBenchmarks(registry);
+
+  if (isListing) {
+    for (const auto& name : registry.getNames()) {
+      std::cout << name << std::endl;
+    }
+    return 0;
+  }
+
+  if (registry.run(filter, std::chrono::milliseconds(minTime)) == 0) {
+    std::cerr << "no benchmark matches \"" << filter << "\"" << std::endl;
+    return 1;
+  }
+  return 0;
+}
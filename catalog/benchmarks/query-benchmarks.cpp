@@ -0,0 +1,248 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.hpp"
+
+#include "query/query-adapter.hpp"
+#include "query/query-key.hpp"
+#include "util/config-file.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <boost/property_tree/info_parser.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <json/reader.h>
+
+#include <sstream>
+
+namespace atmos {
+namespace benchmarks {
+
+// Identity the signing benchmarks create, with an RSA and an ECDSA key, and delete again
+static const ndn::Name SIGNING_ID("/atmos/benchmarks/signer");
+
+/**
+ * QueryAdapter without a database, whose helpers of the query path can be called directly
+ */
+class BenchmarkAdapter : public query::QueryAdapter<std::string> {
+public:
+  BenchmarkAdapter(const std::shared_ptr<ndn::Face>& face,
+                   const std::shared_ptr<ndn::KeyChain>& keyChain)
+    : query::QueryAdapter<std::string>(face, keyChain)
+  {
+  }
+
+  void
+  configure(const std::string& config)
+  {
+    util::ConfigSection section;
+    std::stringstream ss(config);
+    boost::property_tree::read_info(ss, section);
+    onConfig(section, false, "benchmark", ndn::Name("/atmos/benchmarks"));
+  }
+
+  using query::QueryAdapter<std::string>::json2Sql;
+  using query::QueryAdapter<std::string>::makeReplyData;
+  using query::QueryAdapter<std::string>::signData;
+  using query::QueryAdapter<std::string>::getPayloadLimit;
+};
+
+/**
+ * Adapter on a face that sends nowhere, which signs with the given algorithm, if any
+ */
+class AdapterFixture : boost::noncopyable {
+public:
+  explicit
+  AdapterFixture(const std::string& signingAlgorithm = "")
+    : face(ndn::util::makeDummyClientFace(io))
+    , keyChain(std::make_shared<ndn::KeyChain>())
+    , adapter(face, keyChain)
+    , hasIdentity(!signingAlgorithm.empty())
+  {
+    if (hasIdentity) {
+      // the identity's default key is RSA, and the adapter picks the key of the algorithm
+      keyChain->createIdentity(SIGNING_ID);
+      const ndn::Name keyName = keyChain->generateEcdsaKeyPair(SIGNING_ID);
+      keyChain->addCertificateAsKeyDefault(*keyChain->selfSign(keyName));
+      adapter.configure("signingId " + SIGNING_ID.toUri() + "\n"
+                        "signingAlgorithm " + signingAlgorithm);
+    }
+    else {
+      adapter.configure("");
+    }
+  }
+
+  ~AdapterFixture()
+  {
+    if (hasIdentity) {
+      keyChain->deleteIdentity(SIGNING_ID);
+    }
+  }
+
+public:
+  boost::asio::io_service io;
+  std::shared_ptr<ndn::util::DummyClientFace> face;
+  std::shared_ptr<ndn::KeyChain> keyChain;
+  BenchmarkAdapter adapter;
+  const bool hasIdentity;
+};
+
+/**
+ * Helper function that makes a segment of query results with a full payload
+ */
+static std::shared_ptr<ndn::Data>
+makeSegment(size_t payloadSize)
+{
+  std::shared_ptr<ndn::Data> data
+    = std::make_shared<ndn::Data>(ndn::Name("/atmos/benchmarks/query-results")
+                                    .appendVersion(1).appendSegment(0));
+  const std::string payload(payloadSize, 'x');
+  data->setContent(reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+  data->setFreshnessPeriod(query::RESULT_FRESHNESS_PERIOD);
+  return data;
+}
+
+static Setup
+json2SqlBenchmark(const std::string& jsonQuery)
+{
+  return [jsonQuery] () -> Loop {
+    std::shared_ptr<AdapterFixture> fixture = std::make_shared<AdapterFixture>();
+    Json::Value query;
+    Json::Reader().parse(jsonQuery, query);
+    return [fixture, query] (uint64_t nIterations) -> uint64_t {
+      for (uint64_t i = 0; i < nIterations; ++i) {
+        Json::Value json = query;
+        std::stringstream sqlQuery;
+        std::vector<std::string> sqlValues;
+        bool autocomplete = false;
+        fixture->adapter.json2Sql(sqlQuery, sqlValues, json, autocomplete);
+        doNotOptimize(sqlQuery);
+      }
+      return 0;
+    };
+  };
+}
+
+static Setup
+queryKeyBenchmark(const std::string& jsonQuery)
+{
+  return [jsonQuery] () -> Loop {
+    return [jsonQuery] (uint64_t nIterations) -> uint64_t {
+      // what runJsonQuery does with the JSON of the Interest before the dedup lookup
+      for (uint64_t i = 0; i < nIterations; ++i) {
+        Json::Value query;
+        Json::Reader reader;
+        reader.parse(jsonQuery, query);
+        query::QueryKey key(query);
+        doNotOptimize(key);
+      }
+      return nIterations * jsonQuery.size();
+    };
+  };
+}
+
+static Setup
+signDataBenchmark(const std::string& signingAlgorithm)
+{
+  return [signingAlgorithm] () -> Loop {
+    // digests need no key, but the segments are sized for the signing identity
+    const bool isDigest = signingAlgorithm == "digest";
+    std::shared_ptr<AdapterFixture> fixture
+      = std::make_shared<AdapterFixture>(isDigest ? "rsa" : signingAlgorithm);
+    std::shared_ptr<ndn::Data> data = makeSegment(fixture->adapter.getPayloadLimit());
+    return [fixture, data, isDigest] (uint64_t nIterations) -> uint64_t {
+      for (uint64_t i = 0; i < nIterations; ++i) {
+        if (isDigest) {
+          fixture->keyChain->signWithSha256(*data);
+        }
+        else {
+          fixture->adapter.signData(*data);
+        }
+      }
+      return nIterations * data->getContent().value_size();
+    };
+  };
+}
+
+static Setup
+makeReplyDataBenchmark(const std::string& signingAlgorithm, const query::ResultFormat& format)
+{
+  return [signingAlgorithm, format] () -> Loop {
+    const bool isDigest = signingAlgorithm == "digest";
+    std::shared_ptr<AdapterFixture> fixture
+      = std::make_shared<AdapterFixture>(isDigest ? "rsa" : signingAlgorithm);
+    std::shared_ptr<std::vector<std::string>> names
+      = std::make_shared<std::vector<std::string>>(makeCmip5Names(100000));
+    const size_t payloadLimit = fixture->adapter.getPayloadLimit();
+    std::shared_ptr<query::SegmentEncoder> encoder
+      = std::make_shared<query::SegmentEncoder>(false, payloadLimit, format);
+    std::shared_ptr<size_t> nextName = std::make_shared<size_t>(0);
+    const ndn::Name segmentPrefix = ndn::Name("/atmos/benchmarks/query-results").appendVersion(1);
+    return [=] (uint64_t nIterations) -> uint64_t {
+      // an iteration is one full segment, from its names to the signed Data, as publishResults
+      // makes them
+      uint64_t nBytes = 0;
+      for (uint64_t i = 0; i < nIterations; ++i) {
+        while (true) {
+          const std::string& name = (*names)[*nextName];
+          const size_t size = encoder->getAppendedSize(name);
+          if (!encoder->empty() && encoder->getPayloadSize() + size > payloadLimit) {
+            break;
+          }
+          encoder->append(name);
+          nBytes += name.size();
+          *nextName = (*nextName + 1) % names->size();
+        }
+        std::shared_ptr<ndn::Data> data = fixture->adapter.makeReplyData(segmentPrefix, *encoder,
+                                                                         i, false, isDigest);
+        doNotOptimize(data);
+      }
+      return nBytes;
+    };
+  };
+}
+
+void
+registerQueryBenchmarks(BenchmarkRegistry& registry)
+{
+  registry.add("json2Sql/1-condition", json2SqlBenchmark("{\"model\":\"CCSM4\"}"));
+  registry.add("json2Sql/4-conditions",
+               json2SqlBenchmark("{\"activity\":\"CMIP5\",\"model\":\"CCSM4\","
+                                 "\"experiment\":\"rcp45\",\"frequency\":\"mon\"}"));
+  registry.add("json2Sql/autocomplete", json2SqlBenchmark("{\"?\":\"/CMIP5/output1/NCAR/\"}"));
+
+  registry.add("queryKey/1-condition", queryKeyBenchmark("{\"model\":\"CCSM4\"}"));
+  registry.add("queryKey/4-conditions",
+               queryKeyBenchmark("{ \"frequency\" : \"mon\", \"experiment\" : \"rcp45\","
+                                 " \"model\" : \"CCSM4\", \"activity\" : \"CMIP5\" }"));
+
+  for (const std::string algorithm : {"rsa", "ecdsa", "digest"}) {
+    registry.add("signData/" + algorithm, signDataBenchmark(algorithm));
+  }
+
+  query::ResultFormat json;
+  query::ResultFormat tlv;
+  tlv.isBinary = true;
+  for (const std::string algorithm : {"rsa", "ecdsa", "digest"}) {
+    registry.add("makeReplyData/json/" + algorithm, makeReplyDataBenchmark(algorithm, json));
+  }
+  registry.add("makeReplyData/tlv/digest", makeReplyDataBenchmark("digest", tlv));
+}
+
+} // namespace benchmarks
+} // namespace atmos
@@ -0,0 +1,165 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.hpp"
+
+#include "query/query-adapter.hpp"
+#include "query/segment-encoder.hpp"
+#include "util/segment-cache.hpp"
+
+#include <ndn-cxx/security/key-chain.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace atmos {
+namespace benchmarks {
+
+// Segments a result of that many names packs into, with a typical payload limit
+static const size_t N_RESULT_NAMES = 10000;
+// A cache of 32 MB holds about 4600 full segments
+static const size_t CACHE_MAX_SIZE = 32 * 1024 * 1024;
+static const size_t N_CACHED_SEGMENTS = 4096;
+
+static Setup
+segmentEncoderBenchmark(const query::ResultFormat& format)
+{
+  return [format] () -> Loop {
+    std::shared_ptr<std::vector<std::string>> names
+      = std::make_shared<std::vector<std::string>>(makeCmip5Names(N_RESULT_NAMES));
+    return [names, format] (uint64_t nIterations) -> uint64_t {
+      // an iteration is a whole result, cut into segments like publishResults does
+      uint64_t nBytes = 0;
+      for (uint64_t i = 0; i < nIterations; ++i) {
+        query::SegmentEncoder encoder(false, query::PAYLOAD_LIMIT, format);
+        for (const auto& name : *names) {
+          const size_t size = encoder.getAppendedSize(name);
+          if (!encoder.empty() && encoder.getPayloadSize() + size > query::PAYLOAD_LIMIT) {
+            ndn::Block payload = encoder.finish();
+            doNotOptimize(payload);
+          }
+          encoder.append(name);
+          nBytes += name.size();
+        }
+        ndn::Block payload = encoder.finish();
+        doNotOptimize(payload);
+      }
+      return nBytes;
+    };
+  };
+}
+
+/**
+ * Helper function that makes signed query-results segments with full payloads, 16 per version
+ */
+static std::shared_ptr<std::vector<std::shared_ptr<ndn::Data>>>
+makeSegments(size_t nSegments)
+{
+  ndn::KeyChain keyChain;
+  std::shared_ptr<std::vector<std::shared_ptr<ndn::Data>>> segments
+    = std::make_shared<std::vector<std::shared_ptr<ndn::Data>>>();
+  const std::string payload(query::PAYLOAD_LIMIT, 'x');
+  for (size_t i = 0; i < nSegments; ++i) {
+    std::shared_ptr<ndn::Data> data
+      = std::make_shared<ndn::Data>(ndn::Name("/atmos/benchmarks/query-results")
+                                      .appendVersion(i / 16).appendSegment(i % 16));
+    data->setContent(reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+    data->setFreshnessPeriod(query::RESULT_FRESHNESS_PERIOD);
+    keyChain.signWithSha256(*data);
+    data->wireEncode();
+    segments->push_back(data);
+  }
+  return segments;
+}
+
+static Setup
+segmentCacheInsertBenchmark()
+{
+  return [] () -> Loop {
+    // twice what fits, so that inserts evict once the cache is full
+    std::shared_ptr<std::vector<std::shared_ptr<ndn::Data>>> segments
+      = makeSegments(2 * N_CACHED_SEGMENTS);
+    std::shared_ptr<util::SegmentCache> cache
+      = std::make_shared<util::SegmentCache>(CACHE_MAX_SIZE);
+    std::shared_ptr<size_t> nextSegment = std::make_shared<size_t>(0);
+    return [segments, cache, nextSegment] (uint64_t nIterations) -> uint64_t {
+      uint64_t nBytes = 0;
+      for (uint64_t i = 0; i < nIterations; ++i) {
+        const ndn::Data& data = *(*segments)[*nextSegment];
+        cache->insert(data);
+        nBytes += data.wireEncode().size();
+        *nextSegment = (*nextSegment + 1) % segments->size();
+      }
+      return nBytes;
+    };
+  };
+}
+
+static Setup
+segmentCacheFindBenchmark(bool isHit)
+{
+  return [isHit] () -> Loop {
+    std::shared_ptr<std::vector<std::shared_ptr<ndn::Data>>> segments
+      = makeSegments(N_CACHED_SEGMENTS);
+    std::shared_ptr<util::SegmentCache> cache
+      = std::make_shared<util::SegmentCache>(CACHE_MAX_SIZE);
+    for (const auto& data : *segments) {
+      cache->insert(*data);
+    }
+
+    // the names of the Interests, in random order so that lookups do not follow inserts
+    std::shared_ptr<std::vector<ndn::Name>> names = std::make_shared<std::vector<ndn::Name>>();
+    for (const auto& data : *segments) {
+      names->push_back(isHit ? data->getName()
+                             : ndn::Name(data->getName().getPrefix(-1)).appendSegment(16));
+    }
+    std::shuffle(names->begin(), names->end(), std::mt19937(1));
+    std::shared_ptr<size_t> nextName = std::make_shared<size_t>(0);
+    return [names, cache, nextName] (uint64_t nIterations) -> uint64_t {
+      for (uint64_t i = 0; i < nIterations; ++i) {
+        std::shared_ptr<const ndn::Data> data = cache->find((*names)[*nextName]);
+        doNotOptimize(data);
+        *nextName = (*nextName + 1) % names->size();
+      }
+      return 0;
+    };
+  };
+}
+
+void
+registerSegmentBenchmarks(BenchmarkRegistry& registry)
+{
+  query::ResultFormat json;
+  query::ResultFormat tlv;
+  tlv.isBinary = true;
+  query::ResultFormat jsonZlib;
+  jsonZlib.isCompressed = true;
+  query::ResultFormat tlvZlib = tlv;
+  tlvZlib.isCompressed = true;
+  registry.add("segmentEncoder/json/10000-names", segmentEncoderBenchmark(json));
+  registry.add("segmentEncoder/tlv/10000-names", segmentEncoderBenchmark(tlv));
+  registry.add("segmentEncoder/json-zlib/10000-names", segmentEncoderBenchmark(jsonZlib));
+  registry.add("segmentEncoder/tlv-zlib/10000-names", segmentEncoderBenchmark(tlvZlib));
+
+  registry.add("segmentCache/insert/7000-byte-segments", segmentCacheInsertBenchmark());
+  registry.add("segmentCache/find-hit/4096-segments", segmentCacheFindBenchmark(true));
+  registry.add("segmentCache/find-miss/4096-segments", segmentCacheFindBenchmark(false));
+}
+
+} // namespace benchmarks
+} // namespace atmos
@@ -64,10 +64,18 @@ main(int argc, char** argv)
   std::shared_ptr<ndn::Face> face(new ndn::Face());
   std::shared_ptr<ndn::KeyChain> keyChain(new ndn::KeyChain());
 
-  std::unique_ptr<atmos::util::CatalogAdapter>
-    queryAdapter(new atmos::query::QueryAdapter<MYSQL>(face, keyChain));
-  std::unique_ptr<atmos::util::CatalogAdapter>
-    publishAdapter(new atmos::publish::PublishAdapter<MYSQL>(face, keyChain));
+  // publications keep the facets that queries are answered from up to date
+  std::shared_ptr<atmos::util::FacetIndex> facetIndex(
+    new atmos::util::FacetIndex(std::vector<std::string>(std::begin(atmos::query::FACET_COLUMNS),
+                                                         std::end(atmos::query::FACET_COLUMNS))));
+  atmos::query::QueryAdapter<MYSQL>* mysqlQueryAdapter
+    = new atmos::query::QueryAdapter<MYSQL>(face, keyChain);
+  mysqlQueryAdapter->setFacetIndex(facetIndex);
+  std::unique_ptr<atmos::util::CatalogAdapter> queryAdapter(mysqlQueryAdapter);
+  atmos::publish::PublishAdapter<MYSQL>* mysqlPublishAdapter
+    = new atmos::publish::PublishAdapter<MYSQL>(face, keyChain);
+  mysqlPublishAdapter->setFacetIndex(facetIndex);
+  std::unique_ptr<atmos::util::CatalogAdapter> publishAdapter(mysqlPublishAdapter);
 
   atmos::catalog::Catalog catalogInstance(face, keyChain, configFile);
   catalogInstance.addAdapter(queryAdapter);
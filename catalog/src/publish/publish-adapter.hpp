@@ -20,6 +20,7 @@
 #define ATMOS_PUBLISH_PUBLISH_ADAPTER_HPP
 
 #include "util/catalog-adapter.hpp"
+#include "util/facet-index.hpp"
 #include "util/mysql-util.hpp"
 #include <mysql/mysql.h>
 
@@ -68,6 +69,12 @@ public:
   setConfigFile(util::ConfigFile& config,
                 const ndn::Name& prefix);
 
+  /**
+   * Helper function that sets the facet index that publications are applied to
+   */
+  void
+  setFacetIndex(const std::shared_ptr<util::FacetIndex>& facetIndex);
+
 protected:
   /**
    * Helper function that configures piblishAdapter instance according to publish section
@@ -99,9 +106,15 @@ protected:
 
   /**
    * Helper function to set the DatabaseHandler
+   *
+   * @param databaseId:     database to connect to
+   * @param minConnections: number of connections that are kept open
+   * @param maxConnections: maximum number of connections open at the same time
    */
   void
-  setDatabaseHandler(const util::ConnectionDetails&  databaseId);
+  setDatabaseHandler(const util::ConnectionDetails&  databaseId,
+                     size_t minConnections,
+                     size_t maxConnections);
 
   /**
    * Helper function that sets filters to make the adapter work
@@ -119,13 +132,25 @@ protected:
   bool
   validatePublicationChanges(const std::shared_ptr<const ndn::Data>& data);
 
+  /**
+   * Helper function that applies the added and removed files of a publication to the facet
+   * index. The facets of added files are not part of the publication, so additions make the
+   * index stale until the query adapter loads it again, which it does on the next query.
+   *
+   * @param changes: parsed publication, with "add" and "remove" lists of names
+   */
+  void
+  updateFacetIndex(const Json::Value& changes);
+
 protected:
   typedef std::unordered_map<ndn::Name, const ndn::RegisteredPrefixId*> RegisteredPrefixList;
   // Prefix for ChronoSync
   ndn::Name m_syncPrefix;
-  // Handle to the Catalog's database
-  std::shared_ptr<DatabaseHandler> m_databaseHandler;
+  // Connections to the Catalog's database, for MySQL
+  std::shared_ptr<util::MySQLConnectionPool> m_databasePool;
   std::unique_ptr<ndn::ValidatorConfig> m_publishValidator;
+  // Facets the query adapter answers component queries from, if any
+  std::shared_ptr<util::FacetIndex> m_facetIndex;
   RegisteredPrefixList m_registeredPrefixList;
 };
 
@@ -171,6 +196,13 @@ PublishAdapter<DatabaseHandler>::setConfigFile(util::ConfigFile& config,
                                 _1, _2, _3, prefix));
 }
 
+template <typename DatabaseHandler>
+void
+PublishAdapter<DatabaseHandler>::setFacetIndex(const std::shared_ptr<util::FacetIndex>& facetIndex)
+{
+  m_facetIndex = facetIndex;
+}
+
 template <typename DatabaseHandler>
 void
 PublishAdapter<DatabaseHandler>::onConfig(const util::ConfigSection& section,
@@ -184,6 +216,8 @@ PublishAdapter<DatabaseHandler>::onConfig(const util::ConfigSection& section,
   }
 
   std::string signingId, dbServer, dbName, dbUser, dbPasswd;
+  size_t minConnections = util::DEFAULT_MIN_CONNECTIONS;
+  size_t maxConnections = util::DEFAULT_MAX_CONNECTIONS;
   std::string syncPrefix("ndn:/ndn-atmos/broadcast/chronosync");
 
   for (auto item = section.begin();
@@ -236,6 +270,16 @@ PublishAdapter<DatabaseHandler>::onConfig(const util::ConfigSection& section,
                                     " in \"publish\" section");
           }
         }
+        if (subItem->first == "minConnections") {
+          minConnections = subItem->second.get_value<size_t>(0);
+        }
+        if (subItem->first == "maxConnections") {
+          maxConnections = subItem->second.get_value<size_t>(0);
+          if (maxConnections == 0) {
+            throw Error("Invalid value for \"maxConnections\""
+                                    " in \"publish\" section");
+          }
+        }
       }
     }
     else if (item->first == "sync") {
@@ -262,24 +306,33 @@ PublishAdapter<DatabaseHandler>::onConfig(const util::ConfigSection& section,
   m_syncPrefix.append(syncPrefix);
   util::ConnectionDetails mysqlId(dbServer, dbUser, dbPasswd, dbName);
 
-  setDatabaseHandler(mysqlId);
+  if (minConnections > maxConnections) {
+    throw Error("\"minConnections\" exceeds \"maxConnections\""
+                " in \"publish\" section");
+  }
+
+  setDatabaseHandler(mysqlId, minConnections, maxConnections);
   setFilters();
 }
 
 template <typename DatabaseHandler>
 void
-PublishAdapter<DatabaseHandler>::setDatabaseHandler(const util::ConnectionDetails& databaseId)
+PublishAdapter<DatabaseHandler>::setDatabaseHandler(const util::ConnectionDetails& databaseId,
+                                                    size_t minConnections,
+                                                    size_t maxConnections)
 {
   //empty
 }
 
 template <>
 void
-PublishAdapter<MYSQL>::setDatabaseHandler(const util::ConnectionDetails& databaseId)
+PublishAdapter<MYSQL>::setDatabaseHandler(const util::ConnectionDetails& databaseId,
+                                          size_t minConnections,
+                                          size_t maxConnections)
 {
-  std::shared_ptr<MYSQL> conn = atmos::util::MySQLConnectionSetup(databaseId);
-
-  m_databaseHandler = conn;
+  m_databasePool = std::make_shared<util::MySQLConnectionPool>(databaseId,
+                                                               minConnections,
+                                                               maxConnections);
 }
 
 template <typename DatabaseHandler>
@@ -295,7 +348,8 @@ void
 PublishAdapter<DatabaseHandler>::onPublishedData(const ndn::Interest& interest,
                                                  const ndn::Data& data)
 {
-  // @todo handle data publication
+  // @todo handle data publication, and updateFacetIndex once the changes
+  // are in the database
 }
 
 template<typename DatabaseHandler>
@@ -332,6 +386,21 @@ PublishAdapter<DatabaseHandler>::validatePublicationChanges(const std::shared_pt
   return true;
 }
 
+template <typename DatabaseHandler>
+void
+PublishAdapter<DatabaseHandler>::updateFacetIndex(const Json::Value& changes)
+{
+  if (!m_facetIndex) {
+    return;
+  }
+  if (!changes["add"].empty()) {
+    m_facetIndex->invalidate();
+  }
+  for (const auto& name : changes["remove"]) {
+    m_facetIndex->erase(name.asString());
+  }
+}
+
 } // namespace publish
 } // namespace atmos
 #endif //ATMOS_PUBLISH_PUBLISH_ADAPTER_HPP
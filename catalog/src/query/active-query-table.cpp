@@ -0,0 +1,257 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/active-query-table.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace atmos {
+namespace query {
+
+ActiveQueryTable::ActiveQueryTable(size_t nShards,
+                                   size_t maxSize,
+                                   const ndn::time::milliseconds& lifetime,
+                                   const ndn::time::milliseconds& executionTimeout)
+  : m_maxShardSize(nShards > 0 ? maxSize / nShards : 0)
+  , m_lifetime(lifetime)
+  , m_executionTimeout(executionTimeout)
+{
+  if (nShards == 0) {
+    throw std::invalid_argument("ActiveQueryTable needs at least one shard");
+  }
+  m_shards.reserve(nShards);
+  for (size_t i = 0; i < nShards; ++i) {
+    m_shards.push_back(std::unique_ptr<Shard>(new Shard));
+    m_shards.back()->usedSize = 0;
+  }
+}
+
+ActiveQueryTable::Shard&
+ActiveQueryTable::getShard(const QueryKey& key)
+{
+  // the low bits pick the bucket within the shard, so the shard is picked by the high ones
+  return *m_shards[(key.getHash() >> 32) % m_shards.size()];
+}
+
+ActiveQueryTable::Entry*
+ActiveQueryTable::findEntry(Shard& shard, const QueryKey& key)
+{
+  auto iter = shard.index.find(key);
+  if (iter == shard.index.end()) {
+    return nullptr;
+  }
+  if (iter->second->expiry <= ndn::time::steady_clock::now()) {
+    // the results are stale, so the query has to run again
+    removeEntry(shard, iter->second);
+    return nullptr;
+  }
+  return &*iter->second;
+}
+
+void
+ActiveQueryTable::removeEntry(Shard& shard, EntryList::iterator entry)
+{
+  shard.usedSize -= entry->size;
+  shard.index.erase(entry->key);
+  if (entry->isReady) {
+    shard.ready.erase(entry);
+  }
+  else {
+    shard.pending.erase(entry);
+  }
+}
+
+std::shared_ptr<const ndn::Data>
+ActiveQueryTable::find(const QueryKey& key)
+{
+  Shard& shard = getShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Entry* entry = findEntry(shard, key);
+  return entry ? entry->ack : nullptr;
+}
+
+std::shared_ptr<const ndn::Data>
+ActiveQueryTable::join(const QueryKey& key, const std::shared_ptr<const ndn::Interest>& interest,
+                       bool& isWaiting)
+{
+  isWaiting = false;
+  Shard& shard = getShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Entry* entry = findEntry(shard, key);
+  if (!entry) {
+    return nullptr;
+  }
+  if (entry->isReady) {
+    return entry->ack;
+  }
+  const ndn::time::steady_clock::TimePoint now = ndn::time::steady_clock::now();
+  removeExpiredInterests(shard, *entry, now);
+
+  // the Interest is held until the query is ready, so it counts against the budget
+  ndn::time::milliseconds lifetime = interest->getInterestLifetime();
+  if (lifetime < ndn::time::milliseconds::zero()) {
+    lifetime = ndn::DEFAULT_INTEREST_LIFETIME;
+  }
+  WaitingInterest waiting = {interest, now + lifetime,
+                             interest->wireEncode().size() + sizeof(WaitingInterest)};
+  entry->size += waiting.size;
+  shard.usedSize += waiting.size;
+  entry->waitingInterests.push_back(waiting);
+  isWaiting = true;
+  return nullptr;
+}
+
+std::shared_ptr<const ndn::Data>
+ActiveQueryTable::insert(const QueryKey& key, const std::shared_ptr<const ndn::Data>& ack)
+{
+  Shard& shard = getShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  evict(shard, m_maxShardSize);
+
+  auto iter = shard.index.find(key);
+  if (iter != shard.index.end()) {
+    return iter->second->ack;
+  }
+
+  Entry entry = {key, ack, ndn::time::steady_clock::now() + m_executionTimeout,
+                 estimateSize(key, *ack), false, std::vector<WaitingInterest>()};
+  // make room for the new entry
+  evict(shard, m_maxShardSize > entry.size ? m_maxShardSize - entry.size : 0);
+  shard.usedSize += entry.size;
+  shard.pending.push_back(entry);
+  shard.index.insert(std::make_pair(key, std::prev(shard.pending.end())));
+  return nullptr;
+}
+
+ActiveQueryTable::InterestList
+ActiveQueryTable::markReady(const QueryKey& key, const std::shared_ptr<const ndn::Data>& ack)
+{
+  Shard& shard = getShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto iter = shard.index.find(key);
+  if (iter == shard.index.end() || iter->second->ack != ack) {
+    return InterestList();
+  }
+  Entry& entry = *iter->second;
+  if (entry.isReady) {
+    return InterestList();
+  }
+  // however long the query has run, its results are served for the whole lifetime from now
+  entry.isReady = true;
+  entry.expiry = ndn::time::steady_clock::now() + m_lifetime;
+  shard.ready.splice(shard.ready.end(), shard.pending, iter->second);
+  InterestList interests = takeWaitingInterests(entry);
+  const size_t size = estimateSize(entry.key, *entry.ack);
+  shard.usedSize -= entry.size - size;
+  entry.size = size;
+  return interests;
+}
+
+ActiveQueryTable::InterestList
+ActiveQueryTable::erase(const QueryKey& key, const std::shared_ptr<const ndn::Data>& ack)
+{
+  Shard& shard = getShard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto iter = shard.index.find(key);
+  if (iter == shard.index.end() || iter->second->ack != ack) {
+    return InterestList();
+  }
+  InterestList interests = takeWaitingInterests(*iter->second);
+  removeEntry(shard, iter->second);
+  return interests;
+}
+
+void
+ActiveQueryTable::removeExpiredInterests(Shard& shard, Entry& entry,
+                                         const ndn::time::steady_clock::TimePoint& now)
+{
+  auto isAlive = [&now] (const WaitingInterest& waiting) { return waiting.expiry > now; };
+  auto newEnd = std::stable_partition(entry.waitingInterests.begin(),
+                                      entry.waitingInterests.end(), isAlive);
+  for (auto waiting = newEnd; waiting != entry.waitingInterests.end(); ++waiting) {
+    entry.size -= waiting->size;
+    shard.usedSize -= waiting->size;
+  }
+  entry.waitingInterests.erase(newEnd, entry.waitingInterests.end());
+}
+
+ActiveQueryTable::InterestList
+ActiveQueryTable::takeWaitingInterests(Entry& entry)
+{
+  const ndn::time::steady_clock::TimePoint now = ndn::time::steady_clock::now();
+  InterestList interests;
+  for (const auto& waiting : entry.waitingInterests) {
+    if (waiting.expiry > now) {
+      interests.push_back(waiting.interest);
+    }
+  }
+  entry.waitingInterests.clear();
+  return interests;
+}
+
+void
+ActiveQueryTable::evict(Shard& shard, size_t maxSize)
+{
+  const ndn::time::steady_clock::TimePoint now = ndn::time::steady_clock::now();
+  for (EntryList* entries : {&shard.ready, &shard.pending}) {
+    while (!entries->empty() && entries->front().expiry <= now) {
+      removeEntry(shard, entries->begin());
+    }
+  }
+  // the results of ready queries are already being served, and can be asked for again
+  for (EntryList* entries : {&shard.ready, &shard.pending}) {
+    while (!entries->empty() && shard.usedSize > maxSize) {
+      removeEntry(shard, entries->begin());
+    }
+  }
+}
+
+size_t
+ActiveQueryTable::estimateSize(const QueryKey& key, const ndn::Data& ack)
+{
+  // the key is held by the entry and by the index, and keeps the canonical query in both
+  // string and parsed form
+  return 4 * key.toString().size() + ack.wireEncode().size() + 4 * sizeof(Entry);
+}
+
+size_t
+ActiveQueryTable::size()
+{
+  size_t nEntries = 0;
+  for (auto& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    nEntries += shard->pending.size() + shard->ready.size();
+  }
+  return nEntries;
+}
+
+size_t
+ActiveQueryTable::getMemoryUsage()
+{
+  size_t usedSize = 0;
+  for (auto& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    usedSize += shard->usedSize;
+  }
+  return usedSize;
+}
+
+} // namespace query
+} // namespace atmos
@@ -0,0 +1,225 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_QUERY_ACTIVE_QUERY_TABLE_HPP
+#define ATMOS_QUERY_ACTIVE_QUERY_TABLE_HPP
+
+#include "query/query-key.hpp"
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/interest.hpp>
+#include <ndn-cxx/util/time.hpp>
+
+#include <boost/noncopyable.hpp>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace atmos {
+namespace query {
+
+/**
+ * ActiveQueryTable remembers the ACK of each query whose results are being served, so that
+ * the same query is not run twice.
+ *
+ * A query is pending from its insertion until its results are ready. Interests for a pending
+ * query wait in its entry, and are answered with its ACK once it is marked ready, so that
+ * any number of them costs a single execution. If the execution fails, they are handed back
+ * to be answered with a NACK. Waiting Interests whose lifetime has passed are dropped, as
+ * their consumers no longer wait for an answer. Those of an entry that expires or is evicted
+ * are not answered, and their consumers ask again.
+ *
+ * Ready entries expire a fixed lifetime after their results are ready, which should match the
+ * freshness of the results. Pending entries expire once the query has run for longer than it
+ * may, in case its execution never finishes. The oldest ready entries, and then the oldest
+ * pending ones, are dropped when the table exceeds its memory budget. The table is split
+ * into shards by key hash, each with its own lock, so concurrent queries rarely wait on each
+ * other.
+ */
+class ActiveQueryTable : boost::noncopyable {
+public:
+  /**
+   * Constructor
+   *
+   * @param nShards:          number of shards, must be positive
+   * @param maxSize:          memory budget of the table in bytes, shared evenly by the shards
+   * @param lifetime:         how long an entry stays in the table once its query is ready
+   * @param executionTimeout: how long an entry stays in the table while its query is pending
+   */
+  ActiveQueryTable(size_t nShards, size_t maxSize, const ndn::time::milliseconds& lifetime,
+                   const ndn::time::milliseconds& executionTimeout);
+
+  typedef std::vector<std::shared_ptr<const ndn::Interest>> InterestList;
+
+  /**
+   * @return the ACK of an active query, pending or ready, or nullptr if the query is not active
+   */
+  std::shared_ptr<const ndn::Data>
+  find(const QueryKey& key);
+
+  /**
+   * Helper function that looks up a query for an Interest that asks for it. If the query is
+   * pending, the Interest waits for it.
+   *
+   * @param key:       canonical query
+   * @param interest:  Interest that asks for the query
+   * @param isWaiting: set to whether the Interest now waits for the query
+   * @return the ACK of a ready query, or nullptr
+   */
+  std::shared_ptr<const ndn::Data>
+  join(const QueryKey& key, const std::shared_ptr<const ndn::Interest>& interest,
+       bool& isWaiting);
+
+  /**
+   * Helper function that makes a pending query active, unless it is already
+   *
+   * @param key: canonical query
+   * @param ack: ACK data of the query
+   * @return nullptr if the query has been inserted, otherwise the ACK of the active query
+   */
+  std::shared_ptr<const ndn::Data>
+  insert(const QueryKey& key, const std::shared_ptr<const ndn::Data>& ack);
+
+  /**
+   * Helper function that marks the results of a pending query ready
+   *
+   * @param key: canonical query
+   * @param ack: ACK the query has been inserted with, so that an entry inserted since by
+   *             another execution is left alone
+   * @return Interests that are still waiting for the query, to be answered with its ACK
+   */
+  InterestList
+  markReady(const QueryKey& key, const std::shared_ptr<const ndn::Data>& ack);
+
+  /**
+   * Helper function that removes a query whose execution has failed, so that it runs again
+   * when it is next asked for
+   *
+   * @param key: canonical query
+   * @param ack: ACK the query has been inserted with
+   * @return Interests that are still waiting for the query, to be answered with a NACK
+   */
+  InterestList
+  erase(const QueryKey& key, const std::shared_ptr<const ndn::Data>& ack);
+
+  /**
+   * @return number of entries, including those that have expired but are not removed yet
+   */
+  size_t
+  size();
+
+  /**
+   * @return estimated memory used by the entries in bytes
+   */
+  size_t
+  getMemoryUsage();
+
+  size_t
+  getNShards() const
+  {
+    return m_shards.size();
+  }
+
+private:
+  struct WaitingInterest {
+    std::shared_ptr<const ndn::Interest> interest;
+    // when the consumer stops waiting for an answer
+    ndn::time::steady_clock::TimePoint expiry;
+    size_t size;
+  };
+
+  struct Entry {
+    QueryKey key;
+    std::shared_ptr<const ndn::Data> ack;
+    ndn::time::steady_clock::TimePoint expiry;
+    size_t size;
+    bool isReady;
+    std::vector<WaitingInterest> waitingInterests;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  struct Shard {
+    std::mutex mutex;
+    // @{ needs mutex protection
+    // entries of pending queries in insertion order, which is also the order in which they
+    // expire
+    EntryList pending;
+    // entries of ready queries in the order they became ready, which is also the order in which
+    // they expire
+    EntryList ready;
+    std::unordered_map<QueryKey, EntryList::iterator, QueryKey::Hash> index;
+    size_t usedSize;
+    // @}
+  };
+
+  Shard&
+  getShard(const QueryKey& key);
+
+  /**
+   * @return the entry of an active query, or nullptr. An expired entry is removed. Needs the
+   *         shard's mutex.
+   */
+  Entry*
+  findEntry(Shard& shard, const QueryKey& key);
+
+  /**
+   * Helper function that removes an entry. Needs the shard's mutex.
+   */
+  void
+  removeEntry(Shard& shard, EntryList::iterator entry);
+
+  /**
+   * Helper function that drops the waiting Interests of an entry whose lifetime has passed.
+   * Needs the shard's mutex.
+   */
+  void
+  removeExpiredInterests(Shard& shard, Entry& entry,
+                         const ndn::time::steady_clock::TimePoint& now);
+
+  /**
+   * @return the waiting Interests of an entry whose lifetime has not passed, which no longer
+   *         wait in the entry. Needs the shard's mutex.
+   */
+  static InterestList
+  takeWaitingInterests(Entry& entry);
+
+  /**
+   * Helper function that removes expired entries, and the oldest ones while the shard is over
+   * budget. Needs the shard's mutex.
+   */
+  void
+  evict(Shard& shard, size_t maxSize);
+
+  static size_t
+  estimateSize(const QueryKey& key, const ndn::Data& ack);
+
+private:
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  const size_t m_maxShardSize;
+  const ndn::time::milliseconds m_lifetime;
+  const ndn::time::milliseconds m_executionTimeout;
+};
+
+} // namespace query
+} // namespace atmos
+
+#endif // ATMOS_QUERY_ACTIVE_QUERY_TABLE_HPP
@@ -20,8 +20,17 @@
 #define ATMOS_QUERY_QUERY_ADAPTER_HPP
 
 #include "util/catalog-adapter.hpp"
+#include "util/mysql-async-executor.hpp"
 #include "util/mysql-util.hpp"
 #include "util/config-file.hpp"
+#include "util/facet-index.hpp"
+#include "util/name-trie.hpp"
+#include "util/segment-cache.hpp"
+#include "util/thread-pool.hpp"
+#include "query/active-query-table.hpp"
+#include "query/query-key.hpp"
+#include "query/query-stats.hpp"
+#include "query/segment-encoder.hpp"
 
 #include <thread>
 
@@ -34,23 +43,72 @@
 #include <ndn-cxx/interest.hpp>
 #include <ndn-cxx/interest-filter.hpp>
 #include <ndn-cxx/name.hpp>
+#include <ndn-cxx/lp/nack.hpp>
 #include <ndn-cxx/security/key-chain.hpp>
+#include <ndn-cxx/util/crypto.hpp>
 #include <ndn-cxx/util/time.hpp>
 #include <ndn-cxx/encoding/encoding-buffer.hpp>
-#include <ndn-cxx/util/in-memory-storage-lru.hpp>
 
 #include "mysql/mysql.h"
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iterator>
 #include <map>
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace atmos {
 namespace query {
-static const size_t MAX_SEGMENT_SIZE = ndn::MAX_NDN_PACKET_SIZE >> 1;
+// Bytes of an encoded query-results segment, at most
+static const size_t MAX_SEGMENT_SIZE = ndn::MAX_NDN_PACKET_SIZE;
+// Upper bound of queries waiting for a worker thread, unless configured otherwise
+static const size_t DEFAULT_MAX_PENDING_QUERIES = 1000;
+// Upper bound of queries waiting for a connection of the asynchronous executor, unless
+// configured otherwise
+static const size_t DEFAULT_MAX_ASYNC_PENDING_QUERIES = 10000;
+// Bytes of payload in one query-results segment, unless configured otherwise
+static const size_t PAYLOAD_LIMIT = 7000;
+// Bytes of payload that segments sized to the link MTU have room for, at least
+static const size_t MIN_PAYLOAD_LIMIT = 64;
+// Segments generated beyond the requested one when segments are generated on demand
+static const uint64_t DEFAULT_READ_AHEAD = 4;
+// Names in a page of the results, at most, unless configured otherwise
+static const size_t DEFAULT_MAX_PAGE_SIZE = 1000;
+// Largest maxPageSize that can be configured
+static const size_t MAX_PAGE_SIZE = 1000000;
+// How long consumers may cache query results, which is also how long a query stays active
+// once its results are ready
+static const ndn::time::milliseconds RESULT_FRESHNESS_PERIOD(10000);
+// How long a query may run before Interests for it run it again, unless configured otherwise
+static const ndn::time::seconds DEFAULT_EXECUTION_TIMEOUT(300);
+// Bytes of query-results segments kept in memory, unless configured otherwise
+static const size_t DEFAULT_CACHE_MAX_SIZE = 256 * 1024 * 1024;
+// How often the signing certificate is looked up again, in case the identity changed its keys
+static const ndn::time::seconds SIGNING_CERT_REFRESH_INTERVAL(60);
+// Shards and memory budget in bytes of the active query table, unless configured otherwise
+static const size_t DEFAULT_ACTIVE_QUERY_SHARDS = 16;
+static const size_t DEFAULT_ACTIVE_QUERY_MAX_SIZE = 16 * 1024 * 1024;
+// Cursors of on-demand queries that nobody asks for during this period are dropped
+static const ndn::time::seconds CURSOR_LIFETIME(60);
+// The cmip5 table is checked for changes that make the name trie or the facet index stale at
+// most this often
+static const ndn::time::seconds CATALOG_RELOAD_INTERVAL(10);
+// How long a status dataset is served before it is made again, which is also its freshness
+static const ndn::time::milliseconds STATUS_FRESHNESS_PERIOD(1000);
+// Columns of the cmip5 table that the facet index keeps a bitmap per value of
+static const char* const FACET_COLUMNS[] = {
+  "activity", "product", "organization", "model", "experiment", "frequency", "modeling_realm",
+  "variable_name", "ensemble"
+};
 
 /**
  * QueryAdapter handles the Query usecases for the catalog
@@ -77,6 +135,13 @@ public:
   setConfigFile(util::ConfigFile& config,
                 const ndn::Name& prefix);
 
+  /**
+   * Helper function that replaces the index component queries are answered from, so that it
+   * can be shared with the adapter that publishes names
+   */
+  void
+  setFacetIndex(const std::shared_ptr<util::FacetIndex>& facetIndex);
+
 protected:
   /**
    * Helper function for configuration parsing
@@ -90,6 +155,8 @@ protected:
   /**
    * Handles incoming query requests by stripping the filter off the Interest to get the
    * actual request out. This removes the need for a 2-step Interest-Data retrieval.
+   * Requests under the "facets" prefix are answered like queries, with facet value counts as
+   * their results.
    *
    * @param filter:   InterestFilter that caused this Interest to be routed
    * @param interest: Interest that needs to be handled
@@ -106,22 +173,81 @@ protected:
   virtual void
   onQueryResultsInterest(const ndn::InterestFilter& filter, const ndn::Interest& interest);
 
+  /**
+   * Handles requests for the status dataset, which has the latency of each stage of the queries,
+   * what has become of them, and the state of the cache, the database connections and the
+   * workers, as a segmented JSON object. It is made at most once per STATUS_FRESHNESS_PERIOD.
+   * Interests for a version that has been replaced, or that come while the dataset cannot be
+   * made, are answered with a NACK.
+   *
+   * @param filter:   InterestFilter that caused this Interest to be routed
+   * @param interest: Interest that needs to be handled
+   */
+  virtual void
+  onStatusInterest(const ndn::InterestFilter& filter, const ndn::Interest& interest);
+
+  /**
+   * Helper function that makes the JSON object of the status dataset
+   */
+  Json::Value
+  makeStatus();
+
   /**
    * Helper function that makes query-results data
    *
    * @param segmentPrefix:  Name that identifies the Prefix for the Data
-   * @param value:          Json::Value to be sent in the Data
+   * @param encoder:        SegmentEncoder holding the names of the segment, which is finished
+   *                         and starts the next segment
    * @param segmentNo:      uint64_t the segment for this Data
    * @param isFinalBlock:   bool to indicate whether this needs to be flagged in the Data as the
    *                         last entry
-   * @param isAutocomplete: bool to indicate whether this is an autocomplete message
+   * @param isInManifest:   bool to indicate whether the Data is covered by a signed manifest,
+   *                         in which case it only gets a DigestSha256 signature
    */
   std::shared_ptr<ndn::Data>
   makeReplyData(const ndn::Name& segmentPrefix,
-                const Json::Value& value,
+                SegmentEncoder& encoder,
                 uint64_t segmentNo,
                 bool isFinalBlock,
-                bool isAutocomplete);
+                bool isInManifest = false);
+
+  /**
+   * Helper function that makes query-results data without signing it, see makeReplyData
+   */
+  std::shared_ptr<ndn::Data>
+  makeUnsignedReplyData(const ndn::Name& segmentPrefix,
+                        SegmentEncoder& encoder,
+                        uint64_t segmentNo,
+                        bool isFinalBlock);
+
+  /**
+   * Helper function that makes the manifest of a result, which lists the implicit digests of
+   * all its segments in order. The manifest is segmented as segmentPrefix/manifest/<segment>,
+   * and each manifest segment is signed with the signing identity.
+   *
+   * @param segmentPrefix: Name that identifies the Prefix for the result
+   * @param digests:       implicit digest components of the result segments
+   */
+  std::vector<std::shared_ptr<ndn::Data>>
+  makeManifestData(const ndn::Name& segmentPrefix,
+                   const std::vector<ndn::name::Component>& digests);
+
+  /**
+   * Helper function that adds the manifest of a result to its segments, if results are signed
+   * with a manifest
+   *
+   * @param segmentPrefix: Name that identifies the Prefix for the result
+   * @param segments:      all segments of the result, in order
+   */
+  void
+  appendManifestData(const ndn::Name& segmentPrefix,
+                     std::vector<std::shared_ptr<ndn::Data>>& segments);
+
+  /**
+   * Helper function that gives a segment covered by a manifest its DigestSha256 signature
+   */
+  void
+  signDigest(ndn::Data& data);
 
   /**
    * Helper function that generates query results from a Json query carried in the Interest
@@ -132,7 +258,71 @@ protected:
   runJsonQuery(std::shared_ptr<const ndn::Interest> interest);
 
   /**
-   * Helper function that makes ACK data
+   * Callback with whether the results of a query have been published
+   */
+  typedef std::function<void(bool isDone)> DoneCallback;
+
+  /**
+   * Reads the next name of the results of a query, or returns false after the last one
+   */
+  typedef std::function<bool(const char*& name, size_t& length)> NameReader;
+
+  /**
+   * Tells, once a NameReader has returned false, whether it stopped because of an error rather
+   * than after the last name
+   */
+  typedef std::function<bool()> ReadChecker;
+
+  /**
+   * Helper function that publishes the results of a canonical Json query, the one execution
+   * all Interests for the query share
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param query:         canonical Json query, without "compress" and "format"
+   * @param isFacetQuery:  whether the facet counts of the query are asked for
+   * @param pageSize:      number of names in a page, or 0 for all results
+   * @param format:        how the results are written
+   * @param onDone:        called once, false if the results cannot be published or anything
+   *                       on the way throws. A query run by the asynchronous executor calls it
+   *                       later, from a worker.
+   */
+  void
+  executeQuery(const ndn::Name& segmentPrefix,
+               Json::Value& query,
+               bool isFacetQuery,
+               size_t pageSize,
+               const ResultFormat& format,
+               const DoneCallback& onDone);
+
+  /**
+   * Helper function that does the work of executeQuery, which catches what it throws
+   */
+  void
+  runQuery(const ndn::Name& segmentPrefix,
+           Json::Value& query,
+           bool isFacetQuery,
+           size_t pageSize,
+           const ResultFormat& format,
+           const DoneCallback& onDone);
+
+  /**
+   * Helper function that answers the Interests that have been waiting for a query once it has
+   * been executed, or makes the query run again next time if it has failed
+   *
+   * @param key:      canonical query
+   * @param ack:      ACK the query has been inserted with
+   * @param interest: Interest that has run the query
+   * @param isDone:   whether the results have been published
+   */
+  void
+  finishQuery(const QueryKey& key,
+              const std::shared_ptr<const ndn::Data>& ack,
+              const std::shared_ptr<const ndn::Interest>& interest,
+              bool isDone);
+
+  /**
+   * Helper function that makes ACK data. If results are signed with a manifest, its content is
+   * the name of the manifest.
    *
    * @param interest: Intersts that needs to be handled
    * @param version:  Version that needs to be in the data name
@@ -141,36 +331,477 @@ protected:
   makeAckData(std::shared_ptr<const ndn::Interest> interest,
               const ndn::Name::Component& version);
 
+  /**
+   * Helper function that sends the ACK of a query that is already active, which tells the
+   * consumer where to find the existing results
+   *
+   * @param interest: Interest that needs to be handled
+   * @param ack:      ACK data sent to the first consumer of the query
+   */
+  void
+  sendActiveAck(std::shared_ptr<const ndn::Interest> interest,
+                std::shared_ptr<const ndn::Data> ack);
+
   /**
    * Helper function that generates the sqlQuery string and autocomplete flag
-   * @param sqlQuery:     stringstream to save the sqlQuery string
+   * @param sqlQuery:     stringstream to save the sqlQuery string, with a ? for each value
+   * @param sqlValues:    vector to save the values of the sqlQuery, in order
    * @param jsonValue:    Json value that contains the query information
    * @param autocomplete: Flag to indicate if the json contains autocomplete flag
    */
   void
   json2Sql(std::stringstream& sqlQuery,
+           std::vector<std::string>& sqlValues,
            Json::Value& jsonValue,
            bool& autocomplete);
 
+  /**
+   * Helper function that generates the conditions of the sqlQuery, i.e. what follows WHERE.
+   * Values are bound to the placeholders when the query runs, so the conditions only depend on
+   * the columns, and queries on the same columns share a prepared statement.
+   * @param sqlCondition: stringstream to save the conditions, with a ? for each value
+   * @param sqlValues:    vector to save the values of the conditions, in order
+   * @param jsonValue:    Json value that contains the query information
+   * @param autocomplete: Flag to indicate if the json contains autocomplete flag
+   * @return false if the json contains no condition, in which case the result is the empty set
+   */
+  bool
+  json2SqlCondition(std::stringstream& sqlCondition,
+                    std::vector<std::string>& sqlValues,
+                    Json::Value& jsonValue,
+                    bool& autocomplete);
+
   /**
    * Helper function that signs the data
    */
   void
   signData(ndn::Data& data);
 
+  /**
+   * Helper function that looks up the certificate of the signing identity's key of the
+   * configured type. Needs m_keyChainMutex.
+   */
+  void
+  refreshSigningCertificate();
+
+  /**
+   * @return bytes of payload that fit into a query-results segment. That is the configured
+   *         segment size, or what is left of the link MTU once the name, the meta info and the
+   *         signature of the segment are encoded. It is never more than what is left of
+   *         MAX_SEGMENT_SIZE.
+   */
+  size_t
+  getPayloadLimit();
+
+  /**
+   * @return an unsigned query-results segment without payload, whose name has the largest
+   *         segment number a result can reach, to measure the overhead of segments on
+   */
+  ndn::Data
+  makeOverheadProbe() const;
+
+  // Segments that are being signed, in segment order
+  typedef std::deque<std::pair<std::shared_ptr<ndn::Data>, std::future<void>>> SigningQueue;
+
+  /**
+   * Helper function that hands a segment to the signing threads, and puts the segments that
+   * are signed into the cache
+   *
+   * @param queue: segments of the same result that are being signed
+   * @param data:  unsigned segment, which must come after those in the queue
+   */
+  void
+  queueSegment(SigningQueue& queue, const std::shared_ptr<ndn::Data>& data);
+
+  /**
+   * Helper function that puts the signed segments at the front of the queue into the cache,
+   * waiting for them while the queue holds more than maxPending segments
+   */
+  void
+  drainSigningQueue(SigningQueue& queue, size_t maxPending);
+
+  /**
+   * Helper function that sends the data through the face. The face is not thread-safe, so
+   * query workers hand the data over to the face's io thread instead of putting it directly.
+   *
+   * @param data: Data that needs to be sent
+   */
+  void
+  sendData(const std::shared_ptr<const ndn::Data>& data);
+
+  /**
+   * Helper function that answers an Interest with a NACK through the face's io thread, like
+   * sendData. Unlike Data, the NACK is not cached, so the consumer's next Interest reaches the catalog.
+   *
+   * @param interest: Interest that cannot be answered
+   */
+  void
+  sendNack(const std::shared_ptr<const ndn::Interest>& interest);
+
+  /**
+   * Helper function that puts query-results segments into the cache
+   */
+  void
+  cacheSegment(const ndn::Data& data);
+
+  void
+  cacheSegments(const std::vector<std::shared_ptr<ndn::Data>>& segments);
+
   /**
    * Helper function that publishes query-results data segments
+   *
+   * @return false if the query fails
    */
-  virtual void
+  virtual bool
   prepareSegments(const ndn::Name& segmentPrefix,
                   const std::string& sqlString,
-                  bool autocomplete);
+                  const std::vector<std::string>& sqlValues,
+                  bool autocomplete,
+                  const ResultFormat& format);
+
+  /**
+   * Helper function that publishes query-results data segments like prepareSegments, but with
+   * the query run by the asynchronous executor, so that no worker waits for the database. The
+   * results are made into segments on a worker.
+   *
+   * @param onDone: called once the segments are published, or the query has failed
+   */
+  void
+  prepareSegmentsAsync(const ndn::Name& segmentPrefix,
+                       const std::string& sqlString,
+                       const std::vector<std::string>& sqlValues,
+                       bool autocomplete,
+                       const ResultFormat& format,
+                       const DoneCallback& onDone);
+
+  /**
+   * Helper function that publishes the rows of a query as query-results data segments, each
+   * one as soon as it is full
+   *
+   * @param sqlString: query the rows come from
+   * @param fetchName: reader of the names of the query
+   * @param hasFailed: tells whether fetchName failed, in which case the segments published so
+   *                   far are left without a final one
+   * @return false if the segments cannot be published
+   */
+  bool
+  publishResults(const ndn::Name& segmentPrefix,
+                 const std::string& sqlString,
+                 const NameReader& fetchName,
+                 const ReadChecker& hasFailed,
+                 bool autocomplete,
+                 const ResultFormat& format);
+
+  /**
+   * Position of a query whose segments are generated when they are first requested. Names are
+   * read in name order, so the last name put into a segment is all that is needed to continue.
+   */
+  struct QueryCursor {
+    QueryCursor(const std::string& condition, const std::vector<std::string>& values,
+                bool autocomplete, size_t limit, const ResultFormat& resultFormat)
+      : sqlCondition(condition)
+      , sqlValues(values)
+      , isAutocomplete(autocomplete)
+      , payloadLimit(limit)
+      , format(resultFormat)
+      , nextSegmentNo(0)
+      , wantedSegmentNo(0)
+      , namesPerSegment(limit / 64 + 1)
+      , isFinished(false)
+      , isGenerating(false)
+      , lastUsed(ndn::time::steady_clock::now())
+    {
+    }
+
+    const std::string sqlCondition;
+    const std::vector<std::string> sqlValues;
+    const bool isAutocomplete;
+    const size_t payloadLimit;
+    const ResultFormat format;
+
+    std::mutex mutex;
+    // @{ needs mutex protection
+    // The last name that has been put into a segment
+    std::string lastName;
+    uint64_t nextSegmentNo;
+    // Segments up to this one should be generated
+    uint64_t wantedSegmentNo;
+    // Estimate of how many names fit into a segment, to size the next fetch
+    size_t namesPerSegment;
+    bool isFinished;
+    bool isGenerating;
+    // Segments that were requested before they were generated
+    std::set<uint64_t> requestedSegments;
+    // The last name before each generated segment, to generate it again once it is evicted
+    std::vector<std::string> segmentStarts;
+    // Evicted segments that are being generated again
+    std::set<uint64_t> regeneratingSegments;
+    ndn::time::steady_clock::TimePoint lastUsed;
+    // @}
+  };
+
+  /**
+   * Helper function that asks for a segment of an on-demand query, and for the read-ahead
+   * window after it. Generation runs on the query workers, and the segment is sent as soon as
+   * it is ready.
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param cursor:        cursor of the query
+   * @param segmentNo:     the requested segment
+   */
+  void
+  requestSegment(const ndn::Name& segmentPrefix,
+                 const std::shared_ptr<QueryCursor>& cursor,
+                 uint64_t segmentNo);
+
+  /**
+   * Helper function that generates the segments of an on-demand query until the wanted one
+   *
+   * @return false if the names cannot be fetched from the database
+   */
+  bool
+  generateSegments(const ndn::Name& segmentPrefix,
+                   const std::shared_ptr<QueryCursor>& cursor);
+
+  /**
+   * Helper function that generates a segment of an on-demand query again, after the cache has
+   * evicted it, and sends it
+   */
+  void
+  regenerateSegment(const ndn::Name& segmentPrefix,
+                    const std::shared_ptr<QueryCursor>& cursor,
+                    uint64_t segmentNo);
+
+  /**
+   * Helper function that fetches, in name order, the names of an on-demand query. Names are
+   * ordered byte for byte, whatever the collation of the column, as the facet index does.
+   *
+   * @param sqlCondition: conditions of the query, see json2SqlCondition
+   * @param sqlValues:    values of the conditions
+   * @param lastName:     only names after this one are fetched, empty to start from the first
+   * @param limit:        maximum number of names to fetch
+   * @param names:        vector to save the names
+   * @return false if the names cannot be fetched
+   */
+  virtual bool
+  fetchNames(const std::string& sqlCondition,
+             const std::vector<std::string>& sqlValues,
+             const std::string& lastName,
+             size_t limit,
+             std::vector<std::string>& names);
+
+  /**
+   * Helper function that loads all names of the catalog into a new name trie, and then lets
+   * autocompletion use it. A loaded trie is kept as long as the cmip5 table does not change,
+   * see readCatalogVersion.
+   */
+  virtual void
+  loadNameTrie();
+
+  /**
+   * Helper function that has a worker check the catalog for changes and load the name trie
+   * again if needed, unless it is already being loaded or was checked too recently
+   */
+  void
+  scheduleNameTrieLoad();
+
+  /**
+   * Helper function that publishes the distinct next components of the names under a prefix
+   * as an autocompletion result, see NameTrie::findNextComponents. With a top-k limit, only
+   * the components with the most names under them are published, best first.
+   *
+   * Until the name trie is loaded, the names under the prefix are fetched from the database
+   * into a trie of their own, so the result does not depend on when the query comes.
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param prefix:        prefix of the names to complete
+   * @param cursor:        last component of the previous page, or empty
+   * @param pageSize:      number of components in a page, or 0 for all of them. A top-k
+   *                       result is a single page.
+   * @param format:        how the result is written
+   * @return false if the names cannot be fetched
+   */
+  bool
+  prepareNextComponents(const ndn::Name& segmentPrefix,
+                        const std::string& prefix,
+                        const std::string& cursor,
+                        size_t pageSize,
+                        const ResultFormat& format);
+
+  /**
+   * Helper function that loads the facets of all datasets of the catalog into the facet index,
+   * and then lets component queries use it. A loaded index is kept as long as the row count
+   * and the largest id of the cmip5 table stay the same, so rows that other tools insert or
+   * delete are picked up.
+   */
+  virtual void
+  loadFacetIndex();
+
+  /**
+   * Helper function that has a worker check the catalog for changes and load the facet index
+   * again if needed, unless it is already being loaded or was checked too recently
+   */
+  void
+  scheduleFacetIndexLoad();
+
+  /**
+   * Helper function that has a worker run a load of the catalog into memory, unless one is
+   * already running or the last one started less than CATALOG_RELOAD_INTERVAL ago
+   *
+   * @param isLoading: whether a load is running
+   * @param loadTime:  when the next load may start, which needs isLoading
+   * @param load:      function that loads, which runs on the worker
+   */
+  void
+  scheduleLoad(std::atomic<bool>& isLoading,
+               ndn::time::steady_clock::TimePoint& loadTime,
+               const std::function<void()>& load);
+
+  /**
+   * Helper function that reads the row count and the largest id of the cmip5 table. The ids
+   * only grow, so inserted rows raise the largest one and deleted rows lower the count.
+   *
+   * @param version: string to save them to
+   * @return false if they cannot be read
+   */
+  bool
+  readCatalogVersion(const std::shared_ptr<MYSQL>& connection, std::string& version);
+
+  /**
+   * Helper function that answers a component query from the facet index
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param query:         canonical Json query
+   * @param format:        how the result is written
+   * @return false if the index cannot answer the query, which then goes to the database
+   */
+  bool
+  prepareFacetQuery(const ndn::Name& segmentPrefix,
+                    const Json::Value& query,
+                    const ResultFormat& format);
+
+  /**
+   * Helper function that turns a canonical Json query into the conditions of the facet index
+   *
+   * @param query:      canonical Json query
+   * @param conditions: vector to save the (column, value) pairs
+   * @return false if the query is not an object of strings
+   */
+  static bool
+  json2Conditions(const Json::Value& query, util::FacetIndex::ConditionList& conditions);
+
+  /**
+   * Helper function that publishes one page of the results of a query, in name order. The
+   * final segment has a "cursor" to resume after the page with, unless it is the last page,
+   * and the first page also has the "total" number of results.
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param query:         canonical Json query, with "pageSize" and an optional "cursor"
+   * @param pageSize:      number of names in the page
+   * @param format:        how the page is written
+   * @return false if the names cannot be fetched
+   */
+  bool
+  preparePage(const ndn::Name& segmentPrefix,
+              Json::Value query,
+              size_t pageSize,
+              const ResultFormat& format);
+
+  /**
+   * Helper function that counts the results of a query in the database
+   *
+   * @param sqlCondition: conditions of the query, see json2SqlCondition
+   * @param sqlValues:    values of the conditions
+   * @param count:        number of names that meet the conditions
+   * @return false if the names cannot be counted
+   */
+  virtual bool
+  countNames(const std::string& sqlCondition,
+             const std::vector<std::string>& sqlValues,
+             uint64_t& count);
+
+  /**
+   * Helper function that publishes, for every facet column the filter does not constrain, how
+   * many datasets that meet the filter have each value. The counts come from the facet index
+   * if it can answer the filter, and else from a single grouped query to the database.
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param filter:        canonical Json query that the datasets have to meet
+   * @return false if the counts cannot be fetched
+   */
+  bool
+  prepareFacetCounts(const ndn::Name& segmentPrefix, const Json::Value& filter);
+
+  /**
+   * Helper function that counts the datasets by value of the facet columns in the database,
+   * see util::FacetIndex::countValues
+   *
+   * @param sqlCondition: conditions of the filter, see json2SqlCondition, empty for all
+   * @param sqlValues:    values of the conditions
+   * @param columns:      facet columns to count
+   * @param counts:       map to save the counts
+   * @return false if the counts cannot be fetched
+   */
+  virtual bool
+  fetchFacetCounts(const std::string& sqlCondition,
+                   const std::vector<std::string>& sqlValues,
+                   const std::vector<std::string>& columns,
+                   util::FacetIndex::FacetCounts& counts);
+
+  /**
+   * Helper function that makes a facet counts segment, {"facets":{column:{value:count}}}
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param facets:        counts in this segment, by column
+   * @param segmentNo:     the segment for this Data
+   * @param isFinalBlock:  whether this is the last segment
+   */
+  std::shared_ptr<ndn::Data>
+  makeFacetData(const ndn::Name& segmentPrefix,
+                const Json::Value& facets,
+                uint64_t segmentNo,
+                bool isFinalBlock);
+
+  /**
+   * Helper function that publishes names that are already in memory as query results
+   *
+   * @param segmentPrefix: Name that identifies the query-results version
+   * @param names:         names of the result, in the order they are published
+   * @param autocomplete:  whether the names are autocompletion results
+   * @param format:        how the names are written
+   * @param pageInfo:      members added to the final segment, see SegmentEncoder::setPageInfo
+   */
+  void
+  prepareNames(const ndn::Name& segmentPrefix,
+               const std::vector<std::string>& names,
+               bool autocomplete,
+               const ResultFormat& format,
+               const Json::Value& pageInfo = Json::Value(Json::objectValue));
 
   /**
    * Helper function to set the DatabaseHandler
+   *
+   * @param databaseId:     database to connect to
+   * @param minConnections: number of connections that are kept open
+   * @param maxConnections: maximum number of connections open at the same time
+   */
+  void
+  setDatabaseHandler(const util::ConnectionDetails&  databaseId,
+                     size_t minConnections,
+                     size_t maxConnections);
+
+  /**
+   * Helper function that sets up the executor that runs queries without blocking a worker,
+   * on connections of its own
+   *
+   * @param databaseId:   database to connect to
+   * @param nConnections: connections of the executor, or 0 to run queries on the workers
+   * @param maxPending:   number of queries that may wait for a connection before new ones fail
    */
   void
-  setDatabaseHandler(const util::ConnectionDetails&  databaseId);
+  setAsyncExecutor(const util::ConnectionDetails& databaseId,
+                   size_t nConnections,
+                   size_t maxPending);
 
   /**
    * Helper function that set filters to make the adapter work
@@ -178,18 +809,101 @@ protected:
   void
   setFilters();
 
+  /**
+   * Helper function that starts the worker threads that run the queries
+   *
+   * @param nThreads:         number of worker threads
+   * @param maxPendingQueries: number of queries that may wait for a worker before new ones are
+   *                           dropped
+   * @param nSigningThreads:   number of threads that sign the segments of a result in
+   *                           parallel, or 0 to sign on the query workers
+   */
+  void
+  setThreadPool(size_t nThreads, size_t maxPendingQueries, size_t nSigningThreads);
+
 protected:
   typedef std::unordered_map<ndn::Name, const ndn::RegisteredPrefixId*> RegisteredPrefixList;
-  // Handle to the Catalog's database
-  std::shared_ptr<DatabaseHandler> m_databaseHandler;
+  // Connections to the Catalog's database, for MySQL
+  std::shared_ptr<util::MySQLConnectionPool> m_databasePool;
+
+  // Runs queries with the non-blocking client API on the face's io_service, if set
+  std::shared_ptr<util::MySQLAsyncExecutor> m_asyncExecutor;
+
+  // Whether rows are fetched from the server one by one instead of all at once
+  bool m_streamResults;
+
+  // Whether results carry a signed manifest instead of a signature on every segment
+  bool m_signManifest;
+
+  // Whether segments are generated when they are first requested instead of all up front
+  bool m_lazySegments;
+  uint64_t m_readAhead;
+
+  // Names in a page, at most, which larger pageSizes are cut down to
+  size_t m_maxPageSize;
+
+  // Bytes of payload per segment, unless segments are sized to fit the link MTU (if not 0)
+  size_t m_segmentSize;
+  size_t m_linkMtu;
+
+  // Names of the catalog, which answer autocompletion once they are all loaded. A reload
+  // replaces the trie, so it is accessed with std::atomic_load and std::atomic_store.
+  std::shared_ptr<util::NameTrie> m_nameTrie;
+  bool m_useNameTrie;
+  std::atomic<bool> m_isNameTrieLoaded;
+  std::atomic<bool> m_isNameTrieLoading;
+  // when the name trie may be loaded again, which needs m_isNameTrieLoading
+  ndn::time::steady_clock::TimePoint m_nameTrieLoadTime;
+  // catalog version the name trie was loaded from, which needs m_isNameTrieLoading
+  std::string m_nameTrieVersion;
+  // Completions in an autocompletion result, or 0 for all of them
+  size_t m_autocompleteTopK;
+
+  // Bitmaps of the datasets by facet value, which answer component queries once loaded
+  std::shared_ptr<util::FacetIndex> m_facetIndex;
+  bool m_useFacetIndex;
+  std::atomic<bool> m_isFacetIndexLoading;
+  // when the facet index may be loaded again, which needs m_isFacetIndexLoading
+  ndn::time::steady_clock::TimePoint m_facetIndexLoadTime;
+  // catalog version the facet index was loaded from, which needs m_isFacetIndexLoading
+  std::string m_facetIndexVersion;
+
+  // Workers that run the queries off the face's io thread
+  std::unique_ptr<util::ThreadPool> m_queryPool;
+  // Workers that sign the segments of eagerly prepared results with the injected KeyChain
+  std::unique_ptr<util::ThreadPool> m_signingPool;
+
+  // The Queries we are currently writing to, which has its own locking
+  std::unique_ptr<ActiveQueryTable> m_activeQueries;
+
+  // Latencies of the stages of the queries and what has become of them, which has no locking
+  QueryStats m_stats;
+  // Whether the status dataset is served under the "status" prefix
+  bool m_serveStatus;
+  // Segments of the last status dataset, which are only used on the face's io thread
+  std::vector<std::shared_ptr<ndn::Data>> m_status;
+  ndn::time::steady_clock::TimePoint m_statusTime;
 
   // mutex to control critical sections
   std::mutex m_mutex;
   // @{ needs m_mutex protection
-  // The Queries we are currently writing to
-  std::map<std::string, std::shared_ptr<ndn::Data>> m_activeQueryToFirstResponse;
+  std::unique_ptr<util::SegmentCache> m_cache;
 
-  ndn::util::InMemoryStorageLru m_cache;
+  // Cursors of the on-demand queries that are not completely generated yet, by segment prefix
+  std::map<ndn::Name, std::shared_ptr<QueryCursor>> m_cursors;
+  // @}
+  // KeyChain is not thread-safe, so workers take turns to sign
+  std::mutex m_keyChainMutex;
+  // @{ needs m_keyChainMutex protection
+  // The signing key is looked up once and then only every SIGNING_CERT_REFRESH_INTERVAL,
+  // rather than going through the PIB for every Data
+  // whether signingAlgorithm is configured, without which the identity's default key signs
+  bool m_hasSigningKeyType;
+  ndn::KeyType m_signingKeyType;
+  ndn::Name m_signingCertName;
+  ndn::time::steady_clock::TimePoint m_signingCertRefreshTime;
+  // Bytes a segment signed with the certificate takes on top of its payload
+  size_t m_segmentOverhead;
   // @}
   RegisteredPrefixList m_registeredPrefixList;
 };
@@ -198,7 +912,31 @@ template <typename DatabaseHandler>
 QueryAdapter<DatabaseHandler>::QueryAdapter(const std::shared_ptr<ndn::Face>& face,
                                             const std::shared_ptr<ndn::KeyChain>& keyChain)
   : util::CatalogAdapter(face, keyChain)
-  , m_cache(250000)
+  , m_streamResults(false)
+  , m_signManifest(false)
+  , m_lazySegments(false)
+  , m_readAhead(DEFAULT_READ_AHEAD)
+  , m_maxPageSize(DEFAULT_MAX_PAGE_SIZE)
+  , m_segmentSize(PAYLOAD_LIMIT)
+  , m_linkMtu(0)
+  , m_nameTrie(new util::NameTrie())
+  , m_useNameTrie(true)
+  , m_isNameTrieLoaded(false)
+  , m_isNameTrieLoading(false)
+  , m_autocompleteTopK(0)
+  , m_facetIndex(new util::FacetIndex(std::vector<std::string>(std::begin(FACET_COLUMNS),
+                                                                std::end(FACET_COLUMNS))))
+  , m_useFacetIndex(false)
+  , m_isFacetIndexLoading(false)
+  , m_activeQueries(new ActiveQueryTable(DEFAULT_ACTIVE_QUERY_SHARDS,
+                                         DEFAULT_ACTIVE_QUERY_MAX_SIZE,
+                                         RESULT_FRESHNESS_PERIOD,
+                                         DEFAULT_EXECUTION_TIMEOUT))
+  , m_serveStatus(true)
+  , m_cache(new util::SegmentCache(DEFAULT_CACHE_MAX_SIZE))
+  , m_hasSigningKeyType(false)
+  , m_signingKeyType(ndn::KEY_TYPE_RSA)
+  , m_segmentOverhead(0)
 {
 }
 
@@ -215,6 +953,15 @@ QueryAdapter<DatabaseHandler>::setFilters()
                             bind(&query::QueryAdapter<DatabaseHandler>::onRegisterFailure,
                                  this, _1, _2));
 
+  ndn::Name facetsPrefix = ndn::Name(m_prefix).append("facets");
+  m_registeredPrefixList[facetsPrefix] = m_face->setInterestFilter(ndn::InterestFilter(facetsPrefix),
+                            bind(&query::QueryAdapter<DatabaseHandler>::onQueryInterest,
+                                 this, _1, _2),
+                            bind(&query::QueryAdapter<DatabaseHandler>::onRegisterSuccess,
+                                 this, _1),
+                            bind(&query::QueryAdapter<DatabaseHandler>::onRegisterFailure,
+                                 this, _1, _2));
+
   ndn::Name resultPrefix = ndn::Name(m_prefix).append("query-results");
   m_registeredPrefixList[resultPrefix] = m_face->setInterestFilter(ndn::InterestFilter(ndn::Name(m_prefix).append("query-results")),
                             bind(&query::QueryAdapter<DatabaseHandler>::onQueryResultsInterest,
@@ -223,6 +970,17 @@ QueryAdapter<DatabaseHandler>::setFilters()
                                  this, _1),
                             bind(&query::QueryAdapter<DatabaseHandler>::onRegisterFailure,
                                  this, _1, _2));
+
+  if (m_serveStatus) {
+    ndn::Name statusPrefix = ndn::Name(m_prefix).append("status");
+    m_registeredPrefixList[statusPrefix] = m_face->setInterestFilter(ndn::InterestFilter(statusPrefix),
+                              bind(&query::QueryAdapter<DatabaseHandler>::onStatusInterest,
+                                   this, _1, _2),
+                              bind(&query::QueryAdapter<DatabaseHandler>::onRegisterSuccess,
+                                   this, _1),
+                              bind(&query::QueryAdapter<DatabaseHandler>::onRegisterFailure,
+                                   this, _1, _2));
+  }
 }
 
 template <typename DatabaseHandler>
@@ -246,6 +1004,30 @@ QueryAdapter<DatabaseHandler>::onConfig(const util::ConfigSection& section,
     return;
   }
   std::string signingId, dbServer, dbName, dbUser, dbPasswd;
+  bool hasSigningKeyType = false;
+  ndn::KeyType signingKeyType = ndn::KEY_TYPE_RSA;
+  size_t minConnections = util::DEFAULT_MIN_CONNECTIONS;
+  size_t maxConnections = util::DEFAULT_MAX_CONNECTIONS;
+  size_t asyncConnections = 0;
+  size_t maxAsyncPending = DEFAULT_MAX_ASYNC_PENDING_QUERIES;
+  size_t nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  size_t maxPendingQueries = DEFAULT_MAX_PENDING_QUERIES;
+  size_t nSigningThreads = 0;
+  bool streamResults = false;
+  bool signManifest = false;
+  bool lazySegments = false;
+  bool useNameTrie = true;
+  size_t autocompleteTopK = 0;
+  bool useFacetIndex = false;
+  bool serveStatus = true;
+  uint64_t readAhead = DEFAULT_READ_AHEAD;
+  size_t maxPageSize = DEFAULT_MAX_PAGE_SIZE;
+  size_t segmentSize = PAYLOAD_LIMIT;
+  size_t linkMtu = 0;
+  size_t cacheMaxSize = DEFAULT_CACHE_MAX_SIZE;
+  size_t activeQueryShards = DEFAULT_ACTIVE_QUERY_SHARDS;
+  size_t activeQueryMaxSize = DEFAULT_ACTIVE_QUERY_MAX_SIZE;
+  ndn::time::seconds executionTimeout = DEFAULT_EXECUTION_TIMEOUT;
   for (auto item = section.begin();
        item != section.end();
        ++ item)
@@ -257,6 +1039,20 @@ QueryAdapter<DatabaseHandler>::onConfig(const util::ConfigSection& section,
                                 " in \"query\" section");
       }
     }
+    if (item->first == "signingAlgorithm") {
+      const std::string algorithm = item->second.get_value<std::string>();
+      if (algorithm == "rsa") {
+        signingKeyType = ndn::KEY_TYPE_RSA;
+      }
+      else if (algorithm == "ecdsa") {
+        signingKeyType = ndn::KEY_TYPE_ECDSA;
+      }
+      else {
+        throw Error("Invalid value for \"signingAlgorithm\""
+                                " in \"query\" section");
+      }
+      hasSigningKeyType = true;
+    }
     if (item->first == "database") {
       const util::ConfigSection& dataSection = item->second;
       for (auto subItem = dataSection.begin();
@@ -291,93 +1087,1525 @@ QueryAdapter<DatabaseHandler>::onConfig(const util::ConfigSection& section,
                                     " in \"query\" section");
           }
         }
+        if (subItem->first == "minConnections") {
+          minConnections = subItem->second.get_value<size_t>(0);
+        }
+        if (subItem->first == "maxConnections") {
+          maxConnections = subItem->second.get_value<size_t>(0);
+          if (maxConnections == 0) {
+            throw Error("Invalid value for \"maxConnections\""
+                                    " in \"query\" section");
+          }
+        }
+        if (subItem->first == "asyncConnections") {
+          try {
+            asyncConnections = subItem->second.get_value<size_t>();
+          }
+          catch (const boost::property_tree::ptree_bad_data&) {
+            throw Error("Invalid value for \"asyncConnections\""
+                        " in \"query\" section");
+          }
+        }
+        if (subItem->first == "maxAsyncPending") {
+          maxAsyncPending = subItem->second.get_value<size_t>(0);
+          if (maxAsyncPending == 0) {
+            throw Error("Invalid value for \"maxAsyncPending\""
+                                    " in \"query\" section");
+          }
+        }
       }
     }
-  }
-
-  m_prefix = prefix;
-  m_signingId = ndn::Name(signingId);
-  util::ConnectionDetails mysqlId(dbServer, dbUser, dbPasswd, dbName);
-
-  setDatabaseHandler(mysqlId);
-  setFilters();
-}
-
-template <typename DatabaseHandler>
-void
-QueryAdapter<DatabaseHandler>::setDatabaseHandler(const util::ConnectionDetails& databaseId)
-{
-  //empty
-}
-
-template <>
-void
-QueryAdapter<MYSQL>::setDatabaseHandler(const util::ConnectionDetails& databaseId)
-{
-  std::shared_ptr<MYSQL> conn = atmos::util::MySQLConnectionSetup(databaseId);
-
-  m_databaseHandler = conn;
-}
+    if (item->first == "streamResults") {
+      streamResults = ConfigFile::parseYesNo(*item, "query");
+    }
+    if (item->first == "signManifest") {
+      signManifest = ConfigFile::parseYesNo(*item, "query");
+    }
+    if (item->first == "lazySegments") {
+      lazySegments = ConfigFile::parseYesNo(*item, "query");
+    }
+    if (item->first == "nameTrie") {
+      useNameTrie = ConfigFile::parseYesNo(*item, "query");
+    }
+    if (item->first == "autocompleteTopK") {
+      try {
+        autocompleteTopK = item->second.get_value<size_t>();
+      }
+      catch (const boost::property_tree::ptree_bad_data&) {
+        throw Error("Invalid value for \"autocompleteTopK\""
+                    " in \"query\" section");
+      }
+    }
+    if (item->first == "facetIndex") {
+      useFacetIndex = ConfigFile::parseYesNo(*item, "query");
+    }
+    if (item->first == "status") {
+      serveStatus = ConfigFile::parseYesNo(*item, "query");
+    }
+    if (item->first == "readAhead") {
+      try {
+        readAhead = item->second.get_value<uint64_t>();
+      }
+      catch (const boost::property_tree::ptree_bad_data&) {
+        throw Error("Invalid value for \"readAhead\""
+                    " in \"query\" section");
+      }
+    }
+    if (item->first == "maxPageSize") {
+      maxPageSize = item->second.get_value<size_t>(0);
+      if (maxPageSize == 0 || maxPageSize > MAX_PAGE_SIZE) {
+        throw Error("Invalid value for \"maxPageSize\""
+                    " in \"query\" section");
+      }
+    }
+    if (item->first == "segmentSize") {
+      segmentSize = item->second.get_value<size_t>(0);
+      if (segmentSize == 0 || segmentSize > MAX_SEGMENT_SIZE) {
+        throw Error("Invalid value for \"segmentSize\""
+                    " in \"query\" section");
+      }
+    }
+    if (item->first == "linkMtu") {
+      linkMtu = item->second.get_value<size_t>(0);
+      if (linkMtu == 0 || linkMtu > MAX_SEGMENT_SIZE) {
+        throw Error("Invalid value for \"linkMtu\""
+                    " in \"query\" section");
+      }
+    }
+    if (item->first == "cache") {
+      const util::ConfigSection& cacheSection = item->second;
+      for (auto subItem = cacheSection.begin();
+           subItem != cacheSection.end();
+           ++ subItem)
+      {
+        if (subItem->first == "maxSize") {
+          cacheMaxSize = subItem->second.get_value<size_t>(0);
+          if (cacheMaxSize == 0) {
+            throw Error("Invalid value for \"maxSize\""
+                                    " in \"query\\cache\" section");
+          }
+        }
+      }
+    }
+    if (item->first == "activeQueries") {
+      const util::ConfigSection& activeSection = item->second;
+      for (auto subItem = activeSection.begin();
+           subItem != activeSection.end();
+           ++ subItem)
+      {
+        if (subItem->first == "shards") {
+          activeQueryShards = subItem->second.get_value<size_t>(0);
+          if (activeQueryShards == 0) {
+            throw Error("Invalid value for \"shards\""
+                                    " in \"query\\activeQueries\" section");
+          }
+        }
+        if (subItem->first == "maxSize") {
+          activeQueryMaxSize = subItem->second.get_value<size_t>(0);
+          if (activeQueryMaxSize == 0) {
+            throw Error("Invalid value for \"maxSize\""
+                                    " in \"query\\activeQueries\" section");
+          }
+        }
+        if (subItem->first == "executionTimeout") {
+          executionTimeout = ndn::time::seconds(subItem->second.get_value<size_t>(0));
+          if (executionTimeout == ndn::time::seconds::zero()) {
+            throw Error("Invalid value for \"executionTimeout\""
+                                    " in \"query\\activeQueries\" section");
+          }
+        }
+      }
+    }
+    if (item->first == "threadPool") {
+      const util::ConfigSection& poolSection = item->second;
+      for (auto subItem = poolSection.begin();
+           subItem != poolSection.end();
+           ++ subItem)
+      {
+        if (subItem->first == "size") {
+          nThreads = subItem->second.get_value<size_t>(0);
+          if (nThreads == 0) {
+            throw Error("Invalid value for \"size\""
+                                    " in \"query\\threadPool\" section");
+          }
+        }
+        if (subItem->first == "maxPending") {
+          maxPendingQueries = subItem->second.get_value<size_t>(0);
+          if (maxPendingQueries == 0) {
+            throw Error("Invalid value for \"maxPending\""
+                                    " in \"query\\threadPool\" section");
+          }
+        }
+        if (subItem->first == "signing") {
+          try {
+            nSigningThreads = subItem->second.get_value<size_t>();
+          }
+          catch (const boost::property_tree::ptree_bad_data&) {
+            throw Error("Invalid value for \"signing\""
+                        " in \"query\\threadPool\" section");
+          }
+        }
+      }
+    }
+  }
+
+  m_prefix = prefix;
+  m_signingId = ndn::Name(signingId);
+  {
+    std::lock_guard<std::mutex> lock(m_keyChainMutex);
+    m_hasSigningKeyType = hasSigningKeyType;
+    m_signingKeyType = signingKeyType;
+    // looked up on first use, since the identity may only be created after the configuration
+    m_signingCertName.clear();
+  }
+  m_streamResults = streamResults;
+  // segments generated on demand are signed one by one, as no manifest can list them up front
+  m_signManifest = signManifest && !lazySegments;
+  m_lazySegments = lazySegments;
+  m_readAhead = readAhead;
+  m_maxPageSize = maxPageSize;
+  m_segmentSize = segmentSize;
+  m_linkMtu = linkMtu;
+  // the whole segment, name and signature included, has to fit into a packet
+  size_t segmentOverhead = 0;
+  try {
+    std::lock_guard<std::mutex> lock(m_keyChainMutex);
+    refreshSigningCertificate();
+    segmentOverhead = m_segmentOverhead;
+  }
+  catch (const std::exception&) {
+    // The signing key may only be created later. A digest is smaller than any signature, so
+    // it gives a lower bound of the overhead.
+    ndn::Data probe = makeOverheadProbe();
+    {
+      std::lock_guard<std::mutex> lock(m_keyChainMutex);
+      m_keyChain->signWithSha256(probe);
+    }
+    segmentOverhead = probe.wireEncode().size() + 4;
+  }
+  if (m_linkMtu > 0 && m_linkMtu < segmentOverhead + MIN_PAYLOAD_LIMIT) {
+    throw Error("Invalid value for \"linkMtu\", which leaves no room for payload,"
+                " in \"query\" section");
+  }
+  if (m_linkMtu == 0 && m_segmentSize + segmentOverhead > MAX_SEGMENT_SIZE) {
+    throw Error("Invalid value for \"segmentSize\", which leaves no room for the rest of the"
+                " segment, in \"query\" section");
+  }
+  m_useNameTrie = useNameTrie;
+  m_autocompleteTopK = autocompleteTopK;
+  m_useFacetIndex = useFacetIndex;
+  m_serveStatus = serveStatus;
+  m_cache.reset(new util::SegmentCache(cacheMaxSize));
+  m_activeQueries.reset(new ActiveQueryTable(activeQueryShards, activeQueryMaxSize,
+                                             RESULT_FRESHNESS_PERIOD, executionTimeout));
+  util::ConnectionDetails mysqlId(dbServer, dbUser, dbPasswd, dbName);
+
+  if (minConnections > maxConnections) {
+    throw Error("\"minConnections\" exceeds \"maxConnections\""
+                " in \"query\" section");
+  }
+
+  setDatabaseHandler(mysqlId, minConnections, maxConnections);
+  setAsyncExecutor(mysqlId, asyncConnections, maxAsyncPending);
+  setThreadPool(nThreads, maxPendingQueries, nSigningThreads);
+  if (m_useNameTrie) {
+    scheduleNameTrieLoad();
+  }
+  if (m_useFacetIndex) {
+    scheduleFacetIndexLoad();
+  }
+  setFilters();
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::setFacetIndex(const std::shared_ptr<util::FacetIndex>& facetIndex)
+{
+  m_facetIndex = facetIndex;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::setThreadPool(size_t nThreads,
+                                             size_t maxPendingQueries,
+                                             size_t nSigningThreads)
+{
+  m_queryPool.reset(new util::ThreadPool(nThreads, maxPendingQueries));
+  if (nSigningThreads > 0) {
+    // each query keeps a few segments per signing thread in flight
+    m_signingPool.reset(new util::ThreadPool(nSigningThreads,
+                                             nThreads * nSigningThreads * 4));
+  }
+  else {
+    m_signingPool.reset();
+  }
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::setDatabaseHandler(const util::ConnectionDetails& databaseId,
+                                                  size_t minConnections,
+                                                  size_t maxConnections)
+{
+  //empty
+}
+
+template <>
+void
+QueryAdapter<MYSQL>::setDatabaseHandler(const util::ConnectionDetails& databaseId,
+                                        size_t minConnections,
+                                        size_t maxConnections)
+{
+  m_databasePool = std::make_shared<util::MySQLConnectionPool>(databaseId,
+                                                               minConnections,
+                                                               maxConnections);
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::setAsyncExecutor(const util::ConnectionDetails& databaseId,
+                                                size_t nConnections,
+                                                size_t maxPending)
+{
+  //empty
+}
+
+template <>
+void
+QueryAdapter<MYSQL>::setAsyncExecutor(const util::ConnectionDetails& databaseId,
+                                      size_t nConnections,
+                                      size_t maxPending)
+{
+  if (m_asyncExecutor) {
+    m_asyncExecutor->stop();
+    m_asyncExecutor.reset();
+  }
+  if (nConnections == 0) {
+    return;
+  }
+  if (!util::MySQLAsyncExecutor::isSupported()) {
+    throw Error("\"asyncConnections\" needs a MySQL client library with a non-blocking API,"
+                " such as MariaDB's");
+  }
+  // The executor only starts waiting queries when one of its own finishes, so it does not
+  // share its connections with the workers. They are all opened here, before the face runs,
+  // since opening one blocks until the server answers.
+  std::shared_ptr<util::MySQLConnectionPool> pool
+    = std::make_shared<util::MySQLConnectionPool>(databaseId, nConnections, nConnections);
+  // pings and reconnections go to the workers, which exist by the time queries run
+  m_asyncExecutor = std::make_shared<util::MySQLAsyncExecutor>(m_face->getIoService(), pool,
+    maxPending,
+    [this] (const std::function<void()>& task) {
+      return m_queryPool && m_queryPool->submit(task);
+    });
+}
+
+template <typename DatabaseHandler>
+QueryAdapter<DatabaseHandler>::~QueryAdapter()
+{
+  // results of the queries still in the database have nobody to go to
+  if (m_asyncExecutor) {
+    m_asyncExecutor->stop();
+  }
+  // workers use this adapter, so they must be done before anything is torn down. Query
+  // workers may wait for signing workers, which are stopped first so that nobody waits forever.
+  if (m_signingPool) {
+    m_signingPool->stop();
+  }
+  if (m_queryPool) {
+    m_queryPool->stop();
+  }
+
+  for (const auto& itr : m_registeredPrefixList) {
+    if (static_cast<bool>(itr.second))
+      m_face->unsetInterestFilter(itr.second);
+  }
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::onQueryInterest(const ndn::InterestFilter& filter,
+                                               const ndn::Interest& interest)
+{
+  // strictly enforce query initialization namespace.
+  // Name should be our local prefix + "query" + parameters
+  if (interest.getName().size() != filter.getPrefix().size() + 1) {
+    // @todo: return a nack
+    return;
+  }
+  std::shared_ptr<const ndn::Interest> interestPtr = interest.shared_from_this();
+  #ifndef NDEBUG
+    std::cout << "query interest : " << interestPtr->getName() << std::endl;
+  #endif
+  if (!m_queryPool) {
+    runJsonQuery(interestPtr);
+    return;
+  }
+  if (!m_queryPool->submit(bind(&QueryAdapter<DatabaseHandler>::runJsonQuery,
+                                this, interestPtr))) {
+    // @todo: return a nack, the consumer can retry later
+    m_stats.increment(QueryStats::COUNTER_DROPPED);
+  #ifndef NDEBUG
+    std::cout << "query dropped, too many pending queries : " << interestPtr->getName()
+              << std::endl;
+  #endif
+  }
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::onQueryResultsInterest(const ndn::InterestFilter& filter,
+                                                      const ndn::Interest& interest)
+{
+  // FIXME Results are currently getting served out of the forwarder's
+  // CS so we just ignore any retrieval Interests that hit us for
+  // now. In the future, this should check some form of
+  // InMemoryStorage.
+  #ifndef NDEBUG
+    std::cout << "query results interest : " << interest.toUri() << std::endl;
+  #endif
+  m_mutex.lock();
+  auto data = m_cache->find(interest.getName());
+  m_mutex.unlock();
+  if (data) {
+    m_face->put(*data);
+    return;
+  }
+
+  // Name should be our local prefix + "query-results" + version + segment
+  const ndn::Name& name = interest.getName();
+  if (!m_lazySegments || name.size() != m_prefix.size() + 3) {
+    return;
+  }
+  uint64_t segmentNo = 0;
+  try {
+    segmentNo = name[-1].toSegment();
+  }
+  catch (const ndn::Name::Component::Error&) {
+    return;
+  }
+  const ndn::Name segmentPrefix = name.getPrefix(-1);
+
+  std::shared_ptr<QueryCursor> cursor;
+  m_mutex.lock();
+  auto iter = m_cursors.find(segmentPrefix);
+  if (iter != m_cursors.end()) {
+    cursor = iter->second;
+  }
+  m_mutex.unlock();
+  if (cursor) {
+    requestSegment(segmentPrefix, cursor, segmentNo);
+  }
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::onStatusInterest(const ndn::InterestFilter& filter,
+                                                const ndn::Interest& interest)
+{
+  const ndn::time::steady_clock::TimePoint now = ndn::time::steady_clock::now();
+  if (m_status.empty() || now - m_statusTime >= STATUS_FRESHNESS_PERIOD) {
+    // This runs on the io thread, so a failure to sign must not escape
+    std::vector<std::shared_ptr<ndn::Data>> segments;
+    try {
+      Json::FastWriter fastWriter;
+      const std::string status = fastWriter.write(makeStatus());
+
+      ndn::Name versionPrefix(filter.getPrefix());
+      versionPrefix.appendVersion();
+      const size_t payloadLimit = std::max<size_t>(getPayloadLimit(), 1);
+      const uint64_t nSegments
+        = std::max<uint64_t>((status.size() + payloadLimit - 1) / payloadLimit, 1);
+      for (uint64_t segmentNo = 0; segmentNo < nSegments; ++segmentNo) {
+        const size_t offset = segmentNo * payloadLimit;
+        std::shared_ptr<ndn::Data> data
+          = std::make_shared<ndn::Data>(ndn::Name(versionPrefix).appendSegment(segmentNo));
+        data->setContent(reinterpret_cast<const uint8_t*>(status.data()) + offset,
+                         std::min(payloadLimit, status.size() - offset));
+        data->setFreshnessPeriod(STATUS_FRESHNESS_PERIOD);
+        data->setFinalBlockId(ndn::Name::Component::fromSegment(nSegments - 1));
+        signData(*data);
+        segments.push_back(data);
+      }
+    }
+    catch (const std::exception& e) {
+#ifndef NDEBUG
+      std::cout << "cannot make the status dataset : " << e.what() << std::endl;
+#endif
+      m_face->put(ndn::lp::Nack(interest));
+      return;
+    }
+    m_status.swap(segments);
+    m_statusTime = now;
+  }
+
+  // The bare prefix gets the first segment of the latest version, which names the others
+  if (interest.getName().size() == filter.getPrefix().size()) {
+    m_face->put(*m_status.front());
+    return;
+  }
+  for (const auto& data : m_status) {
+    if (interest.getName().isPrefixOf(data->getName())) {
+      m_face->put(*data);
+      return;
+    }
+  }
+  // a version that has been replaced, whose consumer starts over from the bare prefix
+  m_face->put(ndn::lp::Nack(interest));
+}
+
+template <typename DatabaseHandler>
+Json::Value
+QueryAdapter<DatabaseHandler>::makeStatus()
+{
+  Json::Value status = m_stats.toJson();
+
+  Json::Value& cache = status["cache"];
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cache["segments"] = Json::Value::UInt64(m_cache->size());
+    cache["usedSize"] = Json::Value::UInt64(m_cache->getUsedSize());
+    cache["maxSize"] = Json::Value::UInt64(m_cache->getMaxSize());
+    cache["hits"] = Json::Value::UInt64(m_cache->getNHits());
+    cache["misses"] = Json::Value::UInt64(m_cache->getNMisses());
+    cache["evictions"] = Json::Value::UInt64(m_cache->getNEvictions());
+    cache["cursors"] = Json::Value::UInt64(m_cursors.size());
+  }
+
+  Json::Value& database = status["database"];
+  database = Json::Value(Json::objectValue);
+  if (m_databasePool) {
+    database["connections"] = Json::Value::UInt64(m_databasePool->getSize());
+    database["idleConnections"] = Json::Value::UInt64(m_databasePool->getIdleSize());
+  }
+  if (m_asyncExecutor) {
+    database["asyncPending"] = Json::Value::UInt64(m_asyncExecutor->getNPending());
+    database["asyncRunning"] = Json::Value::UInt64(m_asyncExecutor->getNRunning());
+  }
+
+  Json::Value& workers = status["workers"];
+  workers = Json::Value(Json::objectValue);
+  if (m_queryPool) {
+    workers["threads"] = Json::Value::UInt64(m_queryPool->getNThreads());
+    workers["pending"] = Json::Value::UInt64(m_queryPool->getQueueSize());
+  }
+  if (m_signingPool) {
+    workers["signingThreads"] = Json::Value::UInt64(m_signingPool->getNThreads());
+    workers["signingPending"] = Json::Value::UInt64(m_signingPool->getQueueSize());
+  }
+  return status;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::requestSegment(const ndn::Name& segmentPrefix,
+                                              const std::shared_ptr<QueryCursor>& cursor,
+                                              uint64_t segmentNo)
+{
+  bool isEvicted = false;
+  {
+    std::lock_guard<std::mutex> lock(cursor->mutex);
+    cursor->lastUsed = ndn::time::steady_clock::now();
+    // Segments before nextSegmentNo have been generated already, so a miss means the cache has
+    // evicted them. They are generated again from where they started.
+    isEvicted = segmentNo < cursor->nextSegmentNo;
+    if (isEvicted) {
+      if (!cursor->regeneratingSegments.insert(segmentNo).second) {
+        // the Interest is answered with the running regeneration
+        return;
+      }
+    }
+    else if (cursor->isFinished) {
+      // beyond the final segment
+      return;
+    }
+    else {
+      cursor->requestedSegments.insert(segmentNo);
+      cursor->wantedSegmentNo = std::max(cursor->wantedSegmentNo, segmentNo + m_readAhead);
+      if (cursor->isGenerating) {
+        // the running generation picks up the new wanted segment
+        return;
+      }
+      cursor->isGenerating = true;
+    }
+  }
+
+  if (isEvicted) {
+    if (!m_queryPool) {
+      regenerateSegment(segmentPrefix, cursor, segmentNo);
+    }
+    else if (!m_queryPool->submit(bind(&QueryAdapter<DatabaseHandler>::regenerateSegment,
+                                       this, segmentPrefix, cursor, segmentNo))) {
+      std::lock_guard<std::mutex> lock(cursor->mutex);
+      cursor->regeneratingSegments.erase(segmentNo);
+    }
+    return;
+  }
+
+  if (!m_queryPool) {
+    generateSegments(segmentPrefix, cursor);
+    return;
+  }
+  if (!m_queryPool->submit(bind(&QueryAdapter<DatabaseHandler>::generateSegments,
+                                this, segmentPrefix, cursor))) {
+    // let the next Interest try again
+    std::lock_guard<std::mutex> lock(cursor->mutex);
+    cursor->isGenerating = false;
+  #ifndef NDEBUG
+    std::cout << "segment generation dropped, too many pending queries : " << segmentPrefix
+              << std::endl;
+  #endif
+  }
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::generateSegments(const ndn::Name& segmentPrefix,
+                                                const std::shared_ptr<QueryCursor>& cursor)
+{
+  bool isFetched = true;
+  std::unique_lock<std::mutex> lock(cursor->mutex);
+  while (!cursor->isFinished && cursor->nextSegmentNo <= cursor->wantedSegmentNo) {
+    // One more name than the wanted segments are estimated to hold tells whether there is more
+    const size_t limit = (cursor->wantedSegmentNo - cursor->nextSegmentNo + 1)
+                         * cursor->namesPerSegment + 1;
+    const std::string lastName = cursor->lastName;
+    uint64_t segmentNo = cursor->nextSegmentNo;
+    lock.unlock();
+
+    std::vector<std::string> names;
+    if (!fetchNames(cursor->sqlCondition, cursor->sqlValues, lastName, limit, names)) {
+      isFetched = false;
+      lock.lock();
+      break;
+    }
+    const bool isEnd = names.size() < limit;
+
+    // A segment is only cut when the next name does not fit, so a segment that is not final is
+    // always followed by another one. Names after the last cut are fetched again next time,
+    // unless the result ends here.
+    std::vector<std::shared_ptr<ndn::Data>> segments;
+    std::vector<std::string> segmentStarts(1, lastName);
+    QueryStats::Stopwatch encodeTime(m_stats, QueryStats::STAGE_SEGMENT_ENCODE);
+    SegmentEncoder encoder(cursor->isAutocomplete, cursor->payloadLimit, cursor->format);
+    size_t nPackedNames = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+      const size_t size = encoder.getAppendedSize(names[i]);
+      if (!encoder.empty() && encoder.getPayloadSize() + size > cursor->payloadLimit) {
+        segments.push_back(makeReplyData(segmentPrefix, encoder, segmentNo++, false));
+        segmentStarts.push_back(names[i - 1]);
+        nPackedNames = i;
+      }
+      encoder.append(names[i]);
+    }
+    if (isEnd) {
+      segments.push_back(makeReplyData(segmentPrefix, encoder, segmentNo++, true));
+      nPackedNames = names.size();
+    }
+    encodeTime.stop();
+
+    // Segments must be in the cache before the cursor moves past them, see requestSegment
+    cacheSegments(segments);
+
+    lock.lock();
+    if (segments.empty()) {
+      // not even one segment was filled, so the estimate is too small
+      cursor->namesPerSegment *= 2;
+      continue;
+    }
+    if (nPackedNames > 0) {
+      cursor->lastName = names[nPackedNames - 1];
+      cursor->namesPerSegment = std::max<size_t>(nPackedNames / segments.size(), 1);
+    }
+    cursor->segmentStarts.insert(cursor->segmentStarts.end(), segmentStarts.begin(),
+                                 segmentStarts.begin() + segments.size());
+    for (const auto& data : segments) {
+      uint64_t dataSegmentNo = data->getName()[-1].toSegment();
+      if (cursor->requestedSegments.erase(dataSegmentNo) > 0) {
+        sendData(data);
+      }
+    }
+    cursor->nextSegmentNo = segmentNo;
+    cursor->isFinished = isEnd;
+  }
+  // a finished cursor is kept until it is abandoned, to generate evicted segments again
+  cursor->isGenerating = false;
+  return isFetched;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::regenerateSegment(const ndn::Name& segmentPrefix,
+                                                 const std::shared_ptr<QueryCursor>& cursor,
+                                                 uint64_t segmentNo)
+{
+  std::unique_lock<std::mutex> lock(cursor->mutex);
+  const std::string lastName = cursor->segmentStarts[segmentNo];
+  size_t limit = cursor->namesPerSegment + 1;
+  lock.unlock();
+
+  // The segment ends where the next name does not fit, like it did when it was first generated
+  std::shared_ptr<ndn::Data> data;
+  while (!data) {
+    std::vector<std::string> names;
+    if (!fetchNames(cursor->sqlCondition, cursor->sqlValues, lastName, limit, names)) {
+      break;
+    }
+    const bool isEnd = names.size() < limit;
+
+    QueryStats::Stopwatch encodeTime(m_stats, QueryStats::STAGE_SEGMENT_ENCODE);
+    SegmentEncoder encoder(cursor->isAutocomplete, cursor->payloadLimit, cursor->format);
+    for (const auto& name : names) {
+      const size_t size = encoder.getAppendedSize(name);
+      if (!encoder.empty() && encoder.getPayloadSize() + size > cursor->payloadLimit) {
+        data = makeReplyData(segmentPrefix, encoder, segmentNo, false);
+        break;
+      }
+      encoder.append(name);
+    }
+    if (!data && isEnd) {
+      data = makeReplyData(segmentPrefix, encoder, segmentNo, true);
+    }
+    // not even one segment was filled
+    limit *= 2;
+  }
+  if (data) {
+    cacheSegment(*data);
+    sendData(data);
+  }
+
+  lock.lock();
+  cursor->regeneratingSegments.erase(segmentNo);
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::fetchNames(const std::string& sqlCondition,
+                                          const std::vector<std::string>& sqlValues,
+                                          const std::string& lastName,
+                                          size_t limit,
+                                          std::vector<std::string>& names)
+{
+  // empty
+  return false;
+}
+
+// fetchNames specilization function
+template<>
+bool
+QueryAdapter<MYSQL>::fetchNames(const std::string& sqlCondition,
+                                const std::vector<std::string>& sqlValues,
+                                const std::string& lastName,
+                                size_t limit,
+                                std::vector<std::string>& names)
+{
+  std::shared_ptr<MYSQL> connection = m_databasePool->acquire();
+  if (!connection) {
+    return false;
+  }
+
+  // Keyset pagination: the position is a name rather than an offset, so the server does not
+  // walk over the names that have been generated already. The position and the limit are
+  // bound like the conditions, so that all fetches of a cursor share one statement. Under a
+  // case-insensitive collation, names that only differ in case would compare equal, and pages
+  // from the facet index would be in another order, so the names are compared as bytes.
+  std::vector<atmos::util::MySQLValue> values(sqlValues.begin(), sqlValues.end());
+  std::stringstream sqlQuery;
+  sqlQuery << "SELECT name FROM cmip5 WHERE" << sqlCondition;
+  if (!lastName.empty()) {
+    sqlQuery << " AND name > BINARY ?";
+    values.push_back(lastName);
+  }
+  sqlQuery << " ORDER BY BINARY name LIMIT ?;";
+  values.push_back(static_cast<uint64_t>(limit));
+
+  QueryStats::Stopwatch executeTime(m_stats, QueryStats::STAGE_DB_EXECUTE);
+  std::shared_ptr<atmos::util::MySQLStatementResults> results
+    = atmos::util::MySQLPerformStatement(connection, sqlQuery.str(), values);
+  if (!results) {
+#ifndef NDEBUG
+    std::cout << "null results for query : " << sqlQuery.str() << std::endl;
+#endif
+    return false;
+  }
+
+  QueryStats::Stopwatch fetchTime(m_stats, QueryStats::STAGE_ROW_FETCH, false);
+  executeTime.handOver(fetchTime);
+  const char* const* row;
+  while ((row = results->fetchRow())) {
+    names.push_back(std::string(row[0], results->fetchLengths()[0]));
+  }
+  return !results->hasFailed();
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::readCatalogVersion(const std::shared_ptr<MYSQL>& connection,
+                                                  std::string& version)
+{
+  // empty
+  return false;
+}
+
+// readCatalogVersion specialization function
+template<>
+bool
+QueryAdapter<MYSQL>::readCatalogVersion(const std::shared_ptr<MYSQL>& connection,
+                                        std::string& version)
+{
+  std::shared_ptr<MYSQL_RES> results
+    = atmos::util::MySQLPerformQuery(connection, "SELECT COUNT(*), MAX(id) FROM cmip5;");
+  if (!results) {
+    return false;
+  }
+  MYSQL_ROW row = mysql_fetch_row(results.get());
+  if (!row) {
+    return false;
+  }
+  version = std::string(row[0] ? row[0] : "0") + "/" + (row[1] ? row[1] : "");
+  return true;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::loadNameTrie()
+{
+  // empty
+}
+
+// loadNameTrie specialization function
+template<>
+void
+QueryAdapter<MYSQL>::loadNameTrie()
+{
+  std::shared_ptr<MYSQL> connection = m_databasePool->acquire();
+  std::string version;
+  if (!connection || !readCatalogVersion(connection, version)) {
+#ifndef NDEBUG
+    std::cout << "cannot load the names for autocompletion" << std::endl;
+#endif
+    return;
+  }
+  if (m_isNameTrieLoaded && version == m_nameTrieVersion) {
+    return;
+  }
+
+  // streamed, since the whole catalog does not need to be held twice
+  std::shared_ptr<MYSQL_RES> results
+    = atmos::util::MySQLPerformStreamingQuery(connection, "SELECT name FROM cmip5;");
+  if (!results) {
+#ifndef NDEBUG
+    std::cout << "cannot load the names for autocompletion" << std::endl;
+#endif
+    return;
+  }
+
+  // the current trie keeps answering until the new one is complete
+  std::shared_ptr<util::NameTrie> nameTrie = std::make_shared<util::NameTrie>();
+  MYSQL_ROW row;
+  while ((row = mysql_fetch_row(results.get()))) {
+    nameTrie->insert(std::string(row[0], mysql_fetch_lengths(results.get())[0]));
+  }
+  // mysql_fetch_row also ends the rows when the connection is lost, and a partial trie would
+  // leave names out of completions
+  if (mysql_errno(connection.get()) != 0) {
+#ifndef NDEBUG
+    std::cout << "loading the names for autocompletion failed : "
+              << mysql_error(connection.get()) << std::endl;
+#endif
+    return;
+  }
+  std::atomic_store(&m_nameTrie, nameTrie);
+  m_nameTrieVersion = version;
+  m_isNameTrieLoaded = true;
+#ifndef NDEBUG
+  std::cout << "Loaded " << nameTrie->size() << " names for autocompletion" << std::endl;
+#endif
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::scheduleNameTrieLoad()
+{
+  scheduleLoad(m_isNameTrieLoading, m_nameTrieLoadTime, [this] { loadNameTrie(); });
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::prepareNextComponents(const ndn::Name& segmentPrefix,
+                                                     const std::string& prefix,
+                                                     const std::string& cursor,
+                                                     size_t pageSize,
+                                                     const ResultFormat& format)
+{
+  std::shared_ptr<util::NameTrie> nameTrie;
+  if (m_isNameTrieLoaded) {
+    nameTrie = std::atomic_load(&m_nameTrie);
+  }
+  else {
+    // The prefix is matched byte for byte like the trie does, rather than as a regular
+    // expression under the collation of the column
+    std::string pattern;
+    for (char c : prefix) {
+      if (c == '\\' || c == '%' || c == '_') {
+        pattern += '\\';
+      }
+      pattern += c;
+    }
+    pattern += '%';
+    std::vector<std::string> names;
+    if (!fetchNames(" name LIKE BINARY ?", std::vector<std::string>{pattern}, "", SIZE_MAX,
+                    names)) {
+      return false;
+    }
+    nameTrie = std::make_shared<util::NameTrie>();
+    for (const auto& name : names) {
+      nameTrie->insert(name);
+    }
+  }
+
+  std::vector<std::string> components
+    = m_autocompleteTopK > 0 ? nameTrie->findTopNextComponents(prefix, m_autocompleteTopK)
+                             : nameTrie->findNextComponents(prefix);
+  Json::Value pageInfo(Json::objectValue);
+  if (pageSize > 0) {
+    pageInfo["total"] = Json::Value::UInt64(components.size());
+    if (m_autocompleteTopK == 0) {
+      components.erase(std::remove_if(components.begin(), components.end(),
+                                      [&cursor] (const std::string& component) {
+                                        return component <= cursor;
+                                      }),
+                       components.end());
+      if (components.size() > pageSize) {
+        components.resize(pageSize);
+        pageInfo["cursor"] = components.back();
+      }
+    }
+  }
+  prepareNames(segmentPrefix, components, true, format, pageInfo);
+  return true;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::loadFacetIndex()
+{
+  // empty
+}
+
+// loadFacetIndex specialization function
+template<>
+void
+QueryAdapter<MYSQL>::loadFacetIndex()
+{
+  const std::vector<std::string>& columns = m_facetIndex->getColumns();
+  std::stringstream sqlQuery;
+  sqlQuery << "SELECT name";
+  for (const auto& column : columns) {
+    sqlQuery << ", " << column;
+  }
+  sqlQuery << " FROM cmip5;";
+
+  // The index has to match values as "column = ?" does, which depends on the collation of the
+  // columns, such as the case-insensitive default. Anything else is compared byte for byte.
+  std::stringstream sqlCollation;
+  sqlCollation << "SELECT COLLATION_NAME FROM information_schema.COLUMNS"
+               << " WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'cmip5'"
+               << " AND COLLATION_NAME LIKE '%\\_ci' AND COLUMN_NAME IN (";
+  for (size_t i = 0; i < columns.size(); ++i) {
+    sqlCollation << (i > 0 ? ", '" : "'") << columns[i] << "'";
+  }
+  sqlCollation << ");";
+
+  std::shared_ptr<MYSQL> connection = m_databasePool->acquire();
+  std::string version;
+  if (!connection || !readCatalogVersion(connection, version)) {
+#ifndef NDEBUG
+    std::cout << "cannot load the facet index" << std::endl;
+#endif
+    return;
+  }
+  if (m_facetIndex->isLoaded() && version == m_facetIndexVersion) {
+    return;
+  }
+  std::shared_ptr<MYSQL_RES> collations
+    = atmos::util::MySQLPerformQuery(connection, sqlCollation.str());
+  const bool isCaseInsensitive = !collations || mysql_num_rows(collations.get()) > 0;
+  collations.reset();
+
+  // publications that arrive while the rows are read make the index stale, see markLoaded
+  const uint64_t token = m_facetIndex->startLoading(isCaseInsensitive);
+  std::shared_ptr<MYSQL_RES> results
+    = atmos::util::MySQLPerformStreamingQuery(connection, sqlQuery.str());
+  if (!results) {
+#ifndef NDEBUG
+    std::cout << "cannot load the facet index" << std::endl;
+#endif
+    return;
+  }
+
+  MYSQL_ROW row;
+  std::vector<std::string> values(columns.size());
+  while ((row = mysql_fetch_row(results.get()))) {
+    const unsigned long* lengths = mysql_fetch_lengths(results.get());
+    for (size_t i = 0; i < columns.size(); ++i) {
+      values[i].assign(row[i + 1] ? row[i + 1] : "", lengths[i + 1]);
+    }
+    m_facetIndex->insert(std::string(row[0], lengths[0]), values);
+  }
+  // a partial index would leave datasets out of the results, so it stays unused
+  if (mysql_errno(connection.get()) != 0) {
+#ifndef NDEBUG
+    std::cout << "loading the facet index failed : " << mysql_error(connection.get())
+              << std::endl;
+#endif
+    return;
+  }
+  m_facetIndex->markLoaded(token);
+  m_facetIndexVersion = version;
+#ifndef NDEBUG
+  std::cout << "Loaded the facets of " << m_facetIndex->size() << " datasets" << std::endl;
+#endif
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::scheduleFacetIndexLoad()
+{
+  scheduleLoad(m_isFacetIndexLoading, m_facetIndexLoadTime, [this] { loadFacetIndex(); });
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::scheduleLoad(std::atomic<bool>& isLoading,
+                                            ndn::time::steady_clock::TimePoint& loadTime,
+                                            const std::function<void()>& load)
+{
+  if (!m_queryPool) {
+    return;
+  }
+  bool isRunning = false;
+  if (!isLoading.compare_exchange_strong(isRunning, true)) {
+    return;
+  }
+  // the catalog is not checked for every query, and a failing load is not retried for each
+  const ndn::time::steady_clock::TimePoint now = ndn::time::steady_clock::now();
+  if (now < loadTime ||
+      !m_queryPool->submit([&isLoading, load] {
+          load();
+          isLoading = false;
+        })) {
+    isLoading = false;
+    return;
+  }
+  loadTime = now + CATALOG_RELOAD_INTERVAL;
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::prepareFacetQuery(const ndn::Name& segmentPrefix,
+                                                 const Json::Value& query,
+                                                 const ResultFormat& format)
+{
+  util::FacetIndex::ConditionList conditions;
+  if (!json2Conditions(query, conditions)) {
+    return false;
+  }
+
+  // autocompletion and conditions on other columns, such as name, are left to the database
+  std::vector<std::string> names;
+  if (!m_facetIndex->find(conditions, names)) {
+    return false;
+  }
+  prepareNames(segmentPrefix, names, false, format);
+#ifndef NDEBUG
+  std::cout << "Query results from the facet index contain " << names.size() << " names"
+            << std::endl;
+#endif
+  return true;
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::json2Conditions(const Json::Value& query,
+                                               util::FacetIndex::ConditionList& conditions)
+{
+  if (!query.isObject()) {
+    return false;
+  }
+  for (Json::Value::const_iterator iter = query.begin(); iter != query.end(); ++iter) {
+    if (!(*iter).isString()) {
+      return false;
+    }
+    conditions.push_back(std::make_pair(iter.key().asString(), (*iter).asString()));
+  }
+  return true;
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::preparePage(const ndn::Name& segmentPrefix,
+                                           Json::Value query,
+                                           size_t pageSize,
+                                           const ResultFormat& format)
+{
+  const std::string cursor = query.isMember("cursor") ? query["cursor"].asString() : "";
+  query.removeMember("pageSize");
+  query.removeMember("cursor");
+
+  // One name more than the page tells whether there is another page
+  std::vector<std::string> names;
+  bool autocomplete = false;
+  bool hasTotal = false;
+  uint64_t total = 0;
+  util::FacetIndex::ConditionList conditions;
+  if (m_useFacetIndex && json2Conditions(query, conditions) &&
+      m_facetIndex->find(conditions, names)) {
+    // the index has all matches at hand, so their number comes for free
+    total = names.size();
+    hasTotal = true;
+    // std::string compares bytes, like fetchNames, so a cursor carries over between the two
+    names.erase(std::remove_if(names.begin(), names.end(),
+                               [&cursor] (const std::string& name) { return name <= cursor; }),
+                names.end());
+    const size_t nNames = std::min(names.size(), pageSize + 1);
+    std::partial_sort(names.begin(), names.begin() + nNames, names.end());
+    names.resize(nNames);
+  }
+  else {
+    std::stringstream sqlCondition;
+    std::vector<std::string> sqlValues;
+    if (json2SqlCondition(sqlCondition, sqlValues, query, autocomplete)) {
+      if (!fetchNames(sqlCondition.str(), sqlValues, cursor, pageSize + 1, names)) {
+        return false;
+      }
+      // Counting is a query of its own, so only the first page pays for it
+      if (cursor.empty()) {
+        hasTotal = countNames(sqlCondition.str(), sqlValues, total);
+      }
+    }
+    else {
+      // no condition, the result is the empty set
+      hasTotal = true;
+    }
+  }
+
+  Json::Value pageInfo(Json::objectValue);
+  if (names.size() > pageSize) {
+    names.resize(pageSize);
+    pageInfo["cursor"] = names.back();
+  }
+  if (hasTotal) {
+    pageInfo["total"] = Json::Value::UInt64(total);
+  }
+  prepareNames(segmentPrefix, names, autocomplete, format, pageInfo);
+  return true;
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::countNames(const std::string& sqlCondition,
+                                          const std::vector<std::string>& sqlValues,
+                                          uint64_t& count)
+{
+  // empty
+  return false;
+}
+
+// countNames specialization function
+template<>
+bool
+QueryAdapter<MYSQL>::countNames(const std::string& sqlCondition,
+                                const std::vector<std::string>& sqlValues,
+                                uint64_t& count)
+{
+  const std::string sqlQuery = "SELECT COUNT(*) FROM cmip5 WHERE" + sqlCondition + ";";
+  QueryStats::Stopwatch executeTime(m_stats, QueryStats::STAGE_DB_EXECUTE);
+  std::shared_ptr<atmos::util::MySQLStatementResults> results
+    = atmos::util::MySQLPerformStatement(m_databasePool->acquire(), sqlQuery,
+                                         std::vector<atmos::util::MySQLValue>(sqlValues.begin(),
+                                                                              sqlValues.end()));
+  if (!results) {
+#ifndef NDEBUG
+    std::cout << "null results for query : " << sqlQuery << std::endl;
+#endif
+    return false;
+  }
+
+  const char* const* row = results->fetchRow();
+  if (!row || !row[0]) {
+    return false;
+  }
+  count = std::stoull(row[0]);
+  return true;
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::prepareFacetCounts(const ndn::Name& segmentPrefix,
+                                                  const Json::Value& filter)
+{
+  util::FacetIndex::ConditionList conditions;
+  const bool isIndexed = json2Conditions(filter, conditions);
+
+  util::FacetIndex::FacetCounts counts;
+  if (!m_useFacetIndex || !isIndexed || !m_facetIndex->countValues(conditions, counts)) {
+    std::vector<std::string> columns;
+    for (const auto& column : m_facetIndex->getColumns()) {
+      if (!filter.isObject() || !filter.isMember(column)) {
+        columns.push_back(column);
+      }
+    }
+    bool autocomplete = false;
+    std::stringstream sqlCondition;
+    std::vector<std::string> sqlValues;
+    Json::Value sqlFilter = filter.isObject() ? filter : Json::Value(Json::objectValue);
+    json2SqlCondition(sqlCondition, sqlValues, sqlFilter, autocomplete);
+    counts.clear();
+    if (!fetchFacetCounts(sqlCondition.str(), sqlValues, columns, counts)) {
+      return false;
+    }
+  }
+
+  // Segments hold whole values, and a column may go on in the next segment
+  QueryStats::Stopwatch encodeTime(m_stats, QueryStats::STAGE_SEGMENT_ENCODE);
+  const size_t payloadLimit = getPayloadLimit();
+  // {"facets":{}} with the newline and the NUL
+  const size_t emptySize = 16;
+  std::vector<std::shared_ptr<ndn::Data>> segments;
+  Json::Value facets(Json::objectValue);
+  size_t payloadSize = emptySize;
+  for (const auto& column : counts) {
+    for (const auto& value : column.second) {
+      // "column":{"value":count}, both escaped
+      const size_t size
+        = SegmentEncoder::getEncodedSize(column.first.data(), column.first.size()) + 4 +
+          SegmentEncoder::getEncodedSize(value.first.data(), value.first.size()) + 1 +
+          std::to_string(value.second).size() + 1;
+      if (!facets.empty() && payloadSize + size > payloadLimit) {
+        segments.push_back(makeFacetData(segmentPrefix, facets, segments.size(), false));
+        facets = Json::Value(Json::objectValue);
+        payloadSize = emptySize;
+      }
+      facets[column.first][value.first] = Json::Value::UInt64(value.second);
+      payloadSize += size;
+    }
+  }
+  segments.push_back(makeFacetData(segmentPrefix, facets, segments.size(), true));
+  appendManifestData(segmentPrefix, segments);
+  encodeTime.stop();
+
+  cacheSegments(segments);
+  return true;
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::fetchFacetCounts(const std::string& sqlCondition,
+                                                const std::vector<std::string>& sqlValues,
+                                                const std::vector<std::string>& columns,
+                                                util::FacetIndex::FacetCounts& counts)
+{
+  // empty
+  return false;
+}
+
+// fetchFacetCounts specialization function
+template<>
+bool
+QueryAdapter<MYSQL>::fetchFacetCounts(const std::string& sqlCondition,
+                                      const std::vector<std::string>& sqlValues,
+                                      const std::vector<std::string>& columns,
+                                      util::FacetIndex::FacetCounts& counts)
+{
+  if (columns.empty()) {
+    return true;
+  }
+
+  // One grouped query for all columns instead of one per column. There are far fewer groups
+  // than datasets, and they are summed up per column here.
+  std::stringstream columnList;
+  for (size_t i = 0; i < columns.size(); ++i) {
+    columnList << (i > 0 ? ", " : "") << columns[i];
+  }
+  std::stringstream sqlQuery;
+  sqlQuery << "SELECT " << columnList.str() << ", COUNT(*) FROM cmip5";
+  if (!sqlCondition.empty()) {
+    sqlQuery << " WHERE" << sqlCondition;
+  }
+  sqlQuery << " GROUP BY " << columnList.str() << ";";
+
+  QueryStats::Stopwatch executeTime(m_stats, QueryStats::STAGE_DB_EXECUTE);
+  std::shared_ptr<atmos::util::MySQLStatementResults> results
+    = atmos::util::MySQLPerformStatement(m_databasePool->acquire(), sqlQuery.str(),
+                                         std::vector<atmos::util::MySQLValue>(sqlValues.begin(),
+                                                                              sqlValues.end()),
+                                         true);
+  if (!results) {
+#ifndef NDEBUG
+    std::cout << "null results for query : " << sqlQuery.str() << std::endl;
+#endif
+    return false;
+  }
+
+  QueryStats::Stopwatch fetchTime(m_stats, QueryStats::STAGE_ROW_FETCH, false);
+  executeTime.handOver(fetchTime);
+  const char* const* row;
+  while ((row = results->fetchRow())) {
+    const unsigned long* lengths = results->fetchLengths();
+    const uint64_t count = std::stoull(std::string(row[columns.size()],
+                                                   lengths[columns.size()]));
+    for (size_t i = 0; i < columns.size(); ++i) {
+      if (row[i]) {
+        counts[columns[i]][std::string(row[i], lengths[i])] += count;
+      }
+    }
+  }
+  // the rows are streamed, so a lost connection cuts the counts short
+  return !results->hasFailed();
+}
+
+template <typename DatabaseHandler>
+std::shared_ptr<ndn::Data>
+QueryAdapter<DatabaseHandler>::makeFacetData(const ndn::Name& segmentPrefix,
+                                             const Json::Value& facets,
+                                             uint64_t segmentNo,
+                                             bool isFinalBlock)
+{
+  Json::Value payload;
+  payload["facets"] = facets;
+  Json::FastWriter fastWriter;
+  const std::string payloadString = fastWriter.write(payload);
+
+  ndn::Name segmentName(segmentPrefix);
+  segmentName.appendSegment(segmentNo);
+  std::shared_ptr<ndn::Data> data = std::make_shared<ndn::Data>(segmentName);
+  // with the NUL of the C string, like the other query results
+  data->setContent(reinterpret_cast<const uint8_t*>(payloadString.c_str()),
+                   payloadString.size() + 1);
+  data->setFreshnessPeriod(RESULT_FRESHNESS_PERIOD);
+  if (isFinalBlock) {
+    data->setFinalBlockId(ndn::Name::Component::fromSegment(segmentNo));
+  }
+  if (m_signManifest) {
+    signDigest(*data);
+  }
+  else {
+    signData(*data);
+  }
+#ifndef NDEBUG
+  std::cout << "makeFacetData : " << segmentName << std::endl;
+#endif
+  return data;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::prepareNames(const ndn::Name& segmentPrefix,
+                                            const std::vector<std::string>& names,
+                                            bool autocomplete,
+                                            const ResultFormat& format,
+                                            const Json::Value& pageInfo)
+{
+  QueryStats::Stopwatch encodeTime(m_stats, QueryStats::STAGE_SEGMENT_ENCODE);
+  const size_t payloadLimit = getPayloadLimit();
+  SegmentEncoder encoder(autocomplete, payloadLimit, format);
+  std::vector<std::shared_ptr<ndn::Data>> segments;
+  uint64_t segmentNo = 0;
+  for (const auto& name : names) {
+    const size_t size = encoder.getAppendedSize(name);
+    if (!encoder.empty() && encoder.getPayloadSize() + size > payloadLimit) {
+      segments.push_back(makeReplyData(segmentPrefix, encoder, segmentNo++, false,
+                                       m_signManifest));
+    }
+    encoder.append(name);
+  }
+  if (!pageInfo.empty()) {
+    // a full segment may not have room for the page info
+    encoder.setPageInfo(pageInfo);
+    if (!encoder.empty() && encoder.getPayloadSize() > payloadLimit) {
+      encoder.setPageInfo(Json::Value(Json::objectValue));
+      segments.push_back(makeReplyData(segmentPrefix, encoder, segmentNo++, false,
+                                       m_signManifest));
+      encoder.setPageInfo(pageInfo);
+    }
+  }
+  segments.push_back(makeReplyData(segmentPrefix, encoder, segmentNo, true, m_signManifest));
+  appendManifestData(segmentPrefix, segments);
+  encodeTime.stop();
+
+  cacheSegments(segments);
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::signData(ndn::Data& data)
+{
+  // with the wait for the KeyChain, which other workers may be signing with
+  QueryStats::Stopwatch signTime(m_stats, QueryStats::STAGE_SIGN);
+  std::lock_guard<std::mutex> lock(m_keyChainMutex);
+  if (m_signingCertName.empty() ||
+      ndn::time::steady_clock::now() >= m_signingCertRefreshTime) {
+    refreshSigningCertificate();
+  }
+
+  try {
+    m_keyChain->sign(data, m_signingCertName);
+  }
+  catch (const std::exception&) {
+    // the certificate may have been replaced since it was looked up
+    refreshSigningCertificate();
+    m_keyChain->sign(data, m_signingCertName);
+  }
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::queueSegment(SigningQueue& queue,
+                                            const std::shared_ptr<ndn::Data>& data)
+{
+  std::shared_ptr<std::promise<void>> isSigned = std::make_shared<std::promise<void>>();
+  queue.push_back(std::make_pair(data, isSigned->get_future()));
+
+  // the signing threads still take turns on the injected KeyChain, but the query worker
+  // goes on encoding the next segments instead of waiting for them
+  bool isQueued = m_signingPool->submit([this, data, isSigned] {
+      try {
+        signData(*data);
+        isSigned->set_value();
+      }
+      catch (...) {
+        isSigned->set_exception(std::current_exception());
+      }
+    });
+  if (!isQueued) {
+    // the signing threads are busy with other queries
+    signData(*data);
+    isSigned->set_value();
+  }
+
+  drainSigningQueue(queue, 4 * m_signingPool->getNThreads());
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::drainSigningQueue(SigningQueue& queue, size_t maxPending)
+{
+  while (!queue.empty() &&
+         (queue.size() > maxPending ||
+          queue.front().second.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+    // rethrows what went wrong during signing
+    queue.front().second.get();
+    cacheSegment(*queue.front().first);
+    queue.pop_front();
+  }
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::refreshSigningCertificate()
+{
+  const ndn::Name identity = m_signingId.empty() ? m_keyChain->getDefaultIdentity()
+                                                 : m_signingId;
+  ndn::Name keyName = m_keyChain->getDefaultKeyNameForIdentity(identity);
+  if (m_hasSigningKeyType &&
+      m_keyChain->getPublicKey(keyName)->getKeyType() != m_signingKeyType) {
+    // the identity may keep a key of the configured type besides its default one
+    std::vector<ndn::Name> keyNames;
+    m_keyChain->getAllKeyNamesOfIdentity(identity, keyNames, false);
+    auto key = std::find_if(keyNames.begin(), keyNames.end(),
+                            [this] (const ndn::Name& name) {
+                              return m_keyChain->getPublicKey(name)->getKeyType()
+                                     == m_signingKeyType;
+                            });
+    if (key == keyNames.end()) {
+      throw Error("Identity " + identity.toUri() + " has no key for \"signingAlgorithm\"");
+    }
+    keyName = *key;
+  }
+
+  m_signingCertName = m_keyChain->getDefaultCertificateNameForKey(keyName);
+  m_signingCertRefreshTime = ndn::time::steady_clock::now() + SIGNING_CERT_REFRESH_INTERVAL;
+
+  // The overhead is measured on a probe signed like the segments
+  ndn::Data probe = makeOverheadProbe();
+  m_keyChain->sign(probe, m_signingCertName);
+  // the lengths of the Data and of its Content may each take 2 more bytes once there is payload
+  m_segmentOverhead = probe.wireEncode().size() + 4;
+}
+
+template <typename DatabaseHandler>
+ndn::Data
+QueryAdapter<DatabaseHandler>::makeOverheadProbe() const
+{
+  ndn::Name probeName(m_prefix);
+  probeName.append("query-results")
+           .appendVersion(ndn::time::toUnixTimestamp(ndn::time::system_clock::now()).count())
+           .appendSegment(UINT32_MAX);
+  ndn::Data probe(probeName);
+  probe.setFreshnessPeriod(RESULT_FRESHNESS_PERIOD);
+  probe.setFinalBlockId(probeName[-1]);
+  return probe;
+}
 
 template <typename DatabaseHandler>
-QueryAdapter<DatabaseHandler>::~QueryAdapter()
+size_t
+QueryAdapter<DatabaseHandler>::getPayloadLimit()
 {
-  for (const auto& itr : m_registeredPrefixList) {
-    if (static_cast<bool>(itr.second))
-      m_face->unsetInterestFilter(itr.second);
+  size_t segmentOverhead = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_keyChainMutex);
+    if (m_signingCertName.empty() ||
+        ndn::time::steady_clock::now() >= m_signingCertRefreshTime) {
+      refreshSigningCertificate();
+    }
+    segmentOverhead = m_segmentOverhead;
+  }
+
+  const size_t maxSegmentSize = m_linkMtu > 0 ? m_linkMtu : MAX_SEGMENT_SIZE;
+  size_t payloadLimit = maxSegmentSize > segmentOverhead ? maxSegmentSize - segmentOverhead : 0;
+  if (m_linkMtu == 0) {
+    payloadLimit = std::min(payloadLimit, m_segmentSize);
   }
+  // a segment that is too small for any name still gets one
+  return payloadLimit;
 }
 
 template <typename DatabaseHandler>
 void
-QueryAdapter<DatabaseHandler>::onQueryInterest(const ndn::InterestFilter& filter,
-                                               const ndn::Interest& interest)
+QueryAdapter<DatabaseHandler>::sendData(const std::shared_ptr<const ndn::Data>& data)
 {
-  // strictly enforce query initialization namespace.
-  // Name should be our local prefix + "query" + parameters
-  if (interest.getName().size() != filter.getPrefix().size() + 1) {
-    // @todo: return a nack
-    return;
-  }
-  std::shared_ptr<const ndn::Interest> interestPtr = interest.shared_from_this();
-  #ifndef NDEBUG
-    std::cout << "query interest : " << interestPtr->getName() << std::endl;
-  #endif
-  // @todo: use thread pool
-  std::thread queryThread(&QueryAdapter<DatabaseHandler>::runJsonQuery,
-                          this,
-                          interestPtr);
-  queryThread.join();
+  std::shared_ptr<ndn::Face> face = m_face;
+  m_face->getIoService().post([face, data] { face->put(*data); });
 }
 
 template <typename DatabaseHandler>
 void
-QueryAdapter<DatabaseHandler>::onQueryResultsInterest(const ndn::InterestFilter& filter,
-                                                      const ndn::Interest& interest)
+QueryAdapter<DatabaseHandler>::sendNack(const std::shared_ptr<const ndn::Interest>& interest)
 {
-  // FIXME Results are currently getting served out of the forwarder's
-  // CS so we just ignore any retrieval Interests that hit us for
-  // now. In the future, this should check some form of
-  // InMemoryStorage.
-  #ifndef NDEBUG
-    std::cout << "query results interest : " << interest.toUri() << std::endl;
-  #endif
-  auto data = m_cache.find(interest.getName());
-  if (data) {
-    m_face->put(*data);
-  }
+  std::shared_ptr<ndn::Face> face = m_face;
+  ndn::lp::Nack nack(*interest);
+  m_face->getIoService().post([face, nack] { face->put(nack); });
 }
 
 template <typename DatabaseHandler>
 void
-QueryAdapter<DatabaseHandler>::signData(ndn::Data& data)
+QueryAdapter<DatabaseHandler>::cacheSegment(const ndn::Data& data)
 {
-  if (m_signingId.empty())
-    m_keyChain->sign(data);
-  else {
-    ndn::Name keyName = m_keyChain->getDefaultKeyNameForIdentity(m_signingId);
-    ndn::Name certName = m_keyChain->getDefaultCertificateNameForKey(keyName);
-    m_keyChain->sign(data, certName);
+  // with the wait for the lock, which is what the workers contend for
+  QueryStats::Stopwatch insertTime(m_stats, QueryStats::STAGE_CACHE_INSERT);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_cache->insert(data);
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::cacheSegments(const std::vector<std::shared_ptr<ndn::Data>>& segments)
+{
+  QueryStats::Stopwatch insertTime(m_stats, QueryStats::STAGE_CACHE_INSERT);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& data : segments) {
+    m_cache->insert(*data);
   }
 }
 
@@ -392,6 +2620,12 @@ QueryAdapter<DatabaseHandler>::makeAckData(std::shared_ptr<const ndn::Interest>
   ackName.append("OK");
 
   std::shared_ptr<ndn::Data> ack = std::make_shared<ndn::Data>(ackName);
+  if (m_signManifest) {
+    // the manifest is where consumers start to check the segments
+    ndn::Name manifestName(m_prefix);
+    manifestName.append("query-results").append(version).append("manifest");
+    ack->setContent(manifestName.wireEncode());
+  }
   signData(*ack);
   #ifndef NDEBUG
     std::cout << "makeAckData : " << ackName << std::endl;
@@ -399,14 +2633,47 @@ QueryAdapter<DatabaseHandler>::makeAckData(std::shared_ptr<const ndn::Interest>
   return ack;
 }
 
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::sendActiveAck(std::shared_ptr<const ndn::Interest> interest,
+                                             std::shared_ptr<const ndn::Data> ack)
+{
+  // The ACK is named after the Interest, which may have written the same query differently
+  if (ack->getName().getPrefix(-2) == interest->getName()) {
+    sendData(ack);
+  }
+  else {
+    sendData(makeAckData(interest, ack->getName()[-2]));
+  }
+}
+
 template <typename DatabaseHandler>
 void
 QueryAdapter<DatabaseHandler>::json2Sql(std::stringstream& sqlQuery,
+                                        std::vector<std::string>& sqlValues,
                                         Json::Value& jsonValue,
                                         bool& autocomplete)
 {
   // 3) Convert the JSON Query into a MySQL one
   sqlQuery << "SELECT name FROM cmip5";
+  std::stringstream sqlCondition;
+  if (json2SqlCondition(sqlCondition, sqlValues, jsonValue, autocomplete)) {
+    sqlQuery << " WHERE" << sqlCondition.str();
+  }
+  else { // Force it to be the empty set
+    sqlQuery << " limit 0";
+  }
+  sqlQuery << ";";
+}
+
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::json2SqlCondition(std::stringstream& sqlCondition,
+                                                 std::vector<std::string>& sqlValues,
+                                                 Json::Value& jsonValue,
+                                                 bool& autocomplete)
+{
+  QueryStats::Stopwatch buildTime(m_stats, QueryStats::STAGE_SQL_BUILD);
   bool input = false;
   for (Json::Value::iterator iter = jsonValue.begin(); iter != jsonValue.end(); ++iter)
   {
@@ -414,35 +2681,39 @@ QueryAdapter<DatabaseHandler>::json2Sql(std::stringstream& sqlQuery,
     Json::Value value = (*iter);
 
     if (input) {
-      sqlQuery << " AND";
-    } else {
-      sqlQuery << " WHERE";
+      sqlCondition << " AND";
     }
 
     // Auto-complete case
     if (key.asString().compare("?") == 0) {
-      sqlQuery << " name REGEXP '^" << value.asString() << "'";
+      sqlCondition << " name REGEXP ?";
+      sqlValues.push_back("^" + value.asString());
       autocomplete = true;
     }
-    // Component case
+    // Component case, where the column comes from the consumer too and can only be quoted
     else {
-      sqlQuery << " " << key.asString() << "='" << value.asString() << "'";
+      std::string column = key.asString();
+      for (size_t i = column.find('`'); i != std::string::npos; i = column.find('`', i + 2)) {
+        column.insert(i, 1, '`');
+      }
+      sqlCondition << " `" << column << "`=?";
+      sqlValues.push_back(value.asString());
     }
     input = true;
   }
-
-  if (!input) { // Force it to be the empty set
-    sqlQuery << " limit 0";
-  }
-  sqlQuery << ";";
+  return input;
 }
 
 template <typename DatabaseHandler>
 void
 QueryAdapter<DatabaseHandler>::runJsonQuery(std::shared_ptr<const ndn::Interest> interest)
 {
+  m_stats.increment(QueryStats::COUNTER_QUERIES);
   // 1) Strip the prefix off the ndn::Interest's ndn::Name
   // +1 to grab JSON component after "query" component
+  QueryStats::Stopwatch nameParseTime(m_stats, QueryStats::STAGE_NAME_PARSE);
+  QueryStats::Stopwatch jsonParseTime(m_stats, QueryStats::STAGE_JSON_PARSE, false);
+  QueryStats::Stopwatch dedupTime(m_stats, QueryStats::STAGE_DEDUP, false);
 
   ndn::Name::Component jsonStr = interest->getName()[m_prefix.size()+1];
   // This one cannot parse the JsonQuery correctly, and should be moved to runJsonQuery
@@ -452,24 +2723,9 @@ QueryAdapter<DatabaseHandler>::runJsonQuery(std::shared_ptr<const ndn::Interest>
     // send Nack?
     return;
   }
-  // ------------------
-  // For efficiency, do a double check. Once without the lock, then with it.
-  if (m_activeQueryToFirstResponse.find(jsonQuery) != m_activeQueryToFirstResponse.end()) {
-    m_mutex.lock();
-    { // !!! BEGIN CRITICAL SECTION !!!
-      // If this fails upon locking, we removed it during our search.
-      // An unusual race-condition case, which requires things like PIT aggregation to be off.
-      auto iter = m_activeQueryToFirstResponse.find(jsonQuery);
-      if (iter != m_activeQueryToFirstResponse.end()) {
-        m_face->put(*(iter->second));
-        m_mutex.unlock(); //escape lock
-        return;
-      }
-    } // !!!  END  CRITICAL SECTION !!!
-    m_mutex.unlock();
-  }
 
   // 2) From the remainder of the ndn::Interest's ndn::Name, get the JSON out
+  nameParseTime.handOver(jsonParseTime);
   Json::Value parsedFromString;
   Json::Reader reader;
   if (!reader.parse(jsonQuery, parsedFromString)) {
@@ -477,6 +2733,91 @@ QueryAdapter<DatabaseHandler>::runJsonQuery(std::shared_ptr<const ndn::Interest>
     std::cout << "cannot parse the JsonQuery" << std::endl;
     return;
   }
+  // Facet counts are results of their own, so they are kept apart from those of the same filter
+  const bool isFacetQuery = interest->getName()[m_prefix.size()] == ndn::Name::Component("facets");
+  // A page of the results is asked for with "pageSize", and the next one with the "cursor" that
+  // came with the previous page
+  size_t pageSize = 0;
+  if (!isFacetQuery && parsedFromString.isObject() && parsedFromString.isMember("pageSize")) {
+    const Json::Value& value = parsedFromString["pageSize"];
+    if (value.isString()) {
+      // only digits, since stoul takes a leading '-' and wraps the number around
+      const std::string pageSizeString = value.asString();
+      if (!pageSizeString.empty() &&
+          std::all_of(pageSizeString.begin(), pageSizeString.end(),
+                      [] (char c) { return c >= '0' && c <= '9'; })) {
+        try {
+          pageSize = std::stoul(pageSizeString);
+        }
+        catch (const std::out_of_range&) {
+          pageSize = m_maxPageSize;
+        }
+      }
+    }
+    else if (value.isUInt()) {
+      pageSize = value.asUInt();
+    }
+    if (pageSize == 0) {
+#ifndef NDEBUG
+      std::cout << "invalid pageSize in the JsonQuery" << std::endl;
+#endif
+      sendNack(interest);
+      return;
+    }
+    // a larger page comes with a cursor to the rest, like any other page
+    pageSize = std::min(pageSize, m_maxPageSize);
+  }
+  // Results are compressed if the consumer asks for it with "compress"
+  ResultFormat format;
+  if (!isFacetQuery && parsedFromString.isObject() && parsedFromString.isMember("compress")) {
+    if (parsedFromString["compress"] != Json::Value("zlib")) {
+#ifndef NDEBUG
+      std::cout << "unsupported compress in the JsonQuery" << std::endl;
+#endif
+      sendNack(interest);
+      return;
+    }
+    format.isCompressed = true;
+  }
+  // Harvesting clients ask for "format":"tlv" to get names without JSON to parse
+  if (!isFacetQuery && parsedFromString.isObject() && parsedFromString.isMember("format")) {
+    const Json::Value& value = parsedFromString["format"];
+    if (value == Json::Value("tlv")) {
+      format.isBinary = true;
+    }
+    else if (value != Json::Value("json")) {
+#ifndef NDEBUG
+      std::cout << "unsupported format in the JsonQuery" << std::endl;
+#endif
+      sendNack(interest);
+      return;
+    }
+  }
+  if (isFacetQuery) {
+    Json::Value facetQuery;
+    facetQuery["facets"] = parsedFromString;
+    parsedFromString = facetQuery;
+  }
+  // Clients write the same query with keys in different orders, so queries are told apart by
+  // their canonical form rather than by the raw string
+  const QueryKey key(parsedFromString);
+
+  // ------------------
+  // Only the first Interest for a query runs it. Those that come while it runs wait for it to
+  // finish, and those that come later get its ACK right away.
+  jsonParseTime.handOver(dedupTime);
+  bool isWaiting = false;
+  std::shared_ptr<const ndn::Data> activeAck = m_activeQueries->join(key, interest, isWaiting);
+  dedupTime.stop();
+  if (activeAck) {
+    m_stats.increment(QueryStats::COUNTER_COALESCED);
+    sendActiveAck(interest, activeAck);
+    return;
+  }
+  if (isWaiting) {
+    m_stats.increment(QueryStats::COUNTER_COALESCED);
+    return;
+  }
 
   const ndn::name::Component version
     = ndn::name::Component::fromVersion(ndn::time::toUnixTimestamp(
@@ -484,126 +2825,474 @@ QueryAdapter<DatabaseHandler>::runJsonQuery(std::shared_ptr<const ndn::Interest>
 
   std::shared_ptr<ndn::Data> ack = makeAckData(interest, version);
 
-  m_mutex.lock();
-  { // !!! BEGIN CRITICAL SECTION !!!
-    // An unusual race-condition case, which requires things like PIT aggregation to be off.
-    auto iter = m_activeQueryToFirstResponse.find(jsonQuery);
-    if (iter != m_activeQueryToFirstResponse.end()) {
-      m_face->put(*(iter->second));
-      m_mutex.unlock(); // escape lock
-      return;
+  // An unusual race-condition case, which requires things like PIT aggregation to be off.
+  // The other execution answers this Interest too.
+  dedupTime.start();
+  activeAck = m_activeQueries->insert(key, ack);
+  if (activeAck) {
+    activeAck = m_activeQueries->join(key, interest, isWaiting);
+    dedupTime.stop();
+    m_stats.increment(QueryStats::COUNTER_COALESCED);
+    if (activeAck) {
+      sendActiveAck(interest, activeAck);
     }
-    // This is where things are expensive so we save them for the lock
-    m_activeQueryToFirstResponse.insert(std::pair<std::string,
-                                        std::shared_ptr<ndn::Data>>(jsonQuery, ack));
-    m_face->put(*ack);
-  } // !!!  END  CRITICAL SECTION !!!
-  m_mutex.unlock();
-
-  // 3) Convert the JSON Query into a MySQL one
-  bool autocomplete = false;
-  std::stringstream sqlQuery;
-  json2Sql(sqlQuery, parsedFromString, autocomplete);
+    return;
+  }
+  dedupTime.stop();
+  sendData(ack);
 
-  // 4) Run the Query
+  Json::Value query = key.getQuery();
+  query.removeMember("compress");
+  query.removeMember("format");
   ndn::Name segmentPrefix(m_prefix);
   segmentPrefix.append("query-results");
   segmentPrefix.append(version);
 
-  prepareSegments(segmentPrefix, sqlQuery.str(), autocomplete);
+  m_stats.increment(QueryStats::COUNTER_EXECUTIONS);
+  executeQuery(segmentPrefix, query, isFacetQuery, pageSize, format,
+               bind(&QueryAdapter<DatabaseHandler>::finishQuery, this, key,
+                    std::shared_ptr<const ndn::Data>(ack), interest, _1));
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::finishQuery(const QueryKey& key,
+                                           const std::shared_ptr<const ndn::Data>& ack,
+                                           const std::shared_ptr<const ndn::Interest>& interest,
+                                           bool isDone)
+{
+  if (!isDone) {
+    // the query runs again when it is next asked for, which the NACK tells waiting consumers
+    // to do. The first consumer has its ACK already, and finds no results under it.
+    m_stats.increment(QueryStats::COUNTER_FAILURES);
+    const ActiveQueryTable::InterestList interests = m_activeQueries->erase(key, ack);
+    for (const auto& waitingInterest : interests) {
+      sendNack(waitingInterest);
+    }
+#ifndef NDEBUG
+    std::cout << "query failed, " << interests.size() << " waiting Interests NACKed : "
+              << interest->getName() << std::endl;
+#endif
+    return;
+  }
+  for (const auto& waitingInterest : m_activeQueries->markReady(key, ack)) {
+    sendActiveAck(waitingInterest, ack);
+  }
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::executeQuery(const ndn::Name& segmentPrefix,
+                                            Json::Value& query,
+                                            bool isFacetQuery,
+                                            size_t pageSize,
+                                            const ResultFormat& format,
+                                            const DoneCallback& onDone)
+{
+  // Whatever throws fails the query, so that the Interests waiting for it get their NACK,
+  // unless the query has been reported done already
+  std::shared_ptr<std::atomic<bool>> isReported = std::make_shared<std::atomic<bool>>(false);
+  DoneCallback reportOnce = [onDone, isReported] (bool isDone) {
+    if (!isReported->exchange(true)) {
+      onDone(isDone);
+    }
+  };
+  try {
+    runQuery(segmentPrefix, query, isFacetQuery, pageSize, format, reportOnce);
+  }
+  catch (const std::exception& e) {
+#ifndef NDEBUG
+    std::cout << "query failed : " << e.what() << std::endl;
+#endif
+    reportOnce(false);
+  }
+  catch (...) {
+    reportOnce(false);
+  }
 }
 
 template <typename DatabaseHandler>
 void
+QueryAdapter<DatabaseHandler>::runQuery(const ndn::Name& segmentPrefix,
+                                        Json::Value& query,
+                                        bool isFacetQuery,
+                                        size_t pageSize,
+                                        const ResultFormat& format,
+                                        const DoneCallback& onDone)
+{
+  // until they are loaded again, the database answers what the trie and the index would
+  if (m_useNameTrie) {
+    scheduleNameTrieLoad();
+  }
+  if (m_useFacetIndex) {
+    scheduleFacetIndexLoad();
+  }
+
+  if (isFacetQuery) {
+    onDone(prepareFacetCounts(segmentPrefix, query["facets"]));
+    return;
+  }
+
+  // Autocompletion of a bare prefix lists the distinct next components, which are answered
+  // from memory once the names are loaded, since MySQL cannot use an index for them
+  if (m_useNameTrie && query.isMember("?") &&
+      query.size() == 1u + query.isMember("pageSize") + query.isMember("cursor")) {
+    onDone(prepareNextComponents(segmentPrefix, query["?"].asString(),
+                                 query.isMember("cursor") ? query["cursor"].asString() : "",
+                                 pageSize, format));
+    return;
+  }
+
+  if (pageSize > 0) {
+    onDone(preparePage(segmentPrefix, query, pageSize, format));
+    return;
+  }
+
+  // Equality conditions on the facet columns are answered by intersecting bitmaps in memory
+  if (m_useFacetIndex && prepareFacetQuery(segmentPrefix, query, format)) {
+    onDone(true);
+    return;
+  }
+
+  if (!m_lazySegments) {
+    // 3) Convert the JSON Query into a MySQL one
+    bool autocomplete = false;
+    std::stringstream sqlQuery;
+    std::vector<std::string> sqlValues;
+    json2Sql(sqlQuery, sqlValues, query, autocomplete);
+
+    // 4) Run the Query. Streamed results hold their connection while the rows are fetched, which
+    // the non-blocking API cannot do, so those stay on the worker.
+    if (m_asyncExecutor && !m_streamResults) {
+      prepareSegmentsAsync(segmentPrefix, sqlQuery.str(), sqlValues, autocomplete, format,
+                           onDone);
+    }
+    else {
+      onDone(prepareSegments(segmentPrefix, sqlQuery.str(), sqlValues, autocomplete, format));
+    }
+    return;
+  }
+
+  // Segments are generated on demand, so only the conditions are needed to set up the cursor
+  bool autocomplete = false;
+  std::stringstream sqlCondition;
+  std::vector<std::string> sqlValues;
+  if (!json2SqlCondition(sqlCondition, sqlValues, query, autocomplete)) {
+    // nothing to fetch, the empty result is a single segment
+    SegmentEncoder encoder(autocomplete, getPayloadLimit(), format);
+    std::shared_ptr<ndn::Data> data = makeReplyData(segmentPrefix, encoder, 0, true);
+    cacheSegment(*data);
+    onDone(true);
+    return;
+  }
+  std::shared_ptr<QueryCursor> cursor = std::make_shared<QueryCursor>(sqlCondition.str(),
+                                                                      sqlValues,
+                                                                      autocomplete,
+                                                                      getPayloadLimit(),
+                                                                      format);
+  // The first segments are generated right away on this worker, since the consumer asks for
+  // them next
+  cursor->wantedSegmentNo = m_readAhead;
+  cursor->isGenerating = true;
+  m_mutex.lock();
+  { // !!! BEGIN CRITICAL SECTION !!!
+    // Drop the cursors of abandoned queries
+    const ndn::time::steady_clock::TimePoint now = ndn::time::steady_clock::now();
+    for (auto iter = m_cursors.begin(); iter != m_cursors.end();) {
+      std::lock_guard<std::mutex> cursorLock(iter->second->mutex);
+      if (!iter->second->isGenerating && now - iter->second->lastUsed > CURSOR_LIFETIME) {
+        iter = m_cursors.erase(iter);
+      }
+      else {
+        ++iter;
+      }
+    }
+    m_cursors[segmentPrefix] = cursor;
+  } // !!!  END  CRITICAL SECTION !!!
+  m_mutex.unlock();
+
+  // Later segments are generated as they are asked for, so the query is ready once the first
+  // ones are. If those cannot be fetched, the query has failed and nothing is served under it.
+  if (!generateSegments(segmentPrefix, cursor)) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_cursors.erase(segmentPrefix);
+    }
+    onDone(false);
+    return;
+  }
+  onDone(true);
+}
+
+template <typename DatabaseHandler>
+bool
 QueryAdapter<DatabaseHandler>::prepareSegments(const ndn::Name& segmentPrefix,
                                                const std::string& sqlString,
-                                               bool autocomplete)
+                                               const std::vector<std::string>& sqlValues,
+                                               bool autocomplete,
+                                               const ResultFormat& format)
 {
   // empty
+  return true;
 }
 
 // prepareSegments specilization function
 template<>
-void
+bool
 QueryAdapter<MYSQL>::prepareSegments(const ndn::Name& segmentPrefix,
                                      const std::string& sqlString,
-                                     bool autocomplete)
+                                     const std::vector<std::string>& sqlValues,
+                                     bool autocomplete,
+                                     const ResultFormat& format)
 {
 #ifndef NDEBUG
   std::cout << "sqlString in prepareSegments : " << sqlString << std::endl;
 #endif
   // 4) Run the Query
-  std::shared_ptr<MYSQL_RES> results
-    = atmos::util::MySQLPerformQuery(m_databaseHandler, sqlString);
-
+  // Stored results are complete on the client side, so the connection goes back to the pool as
+  // soon as the query returns. Streamed results keep it until the last row has been fetched.
+  QueryStats::Stopwatch executeTime(m_stats, QueryStats::STAGE_DB_EXECUTE);
+  std::shared_ptr<atmos::util::MySQLStatementResults> results
+    = atmos::util::MySQLPerformStatement(m_databasePool->acquire(), sqlString,
+                                         std::vector<atmos::util::MySQLValue>(sqlValues.begin(),
+                                                                              sqlValues.end()),
+                                         m_streamResults);
   if (!results) {
 #ifndef NDEBUG
-    std::cout << "null MYSQL_RES for query : " << sqlString << std::endl;
+    std::cout << "null results for query : " << sqlString << std::endl;
 #endif
-    // @todo: throw runtime error or log the error message?
-    return;
+    return false;
   }
+  executeTime.stop();
+  return publishResults(segmentPrefix, sqlString,
+    [&results] (const char*& name, size_t& length) {
+      const char* const* row = results->fetchRow();
+      if (!row) {
+        return false;
+      }
+      name = row[0];
+      length = results->fetchLengths()[0];
+      return true;
+    },
+    [&results] { return results->hasFailed(); },
+    autocomplete, format);
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::prepareSegmentsAsync(const ndn::Name& segmentPrefix,
+                                                    const std::string& sqlString,
+                                                    const std::vector<std::string>& sqlValues,
+                                                    bool autocomplete,
+                                                    const ResultFormat& format,
+                                                    const DoneCallback& onDone)
+{
+  onDone(prepareSegments(segmentPrefix, sqlString, sqlValues, autocomplete, format));
+}
 
+template<>
+void
+QueryAdapter<MYSQL>::prepareSegmentsAsync(const ndn::Name& segmentPrefix,
+                                          const std::string& sqlString,
+                                          const std::vector<std::string>& sqlValues,
+                                          bool autocomplete,
+                                          const ResultFormat& format,
+                                          const DoneCallback& onDone)
+{
 #ifndef NDEBUG
-  std::cout << "Query results for \""
-            << sqlString
-            << "\" contain "
-            << mysql_num_rows(results.get())
-            << " rows" << std::endl;
+  std::cout << "sqlString in prepareSegmentsAsync : " << sqlString << std::endl;
+#endif
+  // The results arrive on the io thread, which must not be held up by signing
+  const ResultFormat resultFormat = format;
+  // with the wait for a connection of the executor, since no worker is held up meanwhile
+  const QueryStats::Clock::time_point startTime = QueryStats::Clock::now();
+  const bool isQueued = m_asyncExecutor->execute(sqlString,
+    std::vector<atmos::util::MySQLValue>(sqlValues.begin(), sqlValues.end()),
+    [this, segmentPrefix, sqlString, autocomplete, resultFormat, onDone, startTime]
+    (const std::shared_ptr<MYSQL_RES>& results) {
+      m_stats.record(QueryStats::STAGE_DB_EXECUTE, QueryStats::Clock::now() - startTime);
+      if (!results) {
+#ifndef NDEBUG
+        std::cout << "null MYSQL_RES for query : " << sqlString << std::endl;
+#endif
+        onDone(false);
+        return;
+      }
+      auto publish = [this, segmentPrefix, sqlString, results, autocomplete, resultFormat,
+                      onDone] {
+        // this runs on its own, after executeQuery has returned, so it catches what it throws
+        bool isDone = false;
+        try {
+          isDone = publishResults(segmentPrefix, sqlString,
+            [&results] (const char*& name, size_t& length) {
+              MYSQL_ROW row = mysql_fetch_row(results.get());
+              if (!row) {
+                return false;
+              }
+              name = row[0];
+              length = mysql_fetch_lengths(results.get())[0];
+              return true;
+            },
+            // stored on the client side, so reading them cannot fail
+            [] { return false; },
+            autocomplete, resultFormat);
+        }
+        catch (const std::exception& e) {
+#ifndef NDEBUG
+          std::cout << "publishing the results failed : " << e.what() << std::endl;
+#endif
+        }
+        catch (...) {
+        }
+        onDone(isDone);
+      };
+      if (!m_queryPool) {
+        publish();
+      }
+      else if (!m_queryPool->submit(publish)) {
+        onDone(false);
+      }
+    });
+  if (!isQueued) {
+#ifndef NDEBUG
+    std::cout << "query dropped, too many queries wait for the database : " << sqlString
+              << std::endl;
 #endif
+    onDone(false);
+  }
+}
 
-  MYSQL_ROW row;
-  size_t usedBytes = 0;
-  const size_t PAYLOAD_LIMIT = 7000;
+template <typename DatabaseHandler>
+bool
+QueryAdapter<DatabaseHandler>::publishResults(const ndn::Name& segmentPrefix,
+                                              const std::string& sqlString,
+                                              const NameReader& fetchName,
+                                              const ReadChecker& hasFailed,
+                                              bool autocomplete,
+                                              const ResultFormat& format)
+{
+  const char* name = NULL;
+  size_t length = 0;
   uint64_t segmentNo = 0;
-  Json::Value array;
-  while ((row = mysql_fetch_row(results.get())))
+  uint64_t nRows = 0;
+  const size_t payloadLimit = getPayloadLimit();
+  // names go from the row buffers straight into the Content of the segments
+  SegmentEncoder encoder(autocomplete, payloadLimit, format);
+  std::vector<ndn::name::Component> digests;
+  // Segments covered by a manifest only need a digest, which is not worth another thread
+  const bool isSignedInParallel = m_signingPool && !m_signManifest;
+  SigningQueue signingQueue;
+  // Reading a row and putting it into a segment alternate, so the time goes to one or the other
+  QueryStats::Stopwatch fetchTime(m_stats, QueryStats::STAGE_ROW_FETCH);
+  QueryStats::Stopwatch encodeTime(m_stats, QueryStats::STAGE_SEGMENT_ENCODE, false);
+  // Each segment goes into the cache as soon as it is full, so that consumers can fetch it while
+  // the remaining rows are still being read
+  while (fetchName(name, length))
   {
-    size_t size = strlen(row[0]) + 1;
-    if (usedBytes + size > PAYLOAD_LIMIT) {
-      std::shared_ptr<ndn::Data> data
-        = makeReplyData(segmentPrefix, array, segmentNo, false, autocomplete);
-      m_mutex.lock();
-      m_cache.insert(*data);
-      m_mutex.unlock();
-      array.clear();
-      usedBytes = 0;
+    fetchTime.handOver(encodeTime);
+    ++nRows;
+    const size_t size = encoder.getAppendedSize(name, length);
+    if (!encoder.empty() && encoder.getPayloadSize() + size > payloadLimit) {
+      if (isSignedInParallel) {
+        queueSegment(signingQueue,
+                     makeUnsignedReplyData(segmentPrefix, encoder, segmentNo, false));
+      }
+      else {
+        std::shared_ptr<ndn::Data> data
+          = makeReplyData(segmentPrefix, encoder, segmentNo, false, m_signManifest);
+        if (m_signManifest) {
+          digests.push_back(data->getFullName().get(-1));
+        }
+        cacheSegment(*data);
+      }
       segmentNo++;
     }
-    array.append(row[0]);
-    usedBytes += size;
+    encoder.append(name, length);
+    encodeTime.handOver(fetchTime);
   }
-  std::shared_ptr<ndn::Data> data
-    = makeReplyData(segmentPrefix, array, segmentNo, true, autocomplete);
-  m_mutex.lock();
-  m_cache.insert(*data);
-  m_mutex.unlock();
+  if (hasFailed()) {
+    // a truncated result must not look complete, so it gets no final segment and the query is
+    // dropped
+#ifndef NDEBUG
+    std::cout << "fetching the rows failed after " << nRows << " rows for query : " << sqlString
+              << std::endl;
+#endif
+    return false;
+  }
+  fetchTime.handOver(encodeTime);
+  if (isSignedInParallel) {
+    queueSegment(signingQueue, makeUnsignedReplyData(segmentPrefix, encoder, segmentNo, true));
+    // the final segment enters the cache last
+    drainSigningQueue(signingQueue, 0);
+  }
+  else {
+    std::shared_ptr<ndn::Data> data
+      = makeReplyData(segmentPrefix, encoder, segmentNo, true, m_signManifest);
+    cacheSegment(*data);
+    if (m_signManifest) {
+      digests.push_back(data->getFullName().get(-1));
+    }
+  }
+
+  if (m_signManifest) {
+    std::vector<std::shared_ptr<ndn::Data>> manifest = makeManifestData(segmentPrefix, digests);
+    cacheSegments(manifest);
+  }
+  encodeTime.stop();
+
+#ifndef NDEBUG
+  std::cout << "Query results for \""
+            << sqlString
+            << "\" contain "
+            << nRows
+            << " rows" << std::endl;
+#endif
+  return true;
 }
 
 template <typename DatabaseHandler>
 std::shared_ptr<ndn::Data>
 QueryAdapter<DatabaseHandler>::makeReplyData(const ndn::Name& segmentPrefix,
-                                             const Json::Value& value,
+                                             SegmentEncoder& encoder,
                                              uint64_t segmentNo,
                                              bool isFinalBlock,
-                                             bool isAutocomplete)
+                                             bool isInManifest)
+{
+  std::shared_ptr<ndn::Data> data = makeUnsignedReplyData(segmentPrefix, encoder, segmentNo,
+                                                          isFinalBlock);
+  if (isInManifest) {
+    signDigest(*data);
+  }
+  else {
+    signData(*data);
+  }
+  return data;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::signDigest(ndn::Data& data)
+{
+  // the digest is what the manifest vouches for, so there is no need for a key, but the
+  // KeyChain still cannot sign on two threads at once
+  QueryStats::Stopwatch signTime(m_stats, QueryStats::STAGE_SIGN);
+  std::lock_guard<std::mutex> lock(m_keyChainMutex);
+  m_keyChain->signWithSha256(data);
+}
+
+template <typename DatabaseHandler>
+std::shared_ptr<ndn::Data>
+QueryAdapter<DatabaseHandler>::makeUnsignedReplyData(const ndn::Name& segmentPrefix,
+                                                     SegmentEncoder& encoder,
+                                                     uint64_t segmentNo,
+                                                     bool isFinalBlock)
 {
-  Json::Value entry;
-  Json::FastWriter fastWriter;
-  if (isAutocomplete) {
-    entry["next"] = value;
-  } else {
-    entry["results"] = value;
-  }
-  const std::string jsonMessage = fastWriter.write(entry);
-  const char* payload = jsonMessage.c_str();
-  size_t payloadLength = jsonMessage.size() + 1;
   ndn::Name segmentName(segmentPrefix);
   segmentName.appendSegment(segmentNo);
 
   std::shared_ptr<ndn::Data> data = std::make_shared<ndn::Data>(segmentName);
-  data->setContent(reinterpret_cast<const uint8_t*>(payload), payloadLength);
-  data->setFreshnessPeriod(ndn::time::milliseconds(10000));
+  data->setContent(encoder.finish());
+  data->setFreshnessPeriod(RESULT_FRESHNESS_PERIOD);
 
   if (isFinalBlock) {
     data->setFinalBlockId(ndn::Name::Component::fromSegment(segmentNo));
@@ -611,10 +3300,68 @@ QueryAdapter<DatabaseHandler>::makeReplyData(const ndn::Name& segmentPrefix,
 #ifndef NDEBUG
   std::cout << "makeReplyData : " << segmentName << std::endl;
 #endif
-  signData(*data);
   return data;
 }
 
+template <typename DatabaseHandler>
+std::vector<std::shared_ptr<ndn::Data>>
+QueryAdapter<DatabaseHandler>::makeManifestData(const ndn::Name& segmentPrefix,
+                                                const std::vector<ndn::name::Component>& digests)
+{
+  ndn::Name manifestPrefix(segmentPrefix);
+  manifestPrefix.append("manifest");
+
+  // The content of a manifest segment is a sequence of ImplicitSha256DigestComponent TLVs
+  std::vector<std::shared_ptr<ndn::Data>> manifest;
+  std::vector<uint8_t> payload;
+  // a 32-byte digest has one-octet TLV-TYPE and TLV-LENGTH, and every segment holds at least one
+  const size_t digestSize = 2 + ndn::crypto::SHA256_DIGEST_SIZE;
+  const size_t payloadLimit = std::max(getPayloadLimit(), digestSize);
+  size_t iDigest = 0;
+  do {
+    payload.clear();
+    for (; iDigest < digests.size() && payload.size() + digestSize <= payloadLimit; ++iDigest) {
+      const ndn::name::Component& digest = digests[iDigest];
+      payload.push_back(ndn::tlv::ImplicitSha256DigestComponent);
+      payload.push_back(static_cast<uint8_t>(digest.value_size()));
+      payload.insert(payload.end(), digest.value(), digest.value() + digest.value_size());
+    }
+
+    const uint64_t segmentNo = manifest.size();
+    std::shared_ptr<ndn::Data> data
+      = std::make_shared<ndn::Data>(ndn::Name(manifestPrefix).appendSegment(segmentNo));
+    data->setContent(payload.data(), payload.size());
+    data->setFreshnessPeriod(RESULT_FRESHNESS_PERIOD);
+    if (iDigest == digests.size()) {
+      data->setFinalBlockId(ndn::Name::Component::fromSegment(segmentNo));
+    }
+    signData(*data);
+    manifest.push_back(data);
+  } while (iDigest < digests.size());
+
+#ifndef NDEBUG
+  std::cout << "makeManifestData : " << manifestPrefix << " covers " << digests.size()
+            << " segments in " << manifest.size() << " manifest segments" << std::endl;
+#endif
+  return manifest;
+}
+
+template <typename DatabaseHandler>
+void
+QueryAdapter<DatabaseHandler>::appendManifestData(const ndn::Name& segmentPrefix,
+                                                  std::vector<std::shared_ptr<ndn::Data>>& segments)
+{
+  if (!m_signManifest) {
+    return;
+  }
+  std::vector<ndn::name::Component> digests;
+  for (const auto& data : segments) {
+    digests.push_back(data->getFullName().get(-1));
+  }
+  std::vector<std::shared_ptr<ndn::Data>> manifest = makeManifestData(segmentPrefix, digests);
+  segments.insert(segments.end(), manifest.begin(), manifest.end());
+}
+
 } // namespace query
 } // namespace atmos
 #endif //ATMOS_QUERY_QUERY_ADAPTER_HPP
@@ -0,0 +1,85 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/query-key.hpp"
+
+#include <json/writer.h>
+
+namespace atmos {
+namespace query {
+
+static Json::Value
+normalize(const Json::Value& value)
+{
+  switch (value.type()) {
+  case Json::objectValue: {
+    // Json::Value keeps the members of an object sorted by key already
+    Json::Value object(Json::objectValue);
+    for (Json::Value::const_iterator iter = value.begin(); iter != value.end(); ++iter) {
+      object[iter.key().asString()] = normalize(*iter);
+    }
+    return object;
+  }
+  case Json::arrayValue: {
+    Json::Value array(Json::arrayValue);
+    for (Json::Value::ArrayIndex i = 0; i < value.size(); ++i) {
+      array.append(normalize(value[i]));
+    }
+    return array;
+  }
+  case Json::intValue:
+    return Json::Value(Json::valueToString(value.asLargestInt()));
+  case Json::uintValue:
+    return Json::Value(Json::valueToString(value.asLargestUInt()));
+  case Json::realValue:
+    return Json::Value(Json::valueToString(value.asDouble()));
+  case Json::booleanValue:
+    return Json::Value(value.asBool() ? "true" : "false");
+  case Json::nullValue:
+    return Json::Value("");
+  default:
+    return value;
+  }
+}
+
+// 64-bit FNV-1a, which is fast on the short strings queries are made of
+static uint64_t
+fnv1a(const std::string& str)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+QueryKey::QueryKey(const Json::Value& query)
+  : m_query(normalize(query))
+{
+  Json::FastWriter fastWriter;
+  m_string = fastWriter.write(m_query);
+  // FastWriter terminates the document with a newline
+  if (!m_string.empty() && m_string[m_string.size() - 1] == '\n') {
+    m_string.erase(m_string.size() - 1);
+  }
+  m_hash = fnv1a(m_string);
+}
+
+} // namespace query
+} // namespace atmos
@@ -0,0 +1,101 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_QUERY_QUERY_KEY_HPP
+#define ATMOS_QUERY_QUERY_KEY_HPP
+
+#include <json/value.h>
+
+#include <cstdint>
+#include <string>
+
+namespace atmos {
+namespace query {
+
+/**
+ * QueryKey identifies a JSON query independently of how the client wrote it.
+ *
+ * The query is canonicalized: object keys are sorted, whitespace is dropped, and scalar values
+ * are turned into strings, since that is how they end up in the SQL. Queries that only differ
+ * in those respects get equal keys and can share their results. The hash of the canonical form
+ * is computed once, so lookups in hash tables do not rehash the string.
+ */
+class QueryKey {
+public:
+  struct Hash {
+    size_t
+    operator()(const QueryKey& key) const
+    {
+      return static_cast<size_t>(key.getHash());
+    }
+  };
+
+  /**
+   * Constructor
+   *
+   * @param query: parsed JSON query
+   */
+  explicit
+  QueryKey(const Json::Value& query);
+
+  /**
+   * @return the canonical query, which should be used to run the query
+   */
+  const Json::Value&
+  getQuery() const
+  {
+    return m_query;
+  }
+
+  /**
+   * @return the canonical query as a JSON string
+   */
+  const std::string&
+  toString() const
+  {
+    return m_string;
+  }
+
+  uint64_t
+  getHash() const
+  {
+    return m_hash;
+  }
+
+  bool
+  operator==(const QueryKey& other) const
+  {
+    return m_hash == other.m_hash && m_string == other.m_string;
+  }
+
+  bool
+  operator!=(const QueryKey& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  Json::Value m_query;
+  std::string m_string;
+  uint64_t m_hash;
+};
+
+} // namespace query
+} // namespace atmos
+
+#endif // ATMOS_QUERY_QUERY_KEY_HPP
@@ -0,0 +1,163 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/query-stats.hpp"
+
+namespace atmos {
+namespace query {
+
+QueryStats::Stopwatch::Stopwatch(QueryStats& stats, Stage stage, bool isRunning)
+  : m_stats(stats)
+  , m_stage(stage)
+  , m_elapsed(0)
+  , m_isRunning(false)
+  , m_hasRun(false)
+{
+  if (isRunning) {
+    start();
+  }
+}
+
+QueryStats::Stopwatch::~Stopwatch()
+{
+  stop();
+  if (m_hasRun) {
+    m_stats.record(m_stage, m_elapsed);
+  }
+}
+
+void
+QueryStats::Stopwatch::start()
+{
+  if (!m_isRunning) {
+    m_startTime = Clock::now();
+    m_isRunning = true;
+    m_hasRun = true;
+  }
+}
+
+void
+QueryStats::Stopwatch::stop()
+{
+  if (m_isRunning) {
+    m_elapsed += Clock::now() - m_startTime;
+    m_isRunning = false;
+  }
+}
+
+void
+QueryStats::Stopwatch::handOver(Stopwatch& next)
+{
+  const Clock::time_point now = Clock::now();
+  if (m_isRunning) {
+    m_elapsed += now - m_startTime;
+    m_isRunning = false;
+  }
+  if (!next.m_isRunning) {
+    next.m_startTime = now;
+    next.m_isRunning = true;
+    next.m_hasRun = true;
+  }
+}
+
+QueryStats::QueryStats()
+  : m_startTime(Clock::now())
+{
+  for (auto& counter : m_counters) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+}
+
+Json::Value
+QueryStats::toJson() const
+{
+  Json::Value stats(Json::objectValue);
+  stats["uptime"] = Json::Value::UInt64(
+    std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - m_startTime).count());
+
+  Json::Value& counters = stats["counters"];
+  for (size_t i = 0; i < N_COUNTERS; ++i) {
+    const Counter counter = static_cast<Counter>(i);
+    counters[getCounterName(counter)] = Json::Value::UInt64(getCount(counter));
+  }
+
+  Json::Value& stages = stats["stages"];
+  for (size_t i = 0; i < N_STAGES; ++i) {
+    const util::LatencyHistogram& histogram = m_histograms[i];
+    Json::Value stage(Json::objectValue);
+    const uint64_t count = histogram.getCount();
+    stage["count"] = Json::Value::UInt64(count);
+    stage["mean"] = Json::Value::UInt64(count > 0 ? histogram.getTotal().count() / count : 0);
+    stage["p50"] = Json::Value::UInt64(histogram.getPercentile(0.5).count());
+    stage["p90"] = Json::Value::UInt64(histogram.getPercentile(0.9).count());
+    stage["p99"] = Json::Value::UInt64(histogram.getPercentile(0.99).count());
+    stage["p999"] = Json::Value::UInt64(histogram.getPercentile(0.999).count());
+    stage["max"] = Json::Value::UInt64(histogram.getMax().count());
+    stages[getStageName(static_cast<Stage>(i))] = stage;
+  }
+  return stats;
+}
+
+const char*
+QueryStats::getStageName(Stage stage)
+{
+  switch (stage) {
+  case STAGE_NAME_PARSE:
+    return "nameParse";
+  case STAGE_JSON_PARSE:
+    return "jsonParse";
+  case STAGE_DEDUP:
+    return "dedup";
+  case STAGE_SQL_BUILD:
+    return "sqlBuild";
+  case STAGE_DB_EXECUTE:
+    return "dbExecute";
+  case STAGE_ROW_FETCH:
+    return "rowFetch";
+  case STAGE_SEGMENT_ENCODE:
+    return "segmentEncode";
+  case STAGE_SIGN:
+    return "sign";
+  case STAGE_CACHE_INSERT:
+    return "cacheInsert";
+  default:
+    return "unknown";
+  }
+}
+
+const char*
+QueryStats::getCounterName(Counter counter)
+{
+  switch (counter) {
+  case COUNTER_QUERIES:
+    return "queries";
+  case COUNTER_COALESCED:
+    return "coalesced";
+  case COUNTER_EXECUTIONS:
+    return "executions";
+  case COUNTER_FAILURES:
+    return "failures";
+  case COUNTER_DROPPED:
+    return "dropped";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace query
+} // namespace atmos
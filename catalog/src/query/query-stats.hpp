@@ -0,0 +1,164 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_QUERY_QUERY_STATS_HPP
+#define ATMOS_QUERY_QUERY_STATS_HPP
+
+#include "util/latency-histogram.hpp"
+
+#include <json/value.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace atmos {
+namespace query {
+
+/**
+ * QueryStats keeps a latency histogram for each stage that queries go through, and counters of
+ * what becomes of them. They are served as the status dataset of the query adapter.
+ *
+ * Any thread can record at any time, without taking a lock.
+ */
+class QueryStats : boost::noncopyable {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum Stage {
+    // getting the JSON out of the Interest name, per query Interest
+    STAGE_NAME_PARSE,
+    // parsing and checking the JSON and making its canonical form, per query Interest
+    STAGE_JSON_PARSE,
+    // joining or adding an entry of the active query table, per query Interest
+    STAGE_DEDUP,
+    // turning the JSON into SQL, per statement
+    STAGE_SQL_BUILD,
+    // running a statement until its rows can be read, per statement
+    STAGE_DB_EXECUTE,
+    // reading the rows of a statement, per statement
+    STAGE_ROW_FETCH,
+    // putting the names of a result into segments, per result or page of segments. Segments
+    // that are signed and cached on the same thread count here as well as in their own stages.
+    STAGE_SEGMENT_ENCODE,
+    // signing, per Data
+    STAGE_SIGN,
+    // putting segments into the cache, with the wait for its lock, per insertion
+    STAGE_CACHE_INSERT,
+    N_STAGES
+  };
+
+  enum Counter {
+    // query Interests that have been handled
+    COUNTER_QUERIES,
+    // query Interests answered with the execution of an identical query
+    COUNTER_COALESCED,
+    COUNTER_EXECUTIONS,
+    COUNTER_FAILURES,
+    // query Interests dropped since too many queries were waiting for a worker
+    COUNTER_DROPPED,
+    N_COUNTERS
+  };
+
+  /**
+   * Stopwatch measures how long a stage of one query takes, possibly in several pieces, and
+   * records it as one latency when it is destroyed, if it has run at all
+   */
+  class Stopwatch : boost::noncopyable {
+  public:
+    Stopwatch(QueryStats& stats, Stage stage, bool isRunning = true);
+
+    ~Stopwatch();
+
+    void
+    start();
+
+    void
+    stop();
+
+    /**
+     * Helper function that stops this stopwatch and starts the next one, with a single reading
+     * of the clock
+     */
+    void
+    handOver(Stopwatch& next);
+
+  private:
+    QueryStats& m_stats;
+    const Stage m_stage;
+    Clock::duration m_elapsed;
+    Clock::time_point m_startTime;
+    bool m_isRunning;
+    bool m_hasRun;
+  };
+
+  QueryStats();
+
+  void
+  record(Stage stage, const Clock::duration& latency)
+  {
+    m_histograms[stage].record(std::chrono::duration_cast<std::chrono::microseconds>(latency));
+  }
+
+  void
+  increment(Counter counter)
+  {
+    m_counters[counter].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const util::LatencyHistogram&
+  getHistogram(Stage stage) const
+  {
+    return m_histograms[stage];
+  }
+
+  uint64_t
+  getCount(Counter counter) const
+  {
+    return m_counters[counter].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return the seconds since the stats were created, the counters and, for each stage, the
+   *         number of latencies and their mean, percentiles and maximum in microseconds, e.g.
+   *         {"uptime":60,"counters":{"queries":2,...},
+   *          "stages":{"nameParse":{"count":2,"mean":3,"p50":3,"p90":4,"p99":4,"p999":4,
+   *                                 "max":4},...}}
+   */
+  Json::Value
+  toJson() const;
+
+  static const char*
+  getStageName(Stage stage);
+
+  static const char*
+  getCounterName(Counter counter);
+
+private:
+  const Clock::time_point m_startTime;
+  std::array<util::LatencyHistogram, N_STAGES> m_histograms;
+  std::array<std::atomic<uint64_t>, N_COUNTERS> m_counters;
+};
+
+} // namespace query
+} // namespace atmos
+
+#endif // ATMOS_QUERY_QUERY_STATS_HPP
@@ -0,0 +1,348 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/segment-encoder.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/encoding/tlv.hpp>
+
+#include <json/writer.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+
+namespace atmos {
+namespace query {
+
+static const char RESULTS_HEADER[] = "{\"results\":[";
+static const char NEXT_HEADER[] = "{\"next\":[";
+// closes the array and the object, then the newline of FastWriter and the NUL of the C string
+static const char ARRAY_END[] = "]";
+static const char OBJECT_END[] = "}\n";
+static const size_t TRAILER_SIZE = sizeof(ARRAY_END) - 1 + sizeof(OBJECT_END);
+// room in front of the payload for the type and length of the Content TLV
+static const size_t TLV_HEADER_RESERVE = 16;
+// bytes a compressed payload may still grow by when the stream is finished: bits held back from
+// the last block, the final block and the Adler-32 checksum
+static const size_t DEFLATE_FINISH_OVERHEAD = 16;
+// bytes a name may take on top of its own when it ends a deflate block: a name that does not
+// compress is stored, with the block header padded to a byte after the bits held back from the
+// block before, and the length and its complement
+static const size_t DEFLATE_BLOCK_OVERHEAD = 6;
+// the zlib header, which comes with the first block
+static const size_t ZLIB_HEADER_SIZE = 2;
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static inline bool
+needsEscape(unsigned char c)
+{
+  return c == '"' || c == '\\' || c < 0x20;
+}
+
+SegmentEncoder::SegmentEncoder(bool isAutocomplete, size_t reserve, const ResultFormat& format)
+  : m_isAutocomplete(isAutocomplete)
+  , m_reserve(reserve)
+  , m_format(format)
+  , m_nNames(0)
+  , m_nDeflated(0)
+{
+  if (m_format.isCompressed) {
+    m_stream.reset(new z_stream());
+    if (deflateInit(m_stream.get(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+      m_stream.reset();
+      throw std::bad_alloc();
+    }
+  }
+  start();
+}
+
+SegmentEncoder::~SegmentEncoder()
+{
+  if (m_stream) {
+    deflateEnd(m_stream.get());
+  }
+}
+
+void
+SegmentEncoder::start()
+{
+  m_buffer.reset(new ndn::EncodingBuffer(m_reserve + TLV_HEADER_RESERVE, m_reserve));
+  if (m_format.isBinary) {
+    // entries need no header
+  }
+  else if (m_isAutocomplete) {
+    m_buffer->appendByteArray(reinterpret_cast<const uint8_t*>(NEXT_HEADER),
+                              sizeof(NEXT_HEADER) - 1);
+  }
+  else {
+    m_buffer->appendByteArray(reinterpret_cast<const uint8_t*>(RESULTS_HEADER),
+                              sizeof(RESULTS_HEADER) - 1);
+  }
+  m_nNames = 0;
+  m_lastName.clear();
+  m_pageInfo.clear();
+
+  if (m_format.isCompressed) {
+    if (deflateReset(m_stream.get()) != Z_OK) {
+      throw std::runtime_error("Cannot reset the deflate stream");
+    }
+    m_compressed.reset(new ndn::EncodingBuffer(m_reserve + TLV_HEADER_RESERVE, m_reserve));
+    m_nDeflated = 0;
+  }
+}
+
+void
+SegmentEncoder::deflateBuffer(int flush)
+{
+  m_stream->next_in = m_buffer->buf() + m_nDeflated;
+  m_stream->avail_in = m_buffer->size() - m_nDeflated;
+  uint8_t chunk[4096];
+  int result = Z_OK;
+  do {
+    m_stream->next_out = chunk;
+    m_stream->avail_out = sizeof(chunk);
+    result = deflate(m_stream.get(), flush);
+    if (result == Z_STREAM_ERROR) {
+      throw std::runtime_error("Cannot deflate the segment payload");
+    }
+    m_compressed->appendByteArray(chunk, sizeof(chunk) - m_stream->avail_out);
+  } while (m_stream->avail_out == 0);
+  // Z_BUF_ERROR only means that there was nothing left to do, unless input is left over
+  if (m_stream->avail_in != 0 || (flush == Z_FINISH && result != Z_STREAM_END)) {
+    throw std::runtime_error("Cannot deflate the segment payload");
+  }
+  m_nDeflated = m_buffer->size();
+}
+
+void
+SegmentEncoder::setPageInfo(const Json::Value& pageInfo)
+{
+  m_pageInfo.clear();
+  if (m_format.isBinary) {
+    if (pageInfo.isMember("cursor")) {
+      const ndn::Block cursor = ndn::makeStringBlock(tlv::Cursor, pageInfo["cursor"].asString());
+      m_pageInfo.append(reinterpret_cast<const char*>(cursor.wire()), cursor.size());
+    }
+    if (pageInfo.isMember("total")) {
+      const ndn::Block total = ndn::makeNonNegativeIntegerBlock(tlv::Total,
+                                                                pageInfo["total"].asUInt64());
+      m_pageInfo.append(reinterpret_cast<const char*>(total.wire()), total.size());
+    }
+    return;
+  }
+
+  Json::FastWriter fastWriter;
+  for (Json::Value::const_iterator iter = pageInfo.begin(); iter != pageInfo.end(); ++iter) {
+    std::string value = fastWriter.write(*iter);
+    // FastWriter terminates the document with a newline
+    if (!value.empty() && value[value.size() - 1] == '\n') {
+      value.erase(value.size() - 1);
+    }
+    m_pageInfo += ",";
+    m_pageInfo += Json::valueToQuotedString(iter.key().asCString());
+    m_pageInfo += ":";
+    m_pageInfo += value;
+  }
+}
+
+void
+SegmentEncoder::append(const char* name, size_t length)
+{
+  if (m_format.isBinary) {
+    appendBinary(name, length);
+  }
+  else {
+    appendJson(name, length);
+  }
+  ++m_nNames;
+
+  if (m_format.isCompressed) {
+    deflateBuffer(Z_BLOCK);
+  }
+}
+
+void
+SegmentEncoder::appendBinary(const char* name, size_t length)
+{
+  const size_t shared = getSharedSize(name, length);
+  m_buffer->appendVarNumber(m_isAutocomplete ? tlv::NextComponent : tlv::ResultName);
+  m_buffer->appendVarNumber(ndn::tlv::sizeOfVarNumber(shared) + length - shared);
+  m_buffer->appendVarNumber(shared);
+  m_buffer->appendByteArray(reinterpret_cast<const uint8_t*>(name) + shared, length - shared);
+  m_lastName.assign(name, length);
+}
+
+size_t
+SegmentEncoder::getSharedSize(const char* name, size_t length) const
+{
+  const size_t maxShared = std::min(length, m_lastName.size());
+  size_t shared = 0;
+  while (shared < maxShared && name[shared] == m_lastName[shared]) {
+    ++shared;
+  }
+  return shared;
+}
+
+void
+SegmentEncoder::appendJson(const char* name, size_t length)
+{
+  if (m_nNames > 0) {
+    m_buffer->appendByte(',');
+  }
+  m_buffer->appendByte('"');
+
+  // names rarely need escaping, so the characters between escapes are copied in one go
+  const uint8_t* begin = reinterpret_cast<const uint8_t*>(name);
+  const uint8_t* end = begin + length;
+  const uint8_t* run = begin;
+  for (const uint8_t* c = begin; c != end; ++c) {
+    if (!needsEscape(*c)) {
+      continue;
+    }
+    m_buffer->appendByteArray(run, c - run);
+    run = c + 1;
+
+    m_buffer->appendByte('\\');
+    switch (*c) {
+    case '"':
+    case '\\':
+      m_buffer->appendByte(*c);
+      break;
+    case '\b':
+      m_buffer->appendByte('b');
+      break;
+    case '\f':
+      m_buffer->appendByte('f');
+      break;
+    case '\n':
+      m_buffer->appendByte('n');
+      break;
+    case '\r':
+      m_buffer->appendByte('r');
+      break;
+    case '\t':
+      m_buffer->appendByte('t');
+      break;
+    default: {
+      const uint8_t escape[] = {'u', '0', '0',
+                                static_cast<uint8_t>(HEX_DIGITS[*c >> 4]),
+                                static_cast<uint8_t>(HEX_DIGITS[*c & 0xF])};
+      m_buffer->appendByteArray(escape, sizeof(escape));
+      break;
+    }
+    }
+  }
+  m_buffer->appendByteArray(run, end - run);
+
+  m_buffer->appendByte('"');
+}
+
+size_t
+SegmentEncoder::getPayloadSize() const
+{
+  const size_t trailerSize = m_format.isBinary ? 0 : TRAILER_SIZE;
+  if (m_format.isCompressed) {
+    // what has not been deflated yet cannot grow
+    return m_compressed->size() + (m_buffer->size() - m_nDeflated) + trailerSize +
+           m_pageInfo.size() + DEFLATE_FINISH_OVERHEAD;
+  }
+  return m_buffer->size() + trailerSize + m_pageInfo.size();
+}
+
+size_t
+SegmentEncoder::getAppendedSize(const char* name, size_t length) const
+{
+  size_t size = 0;
+  if (m_format.isBinary) {
+    const size_t shared = getSharedSize(name, length);
+    const size_t valueSize = ndn::tlv::sizeOfVarNumber(shared) + length - shared;
+    size = ndn::tlv::sizeOfVarNumber(m_isAutocomplete ? tlv::NextComponent : tlv::ResultName) +
+           ndn::tlv::sizeOfVarNumber(valueSize) + valueSize;
+  }
+  else {
+    // the separator comes before every name but the first
+    size = getEncodedSize(name, length) + (m_nNames > 0 ? 1 : 0);
+  }
+  if (m_format.isCompressed) {
+    return size + DEFLATE_BLOCK_OVERHEAD + (m_compressed->size() == 0 ? ZLIB_HEADER_SIZE : 0);
+  }
+  return size;
+}
+
+size_t
+SegmentEncoder::getEncodedSize(const char* name, size_t length)
+{
+  size_t size = length + 2;
+  for (size_t i = 0; i < length; ++i) {
+    const unsigned char c = name[i];
+    if (!needsEscape(c)) {
+      continue;
+    }
+    switch (c) {
+    case '"':
+    case '\\':
+    case '\b':
+    case '\f':
+    case '\n':
+    case '\r':
+    case '\t':
+      size += 1;
+      break;
+    default:
+      size += 5;
+      break;
+    }
+  }
+  return size;
+}
+
+ndn::Block
+SegmentEncoder::finish()
+{
+  if (m_format.isBinary) {
+    m_buffer->appendByteArray(reinterpret_cast<const uint8_t*>(m_pageInfo.data()),
+                              m_pageInfo.size());
+  }
+  else {
+    m_buffer->appendByteArray(reinterpret_cast<const uint8_t*>(ARRAY_END),
+                              sizeof(ARRAY_END) - 1);
+    m_buffer->appendByteArray(reinterpret_cast<const uint8_t*>(m_pageInfo.data()),
+                              m_pageInfo.size());
+    m_buffer->appendByteArray(reinterpret_cast<const uint8_t*>(OBJECT_END), sizeof(OBJECT_END));
+  }
+
+  ndn::EncodingBuffer* payload = m_buffer.get();
+  if (m_format.isCompressed) {
+    deflateBuffer(Z_FINISH);
+    payload = m_compressed.get();
+  }
+  payload->prependVarNumber(payload->size());
+  payload->prependVarNumber(ndn::tlv::Content);
+  ndn::Block content = payload->block();
+
+  start();
+  return content;
+}
+
+} // namespace query
+} // namespace atmos
@@ -0,0 +1,219 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_QUERY_SEGMENT_ENCODER_HPP
+#define ATMOS_QUERY_SEGMENT_ENCODER_HPP
+
+#include <ndn-cxx/encoding/block.hpp>
+#include <ndn-cxx/encoding/encoding-buffer.hpp>
+
+#include <json/value.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <memory>
+#include <string>
+
+struct z_stream_s;
+
+namespace atmos {
+namespace query {
+
+namespace tlv {
+
+/**
+ * TLV types of a binary query-results payload, which is a sequence of
+ *
+ *   Entry ::= (ResultName | NextComponent) TLV-LENGTH
+ *               VAR-NUMBER(bytes shared with the previous entry)
+ *               BYTES(rest of the name)
+ *
+ * in name order, followed by Cursor and Total on the final segment of a page. The first entry
+ * of every segment shares nothing, so that segments decode on their own.
+ */
+enum {
+  ResultName    = 128,
+  NextComponent = 129,
+  Cursor        = 130, // name to continue the next page from
+  Total         = 131  // NonNegativeInteger
+};
+
+} // namespace tlv
+
+/**
+ * How the names of a query result are written into its segments, as asked for in the query
+ */
+struct ResultFormat {
+  ResultFormat()
+    : isCompressed(false)
+    , isBinary(false)
+  {
+  }
+
+  // whether the payload of every segment is a zlib stream of its own
+  bool isCompressed;
+  // whether names are written as front-coded TLV entries rather than JSON
+  bool isBinary;
+};
+
+/**
+ * SegmentEncoder writes the payload of a query-results segment, {"results":[...]} or
+ * {"next":[...]} in JSON or a sequence of tlv::ResultName or tlv::NextComponent entries,
+ * straight into the Content TLV of the Data.
+ *
+ * Names are escaped the way Json::FastWriter does it, and the payload is terminated by a newline
+ * and a NUL byte as before, so consumers see the same bytes as with a Json::Value. There is no
+ * intermediate Json::Value or string, and the finished block shares the buffer it was written
+ * to.
+ *
+ * A compressed payload is deflated name by name, each name ending a deflate block, so that its
+ * size is known at any time and segments are filled by compressed size. If zlib fails,
+ * std::runtime_error is thrown rather than a truncated payload being written.
+ */
+class SegmentEncoder : boost::noncopyable {
+public:
+  /**
+   * Constructor
+   *
+   * @param isAutocomplete: whether the names go into "next" rather than "results"
+   * @param reserve:        bytes reserved for the payload of each segment, which grows if needed
+   * @param format:         how the payload is written
+   */
+  explicit
+  SegmentEncoder(bool isAutocomplete, size_t reserve = 8192,
+                 const ResultFormat& format = ResultFormat());
+
+  ~SegmentEncoder();
+
+  /**
+   * Helper function that adds a name to the current segment
+   */
+  void
+  append(const char* name, size_t length);
+
+  void
+  append(const std::string& name)
+  {
+    append(name.data(), name.size());
+  }
+
+  /**
+   * @return number of names in the current segment
+   */
+  size_t
+  size() const
+  {
+    return m_nNames;
+  }
+
+  bool
+  empty() const
+  {
+    return m_nNames == 0;
+  }
+
+  /**
+   * Helper function that adds members after the names of the current segment, such as the
+   * cursor and the total of a page, {"results":[...],"cursor":...,"total":...}. A binary payload
+   * only has room for "cursor" and "total".
+   *
+   * @param pageInfo: Json object whose members are added
+   */
+  void
+  setPageInfo(const Json::Value& pageInfo);
+
+  /**
+   * @return bytes of payload the current segment would have if it was finished now. For a
+   *         compressed payload, that is an upper bound.
+   */
+  size_t
+  getPayloadSize() const;
+
+  /**
+   * @return bytes the payload grows by if the name is appended next. For a compressed payload,
+   *         that is an upper bound, the size of the name stored in a deflate block of its own.
+   */
+  size_t
+  getAppendedSize(const char* name, size_t length) const;
+
+  size_t
+  getAppendedSize(const std::string& name) const
+  {
+    return getAppendedSize(name.data(), name.size());
+  }
+
+  /**
+   * @return bytes a name takes in a JSON payload, including the quotes but not the separator
+   */
+  static size_t
+  getEncodedSize(const char* name, size_t length);
+
+  /**
+   * Helper function that finishes the current segment and starts an empty one
+   *
+   * @return Content block of the segment
+   */
+  ndn::Block
+  finish();
+
+private:
+  void
+  start();
+
+  void
+  appendJson(const char* name, size_t length);
+
+  void
+  appendBinary(const char* name, size_t length);
+
+  /**
+   * @return bytes the name shares with the previous one in the current segment
+   */
+  size_t
+  getSharedSize(const char* name, size_t length) const;
+
+  /**
+   * Helper function that deflates what has been written since the last call
+   *
+   * @param flush: Z_BLOCK to end a deflate block, or Z_FINISH to end the stream
+   */
+  void
+  deflateBuffer(int flush);
+
+private:
+  const bool m_isAutocomplete;
+  const size_t m_reserve;
+  const ResultFormat m_format;
+  std::unique_ptr<ndn::EncodingBuffer> m_buffer;
+  size_t m_nNames;
+  // @{ only if compressed
+  std::unique_ptr<z_stream_s> m_stream;
+  std::unique_ptr<ndn::EncodingBuffer> m_compressed;
+  // bytes of m_buffer that have been deflated
+  size_t m_nDeflated;
+  // @}
+  // previous name of the current segment, only if binary
+  std::string m_lastName;
+  // encoded members that follow the names, each with its leading comma in JSON
+  std::string m_pageInfo;
+};
+
+} // namespace query
+} // namespace atmos
+
+#endif // ATMOS_QUERY_SEGMENT_ENCODER_HPP
@@ -51,6 +51,22 @@ ConfigFile::ignoreUnknownSection(const std::string& filename,
   // do nothing
 }
 
+bool
+ConfigFile::parseYesNo(const ConfigSection::value_type& option,
+                       const std::string& sectionName)
+{
+  const std::string& value = option.second.get_value<std::string>();
+  if (value == "yes") {
+    return true;
+  }
+  else if (value == "no") {
+    return false;
+  }
+
+  throw Error("Invalid value for option \"" + option.first + "\" in \"" +
+              sectionName + "\" section");
+}
+
 ConfigFile::ConfigFile(UnknownConfigSectionHandler unknownSectionCallback)
   : m_unknownSectionCallback(unknownSectionCallback)
 {
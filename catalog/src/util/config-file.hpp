@@ -73,6 +73,14 @@ public:
                        const ConfigSection& section,
                        bool isDryRun);
 
+  /** \brief parse a config option that can be either "yes" or "no"
+   *  \return true if "yes", false if "no"
+   *  \throw Error the value is neither "yes" nor "no"
+   */
+  static bool
+  parseYesNo(const ConfigSection::value_type& option,
+             const std::string& sectionName);
+
   /// \brief setup notification of configuration file sections
   void
   addSectionHandler(const std::string& sectionName,
@@ -0,0 +1,226 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/facet-index.hpp"
+
+#include <algorithm>
+
+namespace atmos {
+namespace util {
+
+FacetIndex::FacetIndex(const std::vector<std::string>& columns)
+  : m_columns(columns)
+  , m_isCaseInsensitive(false)
+  , m_generation(0)
+  , m_isLoaded(false)
+{
+}
+
+uint64_t
+FacetIndex::startLoading(bool isCaseInsensitive)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_names.clear();
+  m_ids.clear();
+  m_live = RoaringBitmap();
+  m_bitmaps.clear();
+  m_isCaseInsensitive = isCaseInsensitive;
+  m_isLoaded = false;
+  return ++m_generation;
+}
+
+void
+FacetIndex::insert(const std::string& name, const std::vector<std::string>& values)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto existing = m_ids.find(name);
+  if (existing != m_ids.end()) {
+    // the old facets stay in their bitmaps, but the old number is not live anymore
+    m_live.remove(existing->second);
+    m_names[existing->second].clear();
+    m_ids.erase(existing);
+  }
+
+  const uint32_t id = static_cast<uint32_t>(m_names.size());
+  m_names.push_back(name);
+  m_ids[name] = id;
+  m_live.add(id);
+  for (size_t i = 0; i < m_columns.size() && i < values.size(); ++i) {
+    ValueBitmap& bitmap = m_bitmaps[std::make_pair(m_columns[i], normalize(values[i]))];
+    if (bitmap.datasets.empty()) {
+      bitmap.value = values[i];
+    }
+    bitmap.datasets.add(id);
+  }
+}
+
+void
+FacetIndex::erase(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto existing = m_ids.find(name);
+  if (existing == m_ids.end()) {
+    return;
+  }
+  m_live.remove(existing->second);
+  m_names[existing->second].clear();
+  m_ids.erase(existing);
+}
+
+void
+FacetIndex::invalidate()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_generation;
+  m_isLoaded = false;
+}
+
+void
+FacetIndex::markLoaded(uint64_t token)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_isLoaded = token == m_generation;
+}
+
+bool
+FacetIndex::isLoaded() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_isLoaded;
+}
+
+bool
+FacetIndex::canAnswer(const ConditionList& conditions) const
+{
+  if (conditions.empty()) {
+    return false;
+  }
+  for (const auto& condition : conditions) {
+    if (std::find(m_columns.begin(), m_columns.end(), condition.first) == m_columns.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+FacetIndex::find(const ConditionList& conditions, std::vector<std::string>& names) const
+{
+  if (!canAnswer(conditions)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_isLoaded) {
+    return false;
+  }
+
+  for (uint32_t id : intersect(conditions).toVector()) {
+    names.push_back(m_names[id]);
+  }
+  return true;
+}
+
+bool
+FacetIndex::countValues(const ConditionList& conditions, FacetCounts& counts) const
+{
+  if (!conditions.empty() && !canAnswer(conditions)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_isLoaded) {
+    return false;
+  }
+
+  const RoaringBitmap matches = intersect(conditions);
+  for (const auto& column : m_columns) {
+    auto condition = std::find_if(conditions.begin(), conditions.end(),
+                                  [&column] (const std::pair<std::string, std::string>& c) {
+                                    return c.first == column;
+                                  });
+    if (condition != conditions.end()) {
+      continue;
+    }
+
+    // the bitmaps of a column are next to each other, in value order
+    std::map<std::string, uint64_t>& columnCounts = counts[column];
+    for (auto bitmap = m_bitmaps.lower_bound(std::make_pair(column, std::string()));
+         bitmap != m_bitmaps.end() && bitmap->first.first == column && !matches.empty();
+         ++bitmap) {
+      const uint64_t count = bitmap->second.datasets.intersectionCardinality(matches);
+      if (count > 0) {
+        columnCounts[bitmap->second.value] = count;
+      }
+    }
+  }
+  return true;
+}
+
+RoaringBitmap
+FacetIndex::intersect(const ConditionList& conditions) const
+{
+  std::vector<const RoaringBitmap*> bitmaps;
+  for (const auto& condition : conditions) {
+    auto bitmap = m_bitmaps.find(std::make_pair(condition.first, normalize(condition.second)));
+    if (bitmap == m_bitmaps.end()) {
+      // no dataset has that value
+      return RoaringBitmap();
+    }
+    bitmaps.push_back(&bitmap->second.datasets);
+  }
+  std::sort(bitmaps.begin(), bitmaps.end(),
+            [] (const RoaringBitmap* a, const RoaringBitmap* b) {
+              return a->cardinality() < b->cardinality();
+            });
+
+  RoaringBitmap result = bitmaps.empty() ? m_live : *bitmaps.front();
+  for (size_t i = 1; i < bitmaps.size() && !result.empty(); ++i) {
+    result &= *bitmaps[i];
+  }
+  if (!bitmaps.empty()) {
+    result &= m_live;
+  }
+  return result;
+}
+
+std::string
+FacetIndex::normalize(const std::string& value) const
+{
+  if (!m_isCaseInsensitive) {
+    return value;
+  }
+  // trailing spaces are padding to such collations
+  std::string normalized = value.substr(0, value.find_last_not_of(' ') + 1);
+  for (char& c : normalized) {
+    if (c >= 'A' && c <= 'Z') {
+      c = c - 'A' + 'a';
+    }
+  }
+  return normalized;
+}
+
+size_t
+FacetIndex::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_ids.size();
+}
+
+} // namespace util
+} // namespace atmos
@@ -0,0 +1,188 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_UTIL_FACET_INDEX_HPP
+#define ATMOS_UTIL_FACET_INDEX_HPP
+
+#include "util/roaring-bitmap.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace atmos {
+namespace util {
+
+/**
+ * FacetIndex answers equality queries on the facet columns of the catalog in memory.
+ *
+ * Every dataset gets a number, and every (column, value) pair a RoaringBitmap of the datasets
+ * that have it, so a conjunction of conditions is the intersection of their bitmaps. The
+ * smallest bitmap goes first, so the intersections only get cheaper.
+ *
+ * The index is only used once it is loaded. Names that are added without their facets make it
+ * stale until it is loaded again, while removed names are simply dropped from it.
+ *
+ * Values are compared like the database compares the columns, which is byte for byte for a
+ * binary collation. With a case-insensitive one, ASCII letters are compared regardless of
+ * their case and trailing spaces are ignored, and a value is reported as it was first added.
+ *
+ * FacetIndex is thread-safe.
+ */
+class FacetIndex : boost::noncopyable {
+public:
+  typedef std::vector<std::pair<std::string, std::string>> ConditionList;
+  // datasets by value, by column
+  typedef std::map<std::string, std::map<std::string, uint64_t>> FacetCounts;
+
+  /**
+   * Constructor
+   *
+   * @param columns: facet columns of the catalog that are indexed
+   */
+  explicit
+  FacetIndex(const std::vector<std::string>& columns);
+
+  const std::vector<std::string>&
+  getColumns() const
+  {
+    return m_columns;
+  }
+
+  /**
+   * Helper function that empties the index before it is loaded
+   *
+   * @param isCaseInsensitive: whether the columns have a case-insensitive collation
+   * @return token that tells markLoaded whether the index went stale while it was loaded
+   */
+  uint64_t
+  startLoading(bool isCaseInsensitive = false);
+
+  /**
+   * Helper function that adds a dataset, or replaces its facets
+   *
+   * @param name:   name of the dataset
+   * @param values: values of the facet columns, in the order of getColumns()
+   */
+  void
+  insert(const std::string& name, const std::vector<std::string>& values);
+
+  void
+  erase(const std::string& name);
+
+  /**
+   * Helper function that marks the index as stale, because datasets have been added without
+   * their facets
+   */
+  void
+  invalidate();
+
+  /**
+   * Helper function that makes the index usable, unless it was invalidated since startLoading
+   */
+  void
+  markLoaded(uint64_t token);
+
+  bool
+  isLoaded() const;
+
+  /**
+   * @return whether every column of the conditions is indexed
+   */
+  bool
+  canAnswer(const ConditionList& conditions) const;
+
+  /**
+   * Helper function that finds the datasets that meet all conditions
+   *
+   * @param conditions: (column, value) pairs, at least one
+   * @param names:      vector to save the names, in the order the datasets were added
+   * @return false if the index is not loaded or cannot answer the conditions
+   */
+  bool
+  find(const ConditionList& conditions, std::vector<std::string>& names) const;
+
+  /**
+   * Helper function that counts, for every column without a condition, the datasets that meet
+   * all conditions by value. Values no such dataset has are left out.
+   *
+   * @param conditions: (column, value) pairs, may be empty to count all datasets
+   * @param counts:     map to save the counts
+   * @return false if the index is not loaded or cannot answer the conditions
+   */
+  bool
+  countValues(const ConditionList& conditions, FacetCounts& counts) const;
+
+  /**
+   * @return number of datasets
+   */
+  size_t
+  size() const;
+
+private:
+  /**
+   * Datasets that have a value of a column
+   */
+  struct ValueBitmap {
+    // as first added
+    std::string value;
+    RoaringBitmap datasets;
+  };
+
+  /**
+   * Helper function that intersects the bitmaps of the conditions with the live datasets.
+   * Needs m_mutex.
+   */
+  RoaringBitmap
+  intersect(const ConditionList& conditions) const;
+
+  /**
+   * @return the value as the collation of the columns compares it, the key of its bitmap.
+   *         Needs m_mutex.
+   */
+  std::string
+  normalize(const std::string& value) const;
+
+private:
+  const std::vector<std::string> m_columns;
+
+  mutable std::mutex m_mutex;
+  // @{ needs m_mutex protection
+  // names by dataset number, empty once removed
+  std::vector<std::string> m_names;
+  std::unordered_map<std::string, uint32_t> m_ids;
+  // datasets that have not been removed
+  RoaringBitmap m_live;
+  // by column and normalized value
+  std::map<std::pair<std::string, std::string>, ValueBitmap> m_bitmaps;
+  bool m_isCaseInsensitive;
+  uint64_t m_generation;
+  bool m_isLoaded;
+  // @}
+};
+
+} // namespace util
+} // namespace atmos
+
+#endif // ATMOS_UTIL_FACET_INDEX_HPP
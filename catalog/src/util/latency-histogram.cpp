@@ -0,0 +1,103 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/latency-histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace atmos {
+namespace util {
+
+LatencyHistogram::LatencyHistogram()
+  : m_count(0)
+  , m_total(0)
+  , m_max(0)
+{
+  for (auto& bucket : m_buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void
+LatencyHistogram::record(std::chrono::microseconds latency)
+{
+  const uint64_t value = latency.count() > 0 ? latency.count() : 0;
+  m_buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_total.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t max = m_max.load(std::memory_order_relaxed);
+  while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+std::chrono::microseconds
+LatencyHistogram::getPercentile(double fraction) const
+{
+  // the buckets are read one by one while others record, so their sum is what counts
+  std::array<uint64_t, N_BUCKETS> counts;
+  uint64_t count = 0;
+  for (size_t i = 0; i < N_BUCKETS; ++i) {
+    counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+    count += counts[i];
+  }
+  if (count == 0) {
+    return std::chrono::microseconds(0);
+  }
+
+  const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * count)),
+                                           1);
+  uint64_t nBelow = 0;
+  for (size_t i = 0; i < N_BUCKETS; ++i) {
+    nBelow += counts[i];
+    if (nBelow >= rank) {
+      // no latency is above the largest one
+      return std::chrono::microseconds(std::min<uint64_t>(getUpperBound(i), getMax().count()));
+    }
+  }
+  return getMax();
+}
+
+size_t
+LatencyHistogram::getBucket(uint64_t latency)
+{
+  if (latency < 8) {
+    return latency;
+  }
+  size_t exponent = 3;
+  while (exponent < 63 && (latency >> (exponent + 1)) != 0) {
+    ++exponent;
+  }
+  // the 3 bits below the highest one pick the bucket within the power of two
+  return 8 + (exponent - 3) * 8 + ((latency >> (exponent - 3)) & 7);
+}
+
+uint64_t
+LatencyHistogram::getUpperBound(size_t bucket)
+{
+  if (bucket < 8) {
+    return bucket;
+  }
+  const size_t exponent = (bucket - 8) / 8 + 3;
+  const uint64_t width = uint64_t(1) << (exponent - 3);
+  return ((8 + (bucket - 8) % 8) << (exponent - 3)) + width - 1;
+}
+
+} // namespace util
+} // namespace atmos
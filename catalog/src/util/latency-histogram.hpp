@@ -0,0 +1,98 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_UTIL_LATENCY_HISTOGRAM_HPP
+#define ATMOS_UTIL_LATENCY_HISTOGRAM_HPP
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace atmos {
+namespace util {
+
+/**
+ * LatencyHistogram counts latencies in buckets of microseconds, so that percentiles can be
+ * read at any time without keeping the samples.
+ *
+ * Latencies below 8us have a bucket each. Above, every power of two is split into 8 buckets,
+ * so a percentile is at most 12.5% above the true value. Recording takes a few relaxed atomic
+ * additions and no lock, so that any thread can record while another reads.
+ */
+class LatencyHistogram : boost::noncopyable {
+public:
+  LatencyHistogram();
+
+  void
+  record(std::chrono::microseconds latency);
+
+  /**
+   * @return number of recorded latencies
+   */
+  uint64_t
+  getCount() const
+  {
+    return m_count.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return sum of the recorded latencies
+   */
+  std::chrono::microseconds
+  getTotal() const
+  {
+    return std::chrono::microseconds(m_total.load(std::memory_order_relaxed));
+  }
+
+  std::chrono::microseconds
+  getMax() const
+  {
+    return std::chrono::microseconds(m_max.load(std::memory_order_relaxed));
+  }
+
+  /**
+   * @param fraction: share of the latencies that are at most the percentile, e.g. 0.99
+   * @return upper bound of the bucket of the percentile, or 0 if nothing has been recorded
+   */
+  std::chrono::microseconds
+  getPercentile(double fraction) const;
+
+private:
+  static size_t
+  getBucket(uint64_t latency);
+
+  static uint64_t
+  getUpperBound(size_t bucket);
+
+private:
+  // 8 exact buckets, then 8 per power of two from 2^3 to 2^63
+  static const size_t N_BUCKETS = 8 + 61 * 8;
+
+  std::array<std::atomic<uint64_t>, N_BUCKETS> m_buckets;
+  std::atomic<uint64_t> m_count;
+  std::atomic<uint64_t> m_total;
+  std::atomic<uint64_t> m_max;
+};
+
+} // namespace util
+} // namespace atmos
+
+#endif // ATMOS_UTIL_LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,422 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/mysql-async-executor.hpp"
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <mysql/errmsg.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+namespace atmos {
+namespace util {
+// How long queries wait for a connection to be checked before they try again, if no worker
+// could check it
+static const boost::posix_time::milliseconds RETRY_INTERVAL(100);
+
+struct MySQLAsyncExecutor::Query {
+  Query(boost::asio::io_service& ioService, const std::string& query,
+        const std::vector<MySQLValue>& queryValues, const ResultCallback& callback)
+    : sqlQuery(query)
+    , values(queryValues)
+    , onResults(callback)
+    , socket(ioService)
+    , timer(ioService)
+    , isStoring(false)
+    , error(0)
+    , results(NULL)
+    , nWaits(0)
+  {
+  }
+
+  std::string sqlQuery;
+  const std::vector<MySQLValue> values;
+  const ResultCallback onResults;
+  std::shared_ptr<MYSQL> connection;
+  // a duplicate of the connection's socket, so that closing it leaves the connection alone
+  boost::asio::posix::stream_descriptor socket;
+  boost::asio::deadline_timer timer;
+  // whether the query has been sent and its results are being read
+  bool isStoring;
+  int error;
+  MYSQL_RES* results;
+  // tells the current wait from those it has replaced, whose handlers may still run
+  uint64_t nWaits;
+};
+
+#ifdef MYSQL_WAIT_READ
+/**
+ * Helper function that puts the values, escaped for the connection, into the placeholders of a
+ * query. Quoted names and strings of the query are left alone.
+ */
+static std::string
+inlineValues(MYSQL* connection, const std::string& sqlQuery,
+             const std::vector<MySQLValue>& values)
+{
+  std::string query;
+  size_t nValues = 0;
+  char quote = 0;
+  for (char c : sqlQuery) {
+    if (quote != 0) {
+      quote = c == quote ? 0 : quote;
+    }
+    else if (c == '`' || c == '\'' || c == '"') {
+      quote = c;
+    }
+    else if (c == '?' && nValues < values.size()) {
+      const MySQLValue& value = values[nValues++];
+      if (value.isInteger) {
+        query += std::to_string(value.integer);
+      }
+      else {
+        std::vector<char> escaped(value.string.size() * 2 + 1);
+        const unsigned long length = mysql_real_escape_string(connection, escaped.data(),
+                                                               value.string.data(),
+                                                               value.string.size());
+        query += '\'';
+        query.append(escaped.data(), length);
+        query += '\'';
+      }
+      continue;
+    }
+    query += c;
+  }
+  return query;
+}
+#endif
+
+MySQLAsyncExecutor::MySQLAsyncExecutor(boost::asio::io_service& ioService,
+                                       const std::shared_ptr<MySQLConnectionPool>& pool,
+                                       size_t maxPending,
+                                       const BlockingRunner& runBlocking)
+  : m_ioService(ioService)
+  , m_pool(pool)
+  , m_maxPending(maxPending)
+  , m_runBlocking(runBlocking)
+  , m_isStopped(false)
+  , m_isRetryScheduled(false)
+{
+  if (!isSupported()) {
+    throw std::runtime_error("The MySQL client library has no non-blocking API");
+  }
+}
+
+MySQLAsyncExecutor::~MySQLAsyncExecutor()
+{
+  stop();
+}
+
+bool
+MySQLAsyncExecutor::isSupported()
+{
+#ifdef MYSQL_WAIT_READ
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool
+MySQLAsyncExecutor::execute(const std::string& sqlQuery, const std::vector<MySQLValue>& values,
+                            const ResultCallback& onResults)
+{
+  std::shared_ptr<Query> query = std::make_shared<Query>(m_ioService, sqlQuery, values,
+                                                         onResults);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isStopped || m_pending.size() >= m_maxPending) {
+      return false;
+    }
+    m_pending.push_back(query);
+  }
+  std::shared_ptr<MySQLAsyncExecutor> self = shared_from_this();
+  m_ioService.post([self] { self->startQueries(); });
+  return true;
+}
+
+void
+MySQLAsyncExecutor::stop()
+{
+  std::set<std::shared_ptr<Query>> running;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isStopped = true;
+    m_pending.clear();
+    running.swap(m_running);
+  }
+  for (const auto& query : running) {
+    // the server may still be answering on the connection, so it cannot serve another query
+    if (query->connection) {
+      MySQLConnectionPool::discard(query->connection);
+      query->connection.reset();
+    }
+    boost::system::error_code ignored;
+    query->socket.close(ignored);
+    query->timer.cancel(ignored);
+  }
+}
+
+size_t
+MySQLAsyncExecutor::getNPending()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_pending.size();
+}
+
+size_t
+MySQLAsyncExecutor::getNRunning()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_running.size();
+}
+
+bool
+MySQLAsyncExecutor::isRunning(const std::shared_ptr<Query>& query)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_running.count(query) > 0;
+}
+
+void
+MySQLAsyncExecutor::startQueries()
+{
+  // only the io_service takes queries off the queue, so the front stays the same until then
+  while (true) {
+    std::shared_ptr<Query> query;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_isStopped || m_pending.empty()) {
+        return;
+      }
+      query = m_pending.front();
+    }
+
+    // nothing here may wait for the server, as the io_service serves all the Interests
+    bool isStale = false;
+    std::shared_ptr<MYSQL> connection = m_pool->tryAcquireIdle(isStale);
+    if (!connection) {
+      // the next query to finish, or connection to be re-established, starts this one
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pending.pop_front();
+      m_running.insert(query);
+    }
+    query->connection = connection;
+
+    if (!isStale) {
+      start(query);
+      continue;
+    }
+
+    std::shared_ptr<MySQLAsyncExecutor> self = shared_from_this();
+    if (m_runBlocking([self, query, connection] {
+          MySQLConnectionPool::check(connection);
+          self->m_ioService.post([self, query] {
+              if (self->isRunning(query)) {
+                // a connection that does not work makes the query fail right away
+                self->start(query);
+              }
+            });
+        })) {
+      continue;
+    }
+
+    // Nothing can check the connection now, so the query waits for another one. The
+    // connection goes back to be checked by the next one to borrow it.
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running.erase(query);
+      m_pending.push_front(query);
+    }
+    query->connection.reset();
+    MySQLConnectionPool::markStale(connection);
+    connection.reset();
+    retryLater();
+    return;
+  }
+}
+
+void
+MySQLAsyncExecutor::retryLater()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isRetryScheduled) {
+      return;
+    }
+    m_isRetryScheduled = true;
+  }
+  std::shared_ptr<MySQLAsyncExecutor> self = shared_from_this();
+  std::shared_ptr<boost::asio::deadline_timer> timer
+    = std::make_shared<boost::asio::deadline_timer>(m_ioService, RETRY_INTERVAL);
+  timer->async_wait([self, timer] (const boost::system::error_code&) {
+      {
+        std::lock_guard<std::mutex> lock(self->m_mutex);
+        self->m_isRetryScheduled = false;
+      }
+      self->startQueries();
+    });
+}
+
+void
+MySQLAsyncExecutor::start(const std::shared_ptr<Query>& query)
+{
+#ifdef MYSQL_WAIT_READ
+  MYSQL* connection = query->connection.get();
+  // sets up the context the non-blocking calls run in, once per connection
+  mysql_options(connection, MYSQL_OPT_NONBLOCK, 0);
+  boost::system::error_code error;
+  query->socket.assign(dup(mysql_get_socket(connection)), error);
+  if (error) {
+    finish(query, NULL);
+    return;
+  }
+  query->sqlQuery = inlineValues(connection, query->sqlQuery, query->values);
+  const int status = mysql_real_query_start(&query->error, connection, query->sqlQuery.data(),
+                                            query->sqlQuery.size());
+  proceed(query, status);
+#else
+  finish(query, NULL);
+#endif
+}
+
+void
+MySQLAsyncExecutor::proceed(const std::shared_ptr<Query>& query, int status)
+{
+#ifdef MYSQL_WAIT_READ
+  MYSQL* connection = query->connection.get();
+  while (status == 0) {
+    if (query->isStoring) {
+      finish(query, query->results);
+      return;
+    }
+    if (query->error != 0) {
+      finish(query, NULL);
+      return;
+    }
+    query->isStoring = true;
+    status = mysql_store_result_start(&query->results, connection);
+  }
+
+  const uint64_t nWaits = ++query->nWaits;
+  std::shared_ptr<MySQLAsyncExecutor> self = shared_from_this();
+  // exceptional conditions, such as a closed connection, also make the socket readable
+  if (status & (MYSQL_WAIT_READ | MYSQL_WAIT_EXCEPT)) {
+    query->socket.async_read_some(boost::asio::null_buffers(),
+      [self, query, nWaits] (const boost::system::error_code& error, size_t) {
+        self->onReady(query, nWaits, MYSQL_WAIT_READ, error);
+      });
+  }
+  if (status & MYSQL_WAIT_WRITE) {
+    query->socket.async_write_some(boost::asio::null_buffers(),
+      [self, query, nWaits] (const boost::system::error_code& error, size_t) {
+        self->onReady(query, nWaits, MYSQL_WAIT_WRITE, error);
+      });
+  }
+  if (status & MYSQL_WAIT_TIMEOUT) {
+    query->timer.expires_from_now(
+      boost::posix_time::milliseconds(mysql_get_timeout_value_ms(connection)));
+    query->timer.async_wait(
+      [self, query, nWaits] (const boost::system::error_code& error) {
+        self->onReady(query, nWaits, MYSQL_WAIT_TIMEOUT, error);
+      });
+  }
+#endif
+}
+
+void
+MySQLAsyncExecutor::onReady(const std::shared_ptr<Query>& query, uint64_t nWaits, int event,
+                            const boost::system::error_code& error)
+{
+#ifdef MYSQL_WAIT_READ
+  if (nWaits != query->nWaits) {
+    // another event has resumed the call already, and cancelled this one
+    return;
+  }
+  if (!isRunning(query)) {
+    // abandoned by stop
+    return;
+  }
+  ++query->nWaits;
+  boost::system::error_code ignored;
+  query->socket.cancel(ignored);
+  query->timer.cancel(ignored);
+
+  // a failed wait resumes the call too, which then reports the broken connection
+  MYSQL* connection = query->connection.get();
+  int status = 0;
+  if (query->isStoring) {
+    status = mysql_store_result_cont(&query->results, connection, event);
+  }
+  else {
+    status = mysql_real_query_cont(&query->error, connection, event);
+  }
+  proceed(query, status);
+#endif
+}
+
+void
+MySQLAsyncExecutor::finish(const std::shared_ptr<Query>& query, MYSQL_RES* results)
+{
+  std::shared_ptr<MYSQL_RES> resultsPtr;
+  if (results != NULL) {
+    resultsPtr.reset(results, &mysql_free_result);
+  }
+  boost::system::error_code ignored;
+  query->socket.close(ignored);
+  // the rows are on the client side, so the connection can serve the next query
+  std::shared_ptr<MYSQL> connection = std::move(query->connection);
+  const unsigned int error = connection ? mysql_errno(connection.get()) : 0;
+
+  bool isStopped = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running.erase(query);
+    isStopped = m_isStopped;
+  }
+  if (error == CR_SERVER_GONE_ERROR || error == CR_SERVER_LOST) {
+    // re-established before it goes back, which blocks until the server answers
+    std::shared_ptr<MySQLAsyncExecutor> self = shared_from_this();
+    const bool isQueued = m_runBlocking([self, connection] () mutable {
+        MySQLConnectionPool::check(connection);
+        connection.reset();
+        self->m_ioService.post([self] { self->startQueries(); });
+      });
+    if (!isQueued) {
+      // whoever borrows it next re-establishes it
+      MySQLConnectionPool::markStale(connection);
+    }
+  }
+  connection.reset();
+
+  if (!isStopped) {
+    query->onResults(resultsPtr);
+  }
+  startQueries();
+}
+
+} // namespace util
+} // namespace atmos
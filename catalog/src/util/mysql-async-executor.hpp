@@ -0,0 +1,194 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_UTIL_MYSQL_ASYNC_EXECUTOR_HPP
+#define ATMOS_UTIL_MYSQL_ASYNC_EXECUTOR_HPP
+
+#include "util/mysql-util.hpp"
+
+#include <boost/asio/io_service.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace atmos {
+namespace util {
+
+/**
+ * MySQLAsyncExecutor runs queries with the non-blocking API of the client library
+ * (mysql_real_query_start/_cont and mysql_store_result_start/_cont), driven by the readiness of
+ * the connection's socket on an io_service, which is normally the one of the face. A query
+ * that waits for the server takes a connection, but no thread.
+ *
+ * Each running query borrows a connection of the executor's pool, which should not be shared
+ * with blocking users, since only the executor's own queries wake up the queue. The pool should
+ * open all of its connections up front, since the executor never opens one on the io_service.
+ * Connections that have been idle for a while, or that the server has dropped, are pinged and
+ * re-established by blocking calls, which are run elsewhere. Queries beyond the connections
+ * wait in order, up to a bound. Results are stored on the client side, so the connection goes
+ * back to the pool before the callback runs.
+ *
+ * The non-blocking API has no prepared statements, so the values of a query are escaped for
+ * the connection and put into its placeholders before it is sent.
+ *
+ * The non-blocking API comes with the MariaDB client libraries. With other ones, isSupported()
+ * is false and the constructor throws.
+ */
+class MySQLAsyncExecutor : public std::enable_shared_from_this<MySQLAsyncExecutor>,
+                           boost::noncopyable {
+public:
+  /**
+   * Callback with the results of a query, or nullptr if the query failed or has no result set.
+   * It runs on the io_service, which it should not hold up.
+   */
+  typedef std::function<void(const std::shared_ptr<MYSQL_RES>& results)> ResultCallback;
+
+  /**
+   * Function that runs a task that may block off the io_service, e.g. on a worker thread, and
+   * returns false if it cannot
+   */
+  typedef std::function<bool(const std::function<void()>& task)> BlockingRunner;
+
+  /**
+   * Constructor
+   *
+   * @param ioService:  io_service that waits for the sockets and runs the callbacks
+   * @param pool:       connections of the executor
+   * @param maxPending: maximum number of queries waiting for a connection
+   * @param runBlocking: runs the pings and reconnections of the connections
+   * @throws std::runtime_error if the client library has no non-blocking API
+   */
+  MySQLAsyncExecutor(boost::asio::io_service& ioService,
+                     const std::shared_ptr<MySQLConnectionPool>& pool,
+                     size_t maxPending,
+                     const BlockingRunner& runBlocking);
+
+  ~MySQLAsyncExecutor();
+
+  /**
+   * @return whether the client library has the non-blocking API
+   */
+  static bool
+  isSupported();
+
+  /**
+   * Helper function that queues a query, from any thread
+   *
+   * @param sqlQuery: query with a ? in place of each value, see MySQLPerformStatement
+   * @param values:   values of the placeholders, in order
+   * @return false if too many queries are waiting or the executor is stopped, in which case
+   *         onResults is not called
+   */
+  bool
+  execute(const std::string& sqlQuery, const std::vector<MySQLValue>& values,
+          const ResultCallback& onResults);
+
+  /**
+   * Helper function that drops the waiting queries and abandons the running ones, none of
+   * whose callbacks are called after it returns. The connections of the running queries are
+   * closed rather than given back. Must be called on the io_service, or once it does not run
+   * anymore.
+   */
+  void
+  stop();
+
+  /**
+   * @return number of queries waiting for a connection
+   */
+  size_t
+  getNPending();
+
+  /**
+   * @return number of queries that have a connection
+   */
+  size_t
+  getNRunning();
+
+private:
+  struct Query;
+
+  /**
+   * Helper function that starts waiting queries while there are connections for them
+   */
+  void
+  startQueries();
+
+  /**
+   * Helper function that has startQueries run again after a while, when waiting queries cannot
+   * start because no connection can be checked
+   */
+  void
+  retryLater();
+
+  /**
+   * Helper function that starts a query that has a connection, once it has been checked
+   */
+  void
+  start(const std::shared_ptr<Query>& query);
+
+  /**
+   * Helper function that carries a query on after a call of the non-blocking API
+   *
+   * @param status: what the call waits for, a mask of MYSQL_WAIT_*, or 0 if it is done
+   */
+  void
+  proceed(const std::shared_ptr<Query>& query, int status);
+
+  /**
+   * Helper function that resumes the call a query waits for once the socket is ready
+   */
+  void
+  onReady(const std::shared_ptr<Query>& query, uint64_t nWaits, int event,
+          const boost::system::error_code& error);
+
+  void
+  finish(const std::shared_ptr<Query>& query, MYSQL_RES* results);
+
+  /**
+   * @return whether the query is still running, i.e. the executor has not been stopped since
+   *         it got its connection
+   */
+  bool
+  isRunning(const std::shared_ptr<Query>& query);
+
+private:
+  boost::asio::io_service& m_ioService;
+  const std::shared_ptr<MySQLConnectionPool> m_pool;
+  const size_t m_maxPending;
+  const BlockingRunner m_runBlocking;
+
+  std::mutex m_mutex;
+  // @{ needs m_mutex protection
+  std::deque<std::shared_ptr<Query>> m_pending;
+  // queries that have a connection
+  std::set<std::shared_ptr<Query>> m_running;
+  bool m_isStopped;
+  bool m_isRetryScheduled;
+  // @}
+};
+
+} // namespace util
+} // namespace atmos
+
+#endif // ATMOS_UTIL_MYSQL_ASYNC_EXECUTOR_HPP
@@ -18,10 +18,18 @@
 
 #include "util/mysql-util.hpp"
 #include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include <algorithm>
 #include <stdexcept>
 
 namespace atmos {
 namespace util {
+// Idle connections older than this are checked before being handed out
+static const std::chrono::seconds HEALTH_CHECK_INTERVAL(30);
+// Idle connections above the minimum pool size are closed after this long
+static const std::chrono::seconds IDLE_TIMEOUT(300);
+// Values of statement results longer than this are read in a second step, see fetchRow
+static const unsigned long MAX_INITIAL_VALUE_SIZE = 1024;
 
 ConnectionDetails::ConnectionDetails(const std::string& serverInput, const std::string& userInput,
                                      const std::string& passwordInput, const std::string& databaseInput)
@@ -31,39 +39,637 @@ ConnectionDetails::ConnectionDetails(const std::string& serverInput, const std::
 }
 
 
-std::shared_ptr<MYSQL>
-MySQLConnectionSetup(const ConnectionDetails& details) {
+static MYSQL*
+MySQLConnect(const ConnectionDetails& details) {
   MYSQL* conn = mysql_init(NULL);
+  if (conn == NULL) {
+    throw std::runtime_error("mysql_init failed");
+  }
+  // let mysql_ping re-establish connections that the server has closed
+  my_bool reconnect = 1;
+  mysql_options(conn, MYSQL_OPT_RECONNECT, &reconnect);
   if(!mysql_real_connect(conn, details.server.c_str(), details.user.c_str(),
                         details.password.c_str(), details.database.c_str(), 0, NULL, 0)) {
-    throw std::runtime_error(mysql_error(conn));
+    std::string error(mysql_error(conn));
+    mysql_close(conn);
+    throw std::runtime_error(error);
   }
-  std::shared_ptr<MYSQL> connection(conn, &mysql_close);
+  return conn;
+}
+
+std::shared_ptr<MYSQL>
+MySQLConnectionSetup(const ConnectionDetails& details) {
+  std::shared_ptr<MYSQL> connection(MySQLConnect(details), &mysql_close);
   return connection;
 }
 
+/**
+ * Sends the query to the server, retrying once if the server had closed the connection before
+ * the query was sent
+ *
+ * @return true if the query succeeded
+ */
+static bool
+MySQLSendQuery(const std::shared_ptr<MYSQL>& connection, const std::string& sql_query) {
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (mysql_query(connection.get(), sql_query.c_str()) == 0) {
+      return true;
+    }
+
+    const unsigned int error = mysql_errno(connection.get());
+    switch (error)
+    {
+      // The server has closed the connection, ping reconnects it before the retry. If it was
+      // lost while the query ran, the server may have applied it already, so it is not retried.
+      case CR_SERVER_GONE_ERROR:
+      case CR_SERVER_LOST:
+        if (mysql_ping(connection.get()) == 0) {
+          // the new connection has none of the prepared statements
+          MySQLStatementCache* statements = MySQLConnectionPool::getStatementCache(connection);
+          if (statements != NULL) {
+            statements->clear();
+          }
+          if (error == CR_SERVER_GONE_ERROR) {
+            continue;
+          }
+        }
+        return false;
+      // Various error cases
+      case CR_COMMANDS_OUT_OF_SYNC:
+      case CR_UNKNOWN_ERROR:
+      default:
+        return false;
+    }
+  }
+  return false;
+}
+
 std::shared_ptr<MYSQL_RES>
 MySQLPerformQuery(std::shared_ptr<MYSQL> connection, const std::string& sql_query) {
-  switch (mysql_query(connection.get(), sql_query.c_str()))
+  if (!MySQLSendQuery(connection, sql_query)) {
+    return nullptr;
+  }
+
+  MYSQL_RES* resultPtr = mysql_store_result(connection.get());
+  if (resultPtr != NULL)
   {
-    case 0:
+    return std::shared_ptr<MYSQL_RES>(resultPtr, &mysql_free_result);
+  }
+  return nullptr;
+}
+
+std::shared_ptr<MYSQL_RES>
+MySQLPerformStreamingQuery(std::shared_ptr<MYSQL> connection, const std::string& sql_query) {
+  if (!MySQLSendQuery(connection, sql_query)) {
+    return nullptr;
+  }
+
+  MYSQL_RES* resultPtr = mysql_use_result(connection.get());
+  if (resultPtr != NULL)
+  {
+    // mysql_free_result drains the rows left on the server, after which the connection can be
+    // reused
+    return std::shared_ptr<MYSQL_RES>(resultPtr, [connection] (MYSQL_RES* result) {
+        mysql_free_result(result);
+      });
+  }
+  return nullptr;
+}
+
+MySQLValue::MySQLValue(const std::string& value)
+  : string(value)
+  , integer(0)
+  , isInteger(false)
+{
+}
+
+MySQLValue::MySQLValue(uint64_t value)
+  : integer(value)
+  , isInteger(true)
+{
+}
+
+static MYSQL_STMT*
+MySQLPrepare(MYSQL* connection, const std::string& sql) {
+  MYSQL_STMT* statement = mysql_stmt_init(connection);
+  if (statement == NULL) {
+    return NULL;
+  }
+  if (mysql_stmt_prepare(statement, sql.data(), sql.size()) != 0) {
+    mysql_stmt_close(statement);
+    return NULL;
+  }
+  // lets the stored results tell the longest value of each column, to size the buffers with
+  my_bool isMaxLengthUpdated = 1;
+  mysql_stmt_attr_set(statement, STMT_ATTR_UPDATE_MAX_LENGTH, &isMaxLengthUpdated);
+  return statement;
+}
+
+MySQLStatementCache::MySQLStatementCache(size_t maxSize)
+  : m_maxSize(maxSize)
+{
+}
+
+MySQLStatementCache::~MySQLStatementCache()
+{
+  clear();
+}
+
+MYSQL_STMT*
+MySQLStatementCache::get(MYSQL* connection, const std::string& sql)
+{
+  auto entry = m_index.find(sql);
+  if (entry != m_index.end()) {
+    m_statements.splice(m_statements.begin(), m_statements, entry->second);
+    return entry->second->second;
+  }
+
+  MYSQL_STMT* statement = MySQLPrepare(connection, sql);
+  if (statement == NULL) {
+    return NULL;
+  }
+  if (!m_statements.empty() && m_statements.size() >= m_maxSize) {
+    mysql_stmt_close(m_statements.back().second);
+    m_index.erase(m_statements.back().first);
+    m_statements.pop_back();
+  }
+  m_statements.emplace_front(sql, statement);
+  m_index[sql] = m_statements.begin();
+  return statement;
+}
+
+void
+MySQLStatementCache::clear()
+{
+  for (const auto& statement : m_statements) {
+    mysql_stmt_close(statement.second);
+  }
+  m_statements.clear();
+  m_index.clear();
+}
+
+MySQLStatementResults::MySQLStatementResults(const std::shared_ptr<MYSQL>& connection,
+                                             const std::shared_ptr<MYSQL_STMT>& statement,
+                                             size_t nColumns)
+  : m_connection(connection)
+  , m_statement(statement)
+  , m_buffers(nColumns)
+  , m_binds(nColumns)
+  , m_lengths(nColumns)
+  , m_isNull(nColumns)
+  , m_isTruncated(nColumns)
+  , m_row(nColumns)
+  , m_hasFailed(false)
+{
+  // Stored results know their longest values, streamed ones only the declared sizes
+  MYSQL_RES* metadata = mysql_stmt_result_metadata(m_statement.get());
+  MYSQL_FIELD* fields = metadata != NULL ? mysql_fetch_fields(metadata) : NULL;
+  for (size_t i = 0; i < nColumns; ++i) {
+    unsigned long size = MAX_INITIAL_VALUE_SIZE;
+    if (fields != NULL) {
+      size = fields[i].max_length > 0 ? fields[i].max_length
+                                      : std::min(fields[i].length, MAX_INITIAL_VALUE_SIZE);
+    }
+    // with room for the NUL, so that values can be read as C strings
+    m_buffers[i].resize(size + 1);
+    m_binds[i].buffer_type = MYSQL_TYPE_STRING;
+    m_binds[i].buffer = m_buffers[i].data();
+    m_binds[i].buffer_length = m_buffers[i].size();
+    m_binds[i].length = &m_lengths[i];
+    m_binds[i].is_null = &m_isNull[i];
+    m_binds[i].error = &m_isTruncated[i];
+  }
+  if (metadata != NULL) {
+    mysql_free_result(metadata);
+  }
+  mysql_stmt_bind_result(m_statement.get(), m_binds.data());
+}
+
+MySQLStatementResults::~MySQLStatementResults()
+{
+  // drains the rows left on the server, after which the statement can run again
+  mysql_stmt_free_result(m_statement.get());
+}
+
+const char* const*
+MySQLStatementResults::fetchRow()
+{
+  const int status = mysql_stmt_fetch(m_statement.get());
+  if (status == MYSQL_NO_DATA) {
+    return NULL;
+  }
+  if (status != 0 && status != MYSQL_DATA_TRUNCATED) {
+    m_hasFailed = true;
+    return NULL;
+  }
+
+  bool isRebound = false;
+  for (size_t i = 0; i < m_row.size(); ++i) {
+    if (m_isNull[i]) {
+      m_row[i] = NULL;
+      continue;
+    }
+    if (m_isTruncated[i]) {
+      // the buffer grows to the value, which is then read again, as are longer ones after it
+      m_buffers[i].resize(m_lengths[i] + 1);
+      m_binds[i].buffer = m_buffers[i].data();
+      m_binds[i].buffer_length = m_buffers[i].size();
+      mysql_stmt_fetch_column(m_statement.get(), &m_binds[i], i, 0);
+      isRebound = true;
+    }
+    m_buffers[i][m_lengths[i]] = '\0';
+    m_row[i] = m_buffers[i].data();
+  }
+  if (isRebound) {
+    mysql_stmt_bind_result(m_statement.get(), m_binds.data());
+  }
+  return m_row.data();
+}
+
+std::shared_ptr<MySQLStatementResults>
+MySQLPerformStatement(std::shared_ptr<MYSQL> connection, const std::string& sql,
+                      const std::vector<MySQLValue>& values, bool isStreaming) {
+  std::vector<MYSQL_BIND> params(values.size());
+  std::vector<unsigned long> lengths(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (values[i].isInteger) {
+      params[i].buffer_type = MYSQL_TYPE_LONGLONG;
+      params[i].buffer = const_cast<uint64_t*>(&values[i].integer);
+      params[i].is_unsigned = 1;
+    }
+    else {
+      lengths[i] = values[i].string.size();
+      params[i].buffer_type = MYSQL_TYPE_STRING;
+      params[i].buffer = const_cast<char*>(values[i].string.data());
+      params[i].buffer_length = lengths[i];
+      params[i].length = &lengths[i];
+    }
+  }
+
+  MySQLStatementCache* statements = MySQLConnectionPool::getStatementCache(connection);
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    std::shared_ptr<MYSQL_STMT> statement;
+    if (statements != NULL) {
+      MYSQL_STMT* cached = statements->get(connection.get(), sql);
+      if (cached != NULL) {
+        // closed by the cache
+        statement.reset(cached, [] (MYSQL_STMT*) {});
+      }
+    }
+    else {
+      MYSQL_STMT* prepared = MySQLPrepare(connection.get(), sql);
+      if (prepared != NULL) {
+        statement.reset(prepared, &mysql_stmt_close);
+      }
+    }
+
+    unsigned int error = 0;
+    // whether the server may have run the statement, which is then not tried again
+    bool isSent = false;
+    if (!statement) {
+      error = mysql_errno(connection.get());
+    }
+    else if (mysql_stmt_param_count(statement.get()) != values.size()) {
+      return nullptr;
+    }
+    else if (mysql_stmt_bind_param(statement.get(), params.data()) != 0) {
+      error = mysql_stmt_errno(statement.get());
+    }
+    else if (mysql_stmt_execute(statement.get()) != 0) {
+      error = mysql_stmt_errno(statement.get());
+      isSent = true;
+    }
+    else {
+      MYSQL_RES* metadata = mysql_stmt_result_metadata(statement.get());
+      if (metadata == NULL) {
+        return nullptr;
+      }
+      const size_t nColumns = mysql_num_fields(metadata);
+      mysql_free_result(metadata);
+      if (!isStreaming && mysql_stmt_store_result(statement.get()) != 0) {
+        mysql_stmt_free_result(statement.get());
+        return nullptr;
+      }
+      return std::make_shared<MySQLStatementResults>(connection, statement, nColumns);
+    }
+
+    switch (error)
     {
-      MYSQL_RES* resultPtr = mysql_store_result(connection.get());
-      if (resultPtr != NULL)
+      // The server has closed the connection, ping reconnects it before the retry. A statement
+      // that was lost while it ran may have been applied already, so it is not retried.
+      case CR_SERVER_GONE_ERROR:
+      case CR_SERVER_LOST:
+        statement.reset();
+        if (statements != NULL) {
+          statements->clear();
+        }
+        if (mysql_ping(connection.get()) == 0 &&
+            (error == CR_SERVER_GONE_ERROR || !isSent)) {
+          continue;
+        }
+        return nullptr;
+      // The connection has been re-established since the statement was prepared
+      case ER_UNKNOWN_STMT_HANDLER:
+        statement.reset();
+        if (statements != NULL) {
+          statements->clear();
+          continue;
+        }
+        return nullptr;
+      default:
+        return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+MySQLConnectionPool::MySQLConnectionPool(const ConnectionDetails& details,
+                                         size_t minSize, size_t maxSize, size_t maxStatements)
+  : m_details(details)
+  , m_minSize(minSize)
+  , m_maxSize(maxSize)
+  , m_maxStatements(maxStatements)
+  , m_nOpen(0)
+{
+  if (maxSize == 0 || minSize > maxSize) {
+    throw std::invalid_argument("Invalid MySQL connection pool size");
+  }
+  // must happen before any thread uses the client library
+  mysql_library_init(0, NULL, NULL);
+
+  try {
+    for (size_t i = 0; i < m_minSize; ++i) {
+      IdleConnection idle = {MySQLConnect(m_details), std::chrono::steady_clock::now(),
+                             std::make_shared<MySQLStatementCache>(m_maxStatements)};
+      m_idle.push_back(idle);
+      ++m_nOpen;
+    }
+  }
+  catch (const std::runtime_error&) {
+    for (auto& idle : m_idle) {
+      close(idle);
+    }
+    throw;
+  }
+}
+
+MySQLConnectionPool::~MySQLConnectionPool()
+{
+  // borrowed connections are closed by their holders, as the pool is gone by then
+  for (auto& idle : m_idle) {
+    close(idle);
+  }
+}
+
+// Sets up the client library for the thread that creates it, and frees what it allocated for
+// the thread when the thread exits
+struct MySQLThreadGuard
+{
+  MySQLThreadGuard()
+  {
+    mysql_thread_init();
+  }
+
+  ~MySQLThreadGuard()
+  {
+    mysql_thread_end();
+  }
+};
+
+static void
+initMySQLThread()
+{
+  // every thread that uses the client library needs this once
+  static thread_local MySQLThreadGuard guard;
+}
+
+std::shared_ptr<MYSQL>
+MySQLConnectionPool::acquire()
+{
+  initMySQLThread();
+
+  IdleConnection idle = {NULL, std::chrono::steady_clock::time_point(), nullptr};
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_isAvailable.wait(lock, [this] { return !m_idle.empty() || m_nOpen < m_maxSize; });
+    if (!m_idle.empty()) {
+      idle = m_idle.back();
+      m_idle.pop_back();
+    }
+    else {
+      // reserve the slot, the connection is opened outside of the lock
+      ++m_nOpen;
+    }
+  }
+  return lend(idle);
+}
+
+std::shared_ptr<MYSQL>
+MySQLConnectionPool::tryAcquire()
+{
+  initMySQLThread();
+
+  IdleConnection idle = {NULL, std::chrono::steady_clock::time_point(), nullptr};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_idle.empty()) {
+      idle = m_idle.back();
+      m_idle.pop_back();
+    }
+    else if (m_nOpen < m_maxSize) {
+      ++m_nOpen;
+    }
+    else {
+      return nullptr;
+    }
+  }
+  return lend(idle);
+}
+
+std::shared_ptr<MYSQL>
+MySQLConnectionPool::tryAcquireIdle(bool& isStale)
+{
+  initMySQLThread();
+
+  IdleConnection idle = {NULL, std::chrono::steady_clock::time_point(), nullptr};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_idle.empty()) {
+      return nullptr;
+    }
+    idle = m_idle.back();
+    m_idle.pop_back();
+  }
+  isStale = std::chrono::steady_clock::now() - idle.lastUsed > HEALTH_CHECK_INTERVAL;
+
+  ConnectionReturner returner;
+  returner.pool = shared_from_this();
+  returner.statements = idle.statements;
+  returner.isDiscarded = false;
+  returner.isStale = false;
+  return std::shared_ptr<MYSQL>(idle.connection, returner);
+}
+
+bool
+MySQLConnectionPool::check(const std::shared_ptr<MYSQL>& connection)
+{
+  const unsigned long threadId = mysql_thread_id(connection.get());
+  if (mysql_ping(connection.get()) != 0) {
+    return false;
+  }
+  if (mysql_thread_id(connection.get()) != threadId) {
+    // ping has re-established the connection, and the server has forgotten the statements
+    MySQLStatementCache* statements = getStatementCache(connection);
+    if (statements != NULL) {
+      statements->clear();
+    }
+  }
+  return true;
+}
+
+void
+MySQLConnectionPool::discard(const std::shared_ptr<MYSQL>& connection)
+{
+  ConnectionReturner* returner = std::get_deleter<ConnectionReturner>(connection);
+  if (returner != NULL) {
+    returner->isDiscarded = true;
+  }
+}
+
+void
+MySQLConnectionPool::markStale(const std::shared_ptr<MYSQL>& connection)
+{
+  ConnectionReturner* returner = std::get_deleter<ConnectionReturner>(connection);
+  if (returner != NULL) {
+    returner->isStale = true;
+  }
+}
+
+std::shared_ptr<MYSQL>
+MySQLConnectionPool::lend(IdleConnection idle)
+{
+  if (idle.connection != NULL &&
+      std::chrono::steady_clock::now() - idle.lastUsed > HEALTH_CHECK_INTERVAL) {
+    const unsigned long threadId = mysql_thread_id(idle.connection);
+    if (mysql_ping(idle.connection) != 0) {
+      close(idle);
+      idle.connection = NULL;
+    }
+    else if (mysql_thread_id(idle.connection) != threadId) {
+      // ping has re-established the connection, and the server has forgotten the statements
+      idle.statements->clear();
+    }
+  }
+
+  if (idle.connection == NULL) {
+    try {
+      idle.connection = MySQLConnect(m_details);
+    }
+    catch (const std::runtime_error&) {
       {
-        return std::shared_ptr<MYSQL_RES>(resultPtr, &mysql_free_result);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_nOpen;
       }
-      break;
+      m_isAvailable.notify_one();
+      throw;
     }
-    // Various error cases
-    case CR_COMMANDS_OUT_OF_SYNC:
-    case CR_SERVER_GONE_ERROR:
-    case CR_SERVER_LOST:
-    case CR_UNKNOWN_ERROR:
-    default:
-      break;
+    idle.statements = std::make_shared<MySQLStatementCache>(m_maxStatements);
   }
-  return nullptr;
+
+  ConnectionReturner returner;
+  returner.pool = shared_from_this();
+  returner.statements = idle.statements;
+  returner.isDiscarded = false;
+  returner.isStale = false;
+  return std::shared_ptr<MYSQL>(idle.connection, returner);
+}
+
+size_t
+MySQLConnectionPool::getSize()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_nOpen;
+}
+
+size_t
+MySQLConnectionPool::getIdleSize()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_idle.size();
+}
+
+MySQLStatementCache*
+MySQLConnectionPool::getStatementCache(const std::shared_ptr<MYSQL>& connection)
+{
+  const ConnectionReturner* returner = std::get_deleter<ConnectionReturner>(connection);
+  return returner != NULL ? returner->statements.get() : NULL;
+}
+
+void
+MySQLConnectionPool::ConnectionReturner::operator()(MYSQL* connection) const
+{
+  std::shared_ptr<MySQLConnectionPool> owner = pool.lock();
+  if (owner && !isDiscarded) {
+    owner->release(connection, statements, isStale);
+    return;
+  }
+  // closing the connection first leaves the statements nothing to tell the server
+  mysql_close(connection);
+  statements->clear();
+  if (owner) {
+    owner->forget();
+  }
+}
+
+void
+MySQLConnectionPool::release(MYSQL* connection,
+                             const std::shared_ptr<MySQLStatementCache>& statements,
+                             bool isStale)
+{
+  std::vector<IdleConnection> expired;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (isStale) {
+      // the oldest idle time, so that it is the last one handed out and the first one closed
+      IdleConnection idle = {connection, std::chrono::steady_clock::time_point(), statements};
+      m_idle.push_front(idle);
+    }
+    else {
+      IdleConnection idle = {connection, now, statements};
+      m_idle.push_back(idle);
+    }
+
+    // shrink back towards the minimum size once the load has gone
+    while (m_nOpen > m_minSize && now - m_idle.front().lastUsed > IDLE_TIMEOUT) {
+      expired.push_back(m_idle.front());
+      m_idle.pop_front();
+      --m_nOpen;
+    }
+  }
+  m_isAvailable.notify_one();
+
+  for (auto& idle : expired) {
+    close(idle);
+  }
+}
+
+void
+MySQLConnectionPool::forget()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    --m_nOpen;
+  }
+  m_isAvailable.notify_one();
+}
+
+void
+MySQLConnectionPool::close(IdleConnection& idle)
+{
+  // the statements are closed on the server while the connection is still open
+  idle.statements.reset();
+  mysql_close(idle.connection);
 }
 
 } // namespace util
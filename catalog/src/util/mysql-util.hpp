@@ -21,11 +21,27 @@
 
 #include "mysql/mysql.h"
 
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace atmos {
 namespace util {
+// Connections kept by a pool, unless configured otherwise
+static const size_t DEFAULT_MIN_CONNECTIONS = 1;
+static const size_t DEFAULT_MAX_CONNECTIONS = 8;
+// Prepared statements kept per connection of a pool
+static const size_t DEFAULT_MAX_STATEMENTS = 64;
+
 struct ConnectionDetails {
 public:
   std::string server;
@@ -40,9 +56,313 @@ public:
 std::shared_ptr<MYSQL>
 MySQLConnectionSetup(const ConnectionDetails& details);
 
+/**
+ * Runs the query and stores its results on the client side. If the server has gone away (e.g.,
+ * the connection was idle for longer than wait_timeout), the connection is re-established and
+ * the query is tried once more. A connection lost while the query ran is re-established too,
+ * but the query fails, since the server may have applied it already.
+ *
+ * @return the results, or nullptr if the query failed or has no result set
+ */
 std::shared_ptr<MYSQL_RES>
 MySQLPerformQuery(std::shared_ptr<MYSQL> connection, const std::string& sql_query);
 
+/**
+ * Runs the query like MySQLPerformQuery, but leaves the rows on the server so that they can be
+ * fetched one by one as they are consumed. Client memory stays flat regardless of the size of
+ * the result set.
+ *
+ * The connection is busy until the returned results are released, and the returned pointer keeps
+ * it borrowed until then. No row count is available before all the rows have been fetched.
+ *
+ * @return the results, or nullptr if the query failed or has no result set
+ */
+std::shared_ptr<MYSQL_RES>
+MySQLPerformStreamingQuery(std::shared_ptr<MYSQL> connection, const std::string& sql_query);
+
+/**
+ * Value bound to a placeholder of a prepared statement. Numbers are bound as such, since MySQL
+ * takes nothing else in places such as LIMIT.
+ */
+struct MySQLValue {
+  MySQLValue(const std::string& value);
+
+  MySQLValue(uint64_t value);
+
+  std::string string;
+  uint64_t integer;
+  bool isInteger;
+};
+
+/**
+ * MySQLStatementCache keeps the statements prepared on one connection, by their text, so that
+ * the server parses and plans queries of the same shape only once. Each statement holds
+ * resources on the server, so the least recently used one is closed when the cache is full.
+ *
+ * Like the connection, the cache must not be used by two threads at once.
+ */
+class MySQLStatementCache : boost::noncopyable {
+public:
+  explicit
+  MySQLStatementCache(size_t maxSize);
+
+  ~MySQLStatementCache();
+
+  /**
+   * @return the statement with this text, which is prepared on the connection if it is not in
+   *         the cache yet, or NULL if it cannot be prepared
+   */
+  MYSQL_STMT*
+  get(MYSQL* connection, const std::string& sql);
+
+  /**
+   * Helper function that closes all statements, e.g. because the connection has been
+   * re-established and the server has forgotten them
+   */
+  void
+  clear();
+
+  size_t
+  size() const
+  {
+    return m_statements.size();
+  }
+
+private:
+  typedef std::list<std::pair<std::string, MYSQL_STMT*>> StatementList;
+
+  const size_t m_maxSize;
+  // most recently used first
+  StatementList m_statements;
+  std::unordered_map<std::string, StatementList::iterator> m_index;
+};
+
+/**
+ * MySQLStatementResults reads the rows of an executed statement, as mysql_fetch_row and
+ * mysql_fetch_lengths do for the results of a query. Values come in the text form of the
+ * columns, and are NULL for NULL.
+ *
+ * The connection stays borrowed until the results are released.
+ */
+class MySQLStatementResults : boost::noncopyable {
+public:
+  /**
+   * Constructor, which binds the columns of the executed statement
+   *
+   * @param connection: connection the statement has been executed on
+   * @param statement:  statement whose results are read, not freed before the results are
+   */
+  MySQLStatementResults(const std::shared_ptr<MYSQL>& connection,
+                        const std::shared_ptr<MYSQL_STMT>& statement,
+                        size_t nColumns);
+
+  ~MySQLStatementResults();
+
+  /**
+   * @return the next row, or NULL after the last one or on an error, which hasFailed then tells
+   */
+  const char* const*
+  fetchRow();
+
+  /**
+   * @return whether fetchRow has stopped because of an error, e.g. the connection was lost
+   *         while streamed rows were read, rather than after the last row
+   */
+  bool
+  hasFailed() const
+  {
+    return m_hasFailed;
+  }
+
+  /**
+   * @return lengths of the values of the current row
+   */
+  const unsigned long*
+  fetchLengths() const
+  {
+    return m_lengths.data();
+  }
+
+private:
+  const std::shared_ptr<MYSQL> m_connection;
+  const std::shared_ptr<MYSQL_STMT> m_statement;
+  std::vector<std::vector<char>> m_buffers;
+  std::vector<MYSQL_BIND> m_binds;
+  std::vector<unsigned long> m_lengths;
+  std::vector<my_bool> m_isNull;
+  std::vector<my_bool> m_isTruncated;
+  std::vector<const char*> m_row;
+  bool m_hasFailed;
+};
+
+/**
+ * Runs a statement with its placeholders bound to the values. If the connection belongs to a
+ * pool, the statement is prepared once and then taken from the connection's cache; otherwise,
+ * it is prepared for this run only. Like MySQLPerformQuery, the statement is tried once more if
+ * the server has gone away before it ran.
+ *
+ * @param isStreaming: whether the rows are left on the server until they are fetched, see
+ *                     MySQLPerformStreamingQuery, rather than stored on the client side
+ * @return the results, or nullptr if the statement failed or has no result set
+ */
+std::shared_ptr<MySQLStatementResults>
+MySQLPerformStatement(std::shared_ptr<MYSQL> connection, const std::string& sql,
+                      const std::vector<MySQLValue>& values, bool isStreaming = false);
+
+/**
+ * MySQLConnectionPool shares a bounded set of connections to one database between threads.
+ *
+ * A MYSQL handle must not be used by two threads at once, so each query borrows a connection
+ * for as long as it needs it. The pool must be owned by a std::shared_ptr.
+ */
+class MySQLConnectionPool : public std::enable_shared_from_this<MySQLConnectionPool>,
+                            boost::noncopyable {
+public:
+  /**
+   * Constructor, which opens the minimum number of connections right away
+   *
+   * @param details: database to connect to
+   * @param minSize: number of connections kept open even when they are idle
+   * @param maxSize: maximum number of connections open at the same time
+   * @param maxStatements: number of prepared statements kept per connection
+   * @throws std::runtime_error if a connection cannot be opened
+   */
+  MySQLConnectionPool(const ConnectionDetails& details, size_t minSize, size_t maxSize,
+                      size_t maxStatements = DEFAULT_MAX_STATEMENTS);
+
+  ~MySQLConnectionPool();
+
+  /**
+   * Borrows a connection, waiting while all the connections are in use. The connection goes
+   * back to the pool when the last copy of the returned pointer is released.
+   *
+   * Connections that have been idle for a while are pinged first, and replaced if the server
+   * does not answer.
+   *
+   * @throws std::runtime_error if a new connection cannot be opened
+   */
+  std::shared_ptr<MYSQL>
+  acquire();
+
+  /**
+   * Borrows a connection like acquire, but does not wait
+   *
+   * @return the connection, or nullptr if all the connections are in use
+   * @throws std::runtime_error if a new connection cannot be opened
+   */
+  std::shared_ptr<MYSQL>
+  tryAcquire();
+
+  /**
+   * Borrows an idle connection like tryAcquire, but without any call that blocks until the
+   * server answers: no connection is opened, and one that has been idle for a while is handed
+   * out unchecked, for the caller to check elsewhere.
+   *
+   * @param isStale: set to whether the connection should be checked before it is used
+   * @return the connection, or nullptr if none is idle
+   */
+  std::shared_ptr<MYSQL>
+  tryAcquireIdle(bool& isStale);
+
+  /**
+   * Helper function that pings a borrowed connection, which re-establishes it if the server has
+   * closed it. It blocks until the server answers.
+   *
+   * @return whether the connection works
+   */
+  static bool
+  check(const std::shared_ptr<MYSQL>& connection);
+
+  /**
+   * Helper function that has a borrowed connection closed, instead of given back to the pool,
+   * once it is released. That is for connections left in the middle of a query, which the
+   * server would still be answering on.
+   */
+  static void
+  discard(const std::shared_ptr<MYSQL>& connection);
+
+  /**
+   * Helper function that has a borrowed connection checked by whoever borrows it next, as if
+   * it had been idle for long, instead of counting as just used once it is released. That is
+   * for connections that should have been checked but could not be.
+   */
+  static void
+  markStale(const std::shared_ptr<MYSQL>& connection);
+
+  /**
+   * @return number of open connections, both borrowed and idle
+   */
+  size_t
+  getSize();
+
+  /**
+   * @return number of idle connections
+   */
+  size_t
+  getIdleSize();
+
+  /**
+   * @return the prepared statements of a connection borrowed from a pool, which go with it
+   *         while it is borrowed, or NULL if it does not come from a pool
+   */
+  static MySQLStatementCache*
+  getStatementCache(const std::shared_ptr<MYSQL>& connection);
+
+private:
+  struct IdleConnection {
+    MYSQL* connection;
+    std::chrono::steady_clock::time_point lastUsed;
+    std::shared_ptr<MySQLStatementCache> statements;
+  };
+
+  /**
+   * Deleter of the borrowed connections, which gives them back with their statements
+   */
+  struct ConnectionReturner {
+    void
+    operator()(MYSQL* connection) const;
+
+    std::weak_ptr<MySQLConnectionPool> pool;
+    std::shared_ptr<MySQLStatementCache> statements;
+    bool isDiscarded;
+    bool isStale;
+  };
+
+  /**
+   * Helper function that hands out a connection taken from the idle ones, or opens one in a
+   * reserved slot if idle.connection is NULL
+   */
+  std::shared_ptr<MYSQL>
+  lend(IdleConnection idle);
+
+  void
+  release(MYSQL* connection, const std::shared_ptr<MySQLStatementCache>& statements,
+          bool isStale);
+
+  /**
+   * Helper function that frees the slot of a borrowed connection that has been closed
+   */
+  void
+  forget();
+
+  static void
+  close(IdleConnection& idle);
+
+private:
+  const ConnectionDetails m_details;
+  const size_t m_minSize;
+  const size_t m_maxSize;
+  const size_t m_maxStatements;
+
+  std::mutex m_mutex;
+  std::condition_variable m_isAvailable;
+  // @{ needs m_mutex protection
+  // most recently used connections are at the back
+  std::deque<IdleConnection> m_idle;
+  size_t m_nOpen;
+  // @}
+};
+
 } // namespace util
 } // namespace atmos
 #endif //ATMOS_UTIL_CONNECTION_DETAILS_HPP
@@ -0,0 +1,267 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/name-trie.hpp"
+
+#include <queue>
+
+namespace atmos {
+namespace util {
+
+// Components of catalog names are separated by this character
+static const char SEPARATOR = '/';
+
+static size_t
+getCommonPrefixLength(const std::string& label, const std::string& name, size_t pos)
+{
+  size_t length = 0;
+  while (length < label.size() && pos + length < name.size() &&
+         label[length] == name[pos + length]) {
+    ++length;
+  }
+  return length;
+}
+
+NameTrie::NameTrie()
+{
+}
+
+bool
+NameTrie::insert(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t nLabelChars = 0;
+  const Node* existing = findNode(name, nLabelChars);
+  if (existing != nullptr && existing->isName && nLabelChars == existing->label.size()) {
+    return false;
+  }
+
+  Node* node = &m_root;
+  ++node->nNames;
+  size_t pos = 0;
+  while (pos < name.size()) {
+    auto child = node->children.find(name[pos]);
+    if (child == node->children.end()) {
+      std::unique_ptr<Node> leaf(new Node);
+      leaf->label = name.substr(pos);
+      leaf->isName = true;
+      leaf->nNames = 1;
+      node->children[name[pos]] = std::move(leaf);
+      return true;
+    }
+
+    const size_t length = getCommonPrefixLength(child->second->label, name, pos);
+    if (length < child->second->label.size()) {
+      // the name leaves the edge halfway, so the edge is split where it does
+      std::unique_ptr<Node> middle(new Node);
+      middle->label = child->second->label.substr(0, length);
+      middle->nNames = child->second->nNames;
+      std::unique_ptr<Node> lower = std::move(child->second);
+      lower->label.erase(0, length);
+      const char key = lower->label[0];
+      middle->children[key] = std::move(lower);
+      child->second = std::move(middle);
+    }
+    node = child->second.get();
+    ++node->nNames;
+    pos += length;
+  }
+  node->isName = true;
+  return true;
+}
+
+bool
+NameTrie::erase(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t nLabelChars = 0;
+  const Node* existing = findNode(name, nLabelChars);
+  if (existing == nullptr || !existing->isName || nLabelChars != existing->label.size()) {
+    return false;
+  }
+
+  std::vector<Node*> path(1, &m_root);
+  size_t pos = 0;
+  while (pos < name.size()) {
+    Node* child = path.back()->children[name[pos]].get();
+    pos += child->label.size();
+    path.push_back(child);
+  }
+  for (Node* node : path) {
+    --node->nNames;
+  }
+  path.back()->isName = false;
+
+  // Nodes without names are removed, and the ones left with a single child are merged, from
+  // the bottom up
+  for (size_t i = path.size() - 1; i > 0; --i) {
+    Node* node = path[i];
+    if (node->nNames == 0) {
+      path[i - 1]->children.erase(node->label[0]);
+    }
+    else if (!node->isName && node->children.size() == 1) {
+      merge(*node);
+    }
+  }
+  return true;
+}
+
+void
+NameTrie::merge(Node& node)
+{
+  std::unique_ptr<Node> child = std::move(node.children.begin()->second);
+  node.children.clear();
+  node.label += child->label;
+  node.isName = child->isName;
+  node.children = std::move(child->children);
+}
+
+bool
+NameTrie::contains(const std::string& name) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t nLabelChars = 0;
+  const Node* node = findNode(name, nLabelChars);
+  return node != nullptr && node->isName && nLabelChars == node->label.size();
+}
+
+size_t
+NameTrie::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_root.nNames;
+}
+
+const NameTrie::Node*
+NameTrie::findNode(const std::string& prefix, size_t& nLabelChars) const
+{
+  const Node* node = &m_root;
+  nLabelChars = 0;
+  size_t pos = 0;
+  while (pos < prefix.size()) {
+    auto child = node->children.find(prefix[pos]);
+    if (child == node->children.end()) {
+      return nullptr;
+    }
+    const size_t length = getCommonPrefixLength(child->second->label, prefix, pos);
+    if (pos + length < prefix.size() && length < child->second->label.size()) {
+      // the prefix leaves the edge halfway
+      return nullptr;
+    }
+    node = child->second.get();
+    nLabelChars = length;
+    pos += length;
+  }
+  return node;
+}
+
+std::vector<std::string>
+NameTrie::findNextComponents(const std::string& prefix, size_t limit) const
+{
+  std::vector<std::string> completions;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t nLabelChars = 0;
+  const Node* node = findNode(prefix, nLabelChars);
+  if (node == nullptr) {
+    return completions;
+  }
+
+  std::string path(prefix);
+  collect(*node, nLabelChars, prefix.size(), path,
+          [&] (size_t) { return completions.size() < limit; },
+          [&] (const std::string& completion, size_t) {
+            if (completions.size() < limit) {
+              completions.push_back(completion);
+            }
+          });
+  return completions;
+}
+
+std::vector<std::string>
+NameTrie::findTopNextComponents(const std::string& prefix, size_t k) const
+{
+  typedef std::pair<size_t, std::string> Completion;
+  // orders the best completion first: more names, then lexicographically smaller
+  auto isBetter = [] (const Completion& a, const Completion& b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+  };
+  // the worst of the best k completions is on top
+  std::priority_queue<Completion, std::vector<Completion>, decltype(isBetter)> best(isBetter);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t nLabelChars = 0;
+    const Node* node = findNode(prefix, nLabelChars);
+    if (node == nullptr || k == 0) {
+      return std::vector<std::string>();
+    }
+
+    std::string path(prefix);
+    // completions are visited in lexicographic order, so a later one needs strictly more names
+    // to beat the worst of the best
+    collect(*node, nLabelChars, prefix.size(), path,
+            [&] (size_t nNames) { return best.size() < k || nNames > best.top().first; },
+            [&] (const std::string& completion, size_t nNames) {
+              if (best.size() < k) {
+                best.push(Completion(nNames, completion));
+              }
+              else if (nNames > best.top().first) {
+                best.pop();
+                best.push(Completion(nNames, completion));
+              }
+            });
+  }
+
+  std::vector<std::string> completions(best.size());
+  for (size_t i = completions.size(); i > 0; --i) {
+    completions[i - 1] = best.top().second;
+    best.pop();
+  }
+  return completions;
+}
+
+void
+NameTrie::collect(const Node& node, size_t labelBegin, size_t prefixSize, std::string& path,
+                  const SubtreeFilter& filter, const CompletionVisitor& visit)
+{
+  if (!filter(node.nNames)) {
+    return;
+  }
+
+  const size_t pathSize = path.size();
+  for (size_t i = labelBegin; i < node.label.size(); ++i) {
+    path.push_back(node.label[i]);
+    // the separator right after the prefix starts the next component rather than ending it
+    if (node.label[i] == SEPARATOR && path.size() > prefixSize + 1) {
+      visit(path, node.nNames);
+      path.resize(pathSize);
+      return;
+    }
+  }
+
+  if (node.isName && path.size() > prefixSize) {
+    visit(path, 1);
+  }
+  for (const auto& child : node.children) {
+    collect(*child.second, 0, prefixSize, path, filter, visit);
+  }
+  path.resize(pathSize);
+}
+
+} // namespace util
+} // namespace atmos
@@ -0,0 +1,156 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_UTIL_NAME_TRIE_HPP
+#define ATMOS_UTIL_NAME_TRIE_HPP
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace atmos {
+namespace util {
+
+/**
+ * NameTrie keeps the names of the catalog in memory for prefix autocompletion.
+ *
+ * It is a radix tree over the characters of the names: every edge carries the longest string
+ * the names below it share, so a path has one node per branching point rather than per
+ * character. Every node counts the names below it, which ranks the completions without
+ * walking the whole subtree.
+ *
+ * NameTrie is thread-safe.
+ */
+class NameTrie : boost::noncopyable {
+public:
+  NameTrie();
+
+  /**
+   * @return whether the name was not in the trie yet
+   */
+  bool
+  insert(const std::string& name);
+
+  /**
+   * @return whether the name was in the trie
+   */
+  bool
+  erase(const std::string& name);
+
+  bool
+  contains(const std::string& name) const;
+
+  /**
+   * @return number of names
+   */
+  size_t
+  size() const;
+
+  /**
+   * Helper function that lists how the names under a prefix continue, up to the end of the
+   * next name component
+   *
+   * Each completion is the prefix extended up to and including the next '/' after it, or to
+   * the end of a name that has no more components. So "/CMIP5/out" may complete to
+   * "/CMIP5/output1/" and "/CMIP5/output2/", however many names are under those.
+   *
+   * @param prefix: what has been typed so far
+   * @param limit:  maximum number of completions
+   * @return distinct completions in lexicographic order
+   */
+  std::vector<std::string>
+  findNextComponents(const std::string& prefix, size_t limit = SIZE_MAX) const;
+
+  /**
+   * Helper function that finds the k completions with the most names under them, see
+   * findNextComponents
+   *
+   * Only k completions are kept at a time, and subtrees with fewer names than the worst of
+   * them are not visited at all.
+   *
+   * @return at most k completions, those with more names first, then in lexicographic order
+   */
+  std::vector<std::string>
+  findTopNextComponents(const std::string& prefix, size_t k) const;
+
+private:
+  struct Node {
+    Node()
+      : isName(false)
+      , nNames(0)
+    {
+    }
+
+    // characters on the edge from the parent
+    std::string label;
+    // whether the path to this node is a name itself
+    bool isName;
+    // names in the subtree, including this node
+    size_t nNames;
+    // by the first character of their label
+    std::map<char, std::unique_ptr<Node>> children;
+  };
+
+  /**
+   * @return the node whose path the prefix ends in, or nullptr if no name has that prefix
+   *
+   * @param nLabelChars: set to how many characters of the node's label belong to the prefix
+   */
+  const Node*
+  findNode(const std::string& prefix, size_t& nLabelChars) const;
+
+  // called with the number of names in a subtree, returns whether to visit it
+  typedef std::function<bool(size_t nNames)> SubtreeFilter;
+  // called with each completion and the number of names under it
+  typedef std::function<void(const std::string& completion, size_t nNames)> CompletionVisitor;
+
+  /**
+   * Helper function that visits the completions in a subtree in lexicographic order
+   *
+   * @param node:       root of the subtree
+   * @param labelBegin: characters of the node's label that are part of the prefix
+   * @param prefixSize: length of the prefix
+   * @param path:       prefix and the labels on the way to the node, up to labelBegin
+   */
+  static void
+  collect(const Node& node, size_t labelBegin, size_t prefixSize, std::string& path,
+          const SubtreeFilter& filter, const CompletionVisitor& visit);
+
+  /**
+   * Helper function that merges a node that is not a name into its only child
+   */
+  static void
+  merge(Node& node);
+
+private:
+  mutable std::mutex m_mutex;
+  // @{ needs m_mutex protection
+  Node m_root;
+  // @}
+};
+
+} // namespace util
+} // namespace atmos
+
+#endif // ATMOS_UTIL_NAME_TRIE_HPP
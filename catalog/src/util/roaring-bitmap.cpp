@@ -0,0 +1,355 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/roaring-bitmap.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace atmos {
+namespace util {
+
+// Above this many members, a bitset takes less memory than an array
+static const uint32_t MAX_ARRAY_SIZE = 4096;
+static const size_t BITSET_WORDS = 65536 / 64;
+
+static inline int
+popcount(uint64_t word)
+{
+  return __builtin_popcountll(word);
+}
+
+bool
+RoaringBitmap::Container::contains(uint16_t low) const
+{
+  if (isBitset) {
+    return (bits[low >> 6] >> (low & 63)) & 1;
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+void
+RoaringBitmap::Container::add(uint16_t low)
+{
+  if (isBitset) {
+    uint64_t& word = bits[low >> 6];
+    const uint64_t mask = uint64_t(1) << (low & 63);
+    if (!(word & mask)) {
+      word |= mask;
+      ++cardinality;
+    }
+    return;
+  }
+
+  auto position = std::lower_bound(array.begin(), array.end(), low);
+  if (position != array.end() && *position == low) {
+    return;
+  }
+  array.insert(position, low);
+  ++cardinality;
+  if (cardinality > MAX_ARRAY_SIZE) {
+    toBitset();
+  }
+}
+
+void
+RoaringBitmap::Container::remove(uint16_t low)
+{
+  if (isBitset) {
+    uint64_t& word = bits[low >> 6];
+    const uint64_t mask = uint64_t(1) << (low & 63);
+    if (word & mask) {
+      word &= ~mask;
+      --cardinality;
+      if (cardinality <= MAX_ARRAY_SIZE) {
+        toArray();
+      }
+    }
+    return;
+  }
+
+  auto position = std::lower_bound(array.begin(), array.end(), low);
+  if (position != array.end() && *position == low) {
+    array.erase(position);
+    --cardinality;
+  }
+}
+
+void
+RoaringBitmap::Container::intersect(const Container& other)
+{
+  if (isBitset && other.isBitset) {
+    cardinality = 0;
+    for (size_t i = 0; i < BITSET_WORDS; ++i) {
+      bits[i] &= other.bits[i];
+      cardinality += popcount(bits[i]);
+    }
+    if (cardinality <= MAX_ARRAY_SIZE) {
+      toArray();
+    }
+    return;
+  }
+
+  if (isBitset) {
+    // the result is at most as large as the other array
+    std::vector<uint16_t> result;
+    result.reserve(other.array.size());
+    for (uint16_t low : other.array) {
+      if (contains(low)) {
+        result.push_back(low);
+      }
+    }
+    isBitset = false;
+    bits.clear();
+    bits.shrink_to_fit();
+    array.swap(result);
+  }
+  else if (other.isBitset) {
+    array.erase(std::remove_if(array.begin(), array.end(),
+                               [&other] (uint16_t low) { return !other.contains(low); }),
+                array.end());
+  }
+  else {
+    std::vector<uint16_t> result;
+    result.reserve(std::min(array.size(), other.array.size()));
+    std::set_intersection(array.begin(), array.end(), other.array.begin(), other.array.end(),
+                          std::back_inserter(result));
+    array.swap(result);
+  }
+  cardinality = array.size();
+}
+
+uint32_t
+RoaringBitmap::Container::intersectionCardinality(const Container& other) const
+{
+  if (isBitset && other.isBitset) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < BITSET_WORDS; ++i) {
+      count += popcount(bits[i] & other.bits[i]);
+    }
+    return count;
+  }
+
+  if (isBitset || other.isBitset) {
+    const Container& arrayContainer = isBitset ? other : *this;
+    const Container& bitsetContainer = isBitset ? *this : other;
+    uint32_t count = 0;
+    for (uint16_t low : arrayContainer.array) {
+      count += bitsetContainer.contains(low);
+    }
+    return count;
+  }
+
+  uint32_t count = 0;
+  auto mine = array.begin();
+  auto theirs = other.array.begin();
+  while (mine != array.end() && theirs != other.array.end()) {
+    if (*mine < *theirs) {
+      ++mine;
+    }
+    else if (*theirs < *mine) {
+      ++theirs;
+    }
+    else {
+      ++count;
+      ++mine;
+      ++theirs;
+    }
+  }
+  return count;
+}
+
+void
+RoaringBitmap::Container::toBitset()
+{
+  bits.assign(BITSET_WORDS, 0);
+  for (uint16_t low : array) {
+    bits[low >> 6] |= uint64_t(1) << (low & 63);
+  }
+  array.clear();
+  array.shrink_to_fit();
+  isBitset = true;
+}
+
+void
+RoaringBitmap::Container::toArray()
+{
+  array.clear();
+  array.reserve(cardinality);
+  for (size_t i = 0; i < BITSET_WORDS; ++i) {
+    uint64_t word = bits[i];
+    while (word != 0) {
+      const int bit = __builtin_ctzll(word);
+      array.push_back(static_cast<uint16_t>(i * 64 + bit));
+      word &= word - 1;
+    }
+  }
+  bits.clear();
+  bits.shrink_to_fit();
+  isBitset = false;
+}
+
+RoaringBitmap::ContainerList::iterator
+RoaringBitmap::findContainer(uint16_t high)
+{
+  return std::lower_bound(m_containers.begin(), m_containers.end(), high,
+                          [] (const std::pair<uint16_t, Container>& container, uint16_t key) {
+                            return container.first < key;
+                          });
+}
+
+RoaringBitmap::ContainerList::const_iterator
+RoaringBitmap::findContainer(uint16_t high) const
+{
+  return std::lower_bound(m_containers.begin(), m_containers.end(), high,
+                          [] (const std::pair<uint16_t, Container>& container, uint16_t key) {
+                            return container.first < key;
+                          });
+}
+
+void
+RoaringBitmap::add(uint32_t value)
+{
+  const uint16_t high = value >> 16;
+  auto container = findContainer(high);
+  if (container == m_containers.end() || container->first != high) {
+    container = m_containers.insert(container, std::make_pair(high, Container()));
+  }
+  container->second.add(static_cast<uint16_t>(value));
+}
+
+void
+RoaringBitmap::remove(uint32_t value)
+{
+  const uint16_t high = value >> 16;
+  auto container = findContainer(high);
+  if (container == m_containers.end() || container->first != high) {
+    return;
+  }
+  container->second.remove(static_cast<uint16_t>(value));
+  if (container->second.cardinality == 0) {
+    m_containers.erase(container);
+  }
+}
+
+bool
+RoaringBitmap::contains(uint32_t value) const
+{
+  const uint16_t high = value >> 16;
+  auto container = findContainer(high);
+  return container != m_containers.end() && container->first == high &&
+         container->second.contains(static_cast<uint16_t>(value));
+}
+
+uint64_t
+RoaringBitmap::cardinality() const
+{
+  uint64_t count = 0;
+  for (const auto& container : m_containers) {
+    count += container.second.cardinality;
+  }
+  return count;
+}
+
+RoaringBitmap&
+RoaringBitmap::operator&=(const RoaringBitmap& other)
+{
+  // only chunks present in both bitmaps can have members left
+  ContainerList result;
+  auto mine = m_containers.begin();
+  auto theirs = other.m_containers.begin();
+  while (mine != m_containers.end() && theirs != other.m_containers.end()) {
+    if (mine->first < theirs->first) {
+      ++mine;
+    }
+    else if (theirs->first < mine->first) {
+      ++theirs;
+    }
+    else {
+      mine->second.intersect(theirs->second);
+      if (mine->second.cardinality > 0) {
+        result.push_back(std::move(*mine));
+      }
+      ++mine;
+      ++theirs;
+    }
+  }
+  m_containers.swap(result);
+  return *this;
+}
+
+uint64_t
+RoaringBitmap::intersectionCardinality(const RoaringBitmap& other) const
+{
+  uint64_t count = 0;
+  auto mine = m_containers.begin();
+  auto theirs = other.m_containers.begin();
+  while (mine != m_containers.end() && theirs != other.m_containers.end()) {
+    if (mine->first < theirs->first) {
+      ++mine;
+    }
+    else if (theirs->first < mine->first) {
+      ++theirs;
+    }
+    else {
+      count += mine->second.intersectionCardinality(theirs->second);
+      ++mine;
+      ++theirs;
+    }
+  }
+  return count;
+}
+
+std::vector<uint32_t>
+RoaringBitmap::toVector() const
+{
+  std::vector<uint32_t> values;
+  values.reserve(cardinality());
+  for (const auto& container : m_containers) {
+    const uint32_t high = static_cast<uint32_t>(container.first) << 16;
+    if (container.second.isBitset) {
+      for (size_t i = 0; i < BITSET_WORDS; ++i) {
+        uint64_t word = container.second.bits[i];
+        while (word != 0) {
+          values.push_back(high | static_cast<uint32_t>(i * 64 + __builtin_ctzll(word)));
+          word &= word - 1;
+        }
+      }
+    }
+    else {
+      for (uint16_t low : container.second.array) {
+        values.push_back(high | low);
+      }
+    }
+  }
+  return values;
+}
+
+size_t
+RoaringBitmap::getMemoryUsage() const
+{
+  size_t size = sizeof(*this) + m_containers.capacity() * sizeof(ContainerList::value_type);
+  for (const auto& container : m_containers) {
+    size += container.second.array.capacity() * sizeof(uint16_t) +
+            container.second.bits.capacity() * sizeof(uint64_t);
+  }
+  return size;
+}
+
+} // namespace util
+} // namespace atmos
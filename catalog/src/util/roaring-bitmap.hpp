@@ -0,0 +1,141 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_UTIL_ROARING_BITMAP_HPP
+#define ATMOS_UTIL_ROARING_BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace atmos {
+namespace util {
+
+/**
+ * RoaringBitmap is a compressed set of 32-bit integers.
+ *
+ * The integers are split by their high 16 bits into chunks of 65536. A chunk with few members
+ * keeps them in a sorted array, and a dense one in a plain bitset of 8 KiB, so that neither
+ * sparse nor dense sets waste memory, and intersections work on whole words where they can.
+ */
+class RoaringBitmap {
+public:
+  void
+  add(uint32_t value);
+
+  void
+  remove(uint32_t value);
+
+  bool
+  contains(uint32_t value) const;
+
+  /**
+   * @return number of members
+   */
+  uint64_t
+  cardinality() const;
+
+  bool
+  empty() const
+  {
+    return m_containers.empty();
+  }
+
+  /**
+   * Helper function that keeps only the members that are also in the other bitmap
+   */
+  RoaringBitmap&
+  operator&=(const RoaringBitmap& other);
+
+  /**
+   * @return number of members that are also in the other bitmap, without building the
+   *         intersection
+   */
+  uint64_t
+  intersectionCardinality(const RoaringBitmap& other) const;
+
+  /**
+   * @return members in increasing order
+   */
+  std::vector<uint32_t>
+  toVector() const;
+
+  /**
+   * @return estimated memory used by the bitmap in bytes
+   */
+  size_t
+  getMemoryUsage() const;
+
+private:
+  struct Container {
+    Container()
+      : isBitset(false)
+      , cardinality(0)
+    {
+    }
+
+    bool
+    contains(uint16_t low) const;
+
+    void
+    add(uint16_t low);
+
+    void
+    remove(uint16_t low);
+
+    /**
+     * Helper function that keeps only the members that are also in the other container
+     */
+    void
+    intersect(const Container& other);
+
+    uint32_t
+    intersectionCardinality(const Container& other) const;
+
+    void
+    toBitset();
+
+    void
+    toArray();
+
+    bool isBitset;
+    uint32_t cardinality;
+    // sorted members, if not a bitset
+    std::vector<uint16_t> array;
+    // one bit per member, if a bitset
+    std::vector<uint64_t> bits;
+  };
+
+  typedef std::vector<std::pair<uint16_t, Container>> ContainerList;
+
+  ContainerList::iterator
+  findContainer(uint16_t high);
+
+  ContainerList::const_iterator
+  findContainer(uint16_t high) const;
+
+private:
+  // by the high 16 bits of their members, in increasing order
+  ContainerList m_containers;
+};
+
+} // namespace util
+} // namespace atmos
+
+#endif // ATMOS_UTIL_ROARING_BITMAP_HPP
@@ -0,0 +1,274 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/segment-cache.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace atmos {
+namespace util {
+
+// Share of the budget that holds new segments before they have to win admission
+static const size_t WINDOW_PERCENT = 10;
+// Share of the rest that holds segments that left the window before they were asked for
+static const size_t PINNED_PERCENT = 50;
+// Segments are assumed to be this large when sizing the frequency sketch
+static const size_t TYPICAL_SEGMENT_SIZE = 8192;
+// Fixed cost of an entry on top of the encoded Data
+static const size_t ENTRY_OVERHEAD = 256;
+
+FrequencySketch::FrequencySketch(size_t nKeys)
+  : m_width(64)
+  , m_nSamples(0)
+  , m_sampleSize(10 * std::max<size_t>(nKeys, 1))
+{
+  // plenty of counters per key, so that a scan of many keys does not inflate the estimates
+  while (m_width < 8 * nKeys) {
+    m_width <<= 1;
+  }
+  m_counters.resize(N_ROWS * m_width);
+}
+
+size_t
+FrequencySketch::index(size_t hash, size_t row) const
+{
+  // derive one independent-looking hash per row from the key hash
+  uint64_t h = (static_cast<uint64_t>(hash) + row) * 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 32;
+  return row * m_width + (h & (m_width - 1));
+}
+
+void
+FrequencySketch::increment(size_t hash)
+{
+  bool isIncremented = false;
+  for (size_t row = 0; row < N_ROWS; ++row) {
+    uint8_t& counter = m_counters[index(hash, row)];
+    if (counter < MAX_COUNT) {
+      ++counter;
+      isIncremented = true;
+    }
+  }
+
+  if (isIncremented && ++m_nSamples >= m_sampleSize) {
+    // age the history
+    for (auto& counter : m_counters) {
+      counter >>= 1;
+    }
+    m_nSamples /= 2;
+  }
+}
+
+uint8_t
+FrequencySketch::estimate(size_t hash) const
+{
+  uint8_t count = MAX_COUNT;
+  for (size_t row = 0; row < N_ROWS; ++row) {
+    count = std::min(count, m_counters[index(hash, row)]);
+  }
+  return count;
+}
+
+SegmentCache::SegmentCache(size_t maxSize)
+  : m_maxSize(maxSize)
+  , m_maxWindowSize(maxSize * WINDOW_PERCENT / 100)
+  , m_maxPinnedSize((maxSize - m_maxWindowSize) * PINNED_PERCENT / 100)
+  , m_windowSize(0)
+  , m_pinnedSize(0)
+  , m_mainSize(0)
+  , m_sketch(maxSize / TYPICAL_SEGMENT_SIZE)
+  , m_nHits(0)
+  , m_nMisses(0)
+  , m_nEvictions(0)
+  , m_nRejections(0)
+{
+}
+
+size_t
+SegmentCache::hash(const ndn::Name& name)
+{
+  return std::hash<ndn::Name>()(name);
+}
+
+void
+SegmentCache::insert(const ndn::Data& data)
+{
+  const size_t size = data.wireEncode().size() + ENTRY_OVERHEAD;
+  auto iter = m_entries.find(data.getName());
+  if (iter != m_entries.end()) {
+    remove(iter);
+  }
+  if (size > m_maxSize) {
+    ++m_nRejections;
+    return;
+  }
+
+  Entry entry;
+  entry.data = std::make_shared<ndn::Data>(data);
+  entry.size = size;
+  entry.area = AREA_WINDOW;
+  entry.isRequested = false;
+  iter = m_entries.insert(std::make_pair(data.getName(), entry)).first;
+  m_window.push_front(iter);
+  iter->second.position = m_window.begin();
+  m_windowSize += size;
+
+  drainWindow();
+}
+
+void
+SegmentCache::drainWindow()
+{
+  const size_t maxMainSize = m_maxSize - m_maxWindowSize;
+  while (m_windowSize > m_maxWindowSize && !m_window.empty()) {
+    EntryMap::iterator candidate = m_window.back();
+    m_window.pop_back();
+    m_windowSize -= candidate->second.size;
+
+    const size_t size = candidate->second.size;
+    if (!candidate->second.isRequested && size <= m_maxPinnedSize) {
+      while (m_pinnedSize + size > m_maxPinnedSize) {
+        remove(m_pinned.back());
+        ++m_nEvictions;
+      }
+      // the pinned area is at most half, so the main one alone has to make enough room
+      while (m_pinnedSize + m_mainSize + size > maxMainSize) {
+        remove(m_main.back());
+        ++m_nEvictions;
+      }
+      candidate->second.area = AREA_PINNED;
+      m_pinned.push_front(candidate);
+      candidate->second.position = m_pinned.begin();
+      m_pinnedSize += size;
+      continue;
+    }
+
+    const uint8_t candidateFrequency = m_sketch.estimate(hash(candidate->first));
+    bool isAdmitted = size <= maxMainSize;
+    while (isAdmitted && m_pinnedSize + m_mainSize + size > maxMainSize) {
+      if (m_main.empty()) {
+        isAdmitted = false;
+        break;
+      }
+      EntryMap::iterator victim = m_main.back();
+      // segments nobody asked for are not worth keeping over anything
+      const uint8_t victimFrequency = m_sketch.estimate(hash(victim->first));
+      if (candidateFrequency > victimFrequency || victimFrequency == 0) {
+        remove(victim);
+        ++m_nEvictions;
+      }
+      else {
+        isAdmitted = false;
+      }
+    }
+
+    if (!isAdmitted) {
+      m_entries.erase(candidate);
+      ++m_nRejections;
+      continue;
+    }
+    candidate->second.area = AREA_MAIN;
+    m_main.push_front(candidate);
+    candidate->second.position = m_main.begin();
+    m_mainSize += size;
+  }
+}
+
+std::shared_ptr<const ndn::Data>
+SegmentCache::find(const ndn::Name& prefix)
+{
+  m_sketch.increment(hash(prefix));
+
+  auto iter = m_entries.lower_bound(prefix);
+  if (iter == m_entries.end() || !prefix.isPrefixOf(iter->first)) {
+    ++m_nMisses;
+    return nullptr;
+  }
+  ++m_nHits;
+  iter->second.isRequested = true;
+  touch(iter);
+  return iter->second.data;
+}
+
+std::shared_ptr<const ndn::Data>
+SegmentCache::find(const ndn::Interest& interest)
+{
+  return find(interest.getName());
+}
+
+void
+SegmentCache::erase(const ndn::Name& name)
+{
+  auto iter = m_entries.find(name);
+  if (iter != m_entries.end()) {
+    remove(iter);
+  }
+}
+
+SegmentCache::LruList&
+SegmentCache::getList(Area area)
+{
+  switch (area) {
+  case AREA_WINDOW:
+    return m_window;
+  case AREA_PINNED:
+    return m_pinned;
+  default:
+    return m_main;
+  }
+}
+
+size_t&
+SegmentCache::getAreaSize(Area area)
+{
+  switch (area) {
+  case AREA_WINDOW:
+    return m_windowSize;
+  case AREA_PINNED:
+    return m_pinnedSize;
+  default:
+    return m_mainSize;
+  }
+}
+
+void
+SegmentCache::touch(EntryMap::iterator entry)
+{
+  if (entry->second.area == AREA_PINNED) {
+    // the pinned and the main areas share their budget, so this needs no room
+    m_main.splice(m_main.begin(), m_pinned, entry->second.position);
+    m_pinnedSize -= entry->second.size;
+    m_mainSize += entry->second.size;
+    entry->second.area = AREA_MAIN;
+    return;
+  }
+  LruList& list = getList(entry->second.area);
+  list.splice(list.begin(), list, entry->second.position);
+}
+
+void
+SegmentCache::remove(EntryMap::iterator entry)
+{
+  getList(entry->second.area).erase(entry->second.position);
+  getAreaSize(entry->second.area) -= entry->second.size;
+  m_entries.erase(entry);
+}
+
+} // namespace util
+} // namespace atmos
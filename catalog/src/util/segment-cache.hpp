@@ -0,0 +1,242 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_UTIL_SEGMENT_CACHE_HPP
+#define ATMOS_UTIL_SEGMENT_CACHE_HPP
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/interest.hpp>
+#include <ndn-cxx/name.hpp>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace atmos {
+namespace util {
+
+/**
+ * FrequencySketch estimates how often a key has been seen recently, in constant memory.
+ *
+ * It is a count-min sketch of 4-bit counters. All counters are halved once enough keys have
+ * been recorded, so that keys that used to be popular fade away.
+ */
+class FrequencySketch {
+public:
+  /**
+   * Constructor
+   *
+   * @param nKeys: number of keys the sketch should tell apart, usually the capacity of the
+   *               cache. The history is aged every 10 * nKeys recorded keys.
+   */
+  explicit
+  FrequencySketch(size_t nKeys);
+
+  void
+  increment(size_t hash);
+
+  uint8_t
+  estimate(size_t hash) const;
+
+private:
+  size_t
+  index(size_t hash, size_t row) const;
+
+private:
+  static const size_t N_ROWS = 4;
+  static const uint8_t MAX_COUNT = 15;
+
+  std::vector<uint8_t> m_counters;
+  size_t m_width;
+  size_t m_nSamples;
+  size_t m_sampleSize;
+};
+
+/**
+ * SegmentCache keeps signed Data segments within a budget in bytes.
+ *
+ * New segments enter a small LRU window. Segments that fall out of the window are only
+ * admitted to the main LRU area if they have been asked for more often than the segment they
+ * would replace (W-TinyLFU), so a single bulk query cannot flush the popular results.
+ *
+ * Segments that leave the window before they are first asked for belong to results that
+ * consumers have been sent an ACK for but have not fetched yet, and nobody has asked for them
+ * yet so they would lose to anything. They are pinned instead, in an area of up to half of
+ * the main one, and move to the main area once asked for. The oldest pinned segments make
+ * room for new ones, so abandoned results do not stay.
+ *
+ * SegmentCache is not thread-safe.
+ */
+class SegmentCache : boost::noncopyable {
+public:
+  /**
+   * Constructor
+   *
+   * @param maxSize: budget of the cache in bytes of encoded Data
+   */
+  explicit
+  SegmentCache(size_t maxSize);
+
+  /**
+   * Helper function that inserts a Data, or replaces the one with the same name
+   */
+  void
+  insert(const ndn::Data& data);
+
+  /**
+   * @return the first Data under the prefix, or nullptr if there is none
+   */
+  std::shared_ptr<const ndn::Data>
+  find(const ndn::Name& prefix);
+
+  /**
+   * @return the first Data under the name of the Interest, or nullptr if there is none.
+   *         Selectors are not considered.
+   */
+  std::shared_ptr<const ndn::Data>
+  find(const ndn::Interest& interest);
+
+  void
+  erase(const ndn::Name& name);
+
+  size_t
+  size() const
+  {
+    return m_entries.size();
+  }
+
+  size_t
+  getMaxSize() const
+  {
+    return m_maxSize;
+  }
+
+  size_t
+  getUsedSize() const
+  {
+    return m_windowSize + m_pinnedSize + m_mainSize;
+  }
+
+  uint64_t
+  getNHits() const
+  {
+    return m_nHits;
+  }
+
+  uint64_t
+  getNMisses() const
+  {
+    return m_nMisses;
+  }
+
+  /**
+   * @return number of segments removed to make room for others
+   */
+  uint64_t
+  getNEvictions() const
+  {
+    return m_nEvictions;
+  }
+
+  /**
+   * @return number of segments that left the window without being admitted
+   */
+  uint64_t
+  getNRejections() const
+  {
+    return m_nRejections;
+  }
+
+private:
+  struct Entry;
+  typedef std::map<ndn::Name, Entry> EntryMap;
+  typedef std::list<EntryMap::iterator> LruList;
+
+  enum Area {
+    AREA_WINDOW,
+    AREA_PINNED,
+    AREA_MAIN
+  };
+
+  struct Entry {
+    std::shared_ptr<const ndn::Data> data;
+    size_t size;
+    Area area;
+    // whether it has been found since it was inserted
+    bool isRequested;
+    LruList::iterator position;
+  };
+
+  LruList&
+  getList(Area area);
+
+  size_t&
+  getAreaSize(Area area);
+
+  /**
+   * Helper function that marks a segment as recently used, which moves a pinned one to the
+   * main area
+   */
+  void
+  touch(EntryMap::iterator entry);
+
+  void
+  remove(EntryMap::iterator entry);
+
+  /**
+   * Helper function that moves the oldest segments out of the window, into the pinned area if
+   * they have not been asked for yet, and else into the main area if they win against its
+   * oldest segments
+   */
+  void
+  drainWindow();
+
+  static size_t
+  hash(const ndn::Name& name);
+
+private:
+  const size_t m_maxSize;
+  const size_t m_maxWindowSize;
+  // the pinned and the main areas share the rest of the budget
+  const size_t m_maxPinnedSize;
+
+  EntryMap m_entries;
+  // most recently used first
+  LruList m_window;
+  // most recently inserted first
+  LruList m_pinned;
+  LruList m_main;
+  size_t m_windowSize;
+  size_t m_pinnedSize;
+  size_t m_mainSize;
+  FrequencySketch m_sketch;
+
+  uint64_t m_nHits;
+  uint64_t m_nMisses;
+  uint64_t m_nEvictions;
+  uint64_t m_nRejections;
+};
+
+} // namespace util
+} // namespace atmos
+
+#endif // ATMOS_UTIL_SEGMENT_CACHE_HPP
@@ -0,0 +1,119 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/thread-pool.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace atmos {
+namespace util {
+
+ThreadPool::ThreadPool(size_t nThreads, size_t maxQueueSize)
+  : m_maxQueueSize(maxQueueSize)
+  , m_isStopped(false)
+{
+  if (nThreads == 0) {
+    throw std::invalid_argument("ThreadPool needs at least one worker thread");
+  }
+  m_workers.reserve(nThreads);
+  for (size_t i = 0; i < nThreads; ++i) {
+    m_workers.push_back(std::thread(&ThreadPool::run, this));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  stop();
+}
+
+bool
+ThreadPool::submit(const Task& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isStopped || m_tasks.size() >= m_maxQueueSize) {
+      return false;
+    }
+    m_tasks.push_back(task);
+  }
+  m_hasTask.notify_one();
+  return true;
+}
+
+void
+ThreadPool::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isStopped) {
+      return;
+    }
+    m_isStopped = true;
+    m_tasks.clear();
+  }
+  m_hasTask.notify_all();
+
+  for (auto& worker : m_workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+size_t
+ThreadPool::getQueueSize()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tasks.size();
+}
+
+void
+ThreadPool::run()
+{
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_hasTask.wait(lock, [this] { return m_isStopped || !m_tasks.empty(); });
+      if (m_isStopped) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    try {
+      task();
+    }
+    // a failing task must not take the worker down with it
+    catch (const std::exception& e) {
+#ifndef NDEBUG
+      std::cout << "ThreadPool task failed: " << e.what() << std::endl;
+#endif
+    }
+    catch (...) {
+#ifndef NDEBUG
+      std::cout << "ThreadPool task failed" << std::endl;
+#endif
+    }
+  }
+}
+
+} // namespace util
+} // namespace atmos
@@ -0,0 +1,105 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef ATMOS_UTIL_THREAD_POOL_HPP
+#define ATMOS_UTIL_THREAD_POOL_HPP
+
+#include <boost/noncopyable.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace atmos {
+namespace util {
+
+/**
+ * ThreadPool runs submitted tasks on a fixed set of worker threads.
+ *
+ * The number of tasks waiting for a worker is bounded, so that a burst of requests is rejected
+ * instead of growing the backlog without limit.
+ */
+class ThreadPool : boost::noncopyable {
+public:
+  typedef std::function<void()> Task;
+
+  /**
+   * Constructor
+   *
+   * @param nThreads:     number of worker threads, must be positive
+   * @param maxQueueSize: maximum number of tasks waiting for a worker
+   */
+  ThreadPool(size_t nThreads, size_t maxQueueSize);
+
+  /**
+   * Destructor, which waits for the running tasks and discards the queued ones
+   */
+  ~ThreadPool();
+
+  /**
+   * Helper function that queues a task to be run on one of the workers
+   *
+   * @return false if the queue is full or the pool is stopped, in which case the task is dropped
+   */
+  bool
+  submit(const Task& task);
+
+  /**
+   * Helper function that stops the workers after their current tasks and discards queued tasks
+   */
+  void
+  stop();
+
+  size_t
+  getNThreads() const
+  {
+    return m_workers.size();
+  }
+
+  size_t
+  getMaxQueueSize() const
+  {
+    return m_maxQueueSize;
+  }
+
+  size_t
+  getQueueSize();
+
+private:
+  void
+  run();
+
+private:
+  const size_t m_maxQueueSize;
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_mutex;
+  std::condition_variable m_hasTask;
+  // @{ needs m_mutex protection
+  std::deque<Task> m_tasks;
+  bool m_isStopped;
+  // @}
+};
+
+} // namespace util
+} // namespace atmos
+
+#endif // ATMOS_UTIL_THREAD_POOL_HPP
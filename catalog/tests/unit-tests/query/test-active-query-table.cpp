@@ -0,0 +1,220 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/active-query-table.hpp"
+#include "boost-test.hpp"
+#include "../../unit-test-time-fixture.hpp"
+
+#include <ndn-cxx/security/key-chain.hpp>
+
+namespace atmos{
+namespace tests{
+
+  class ActiveQueryTableFixture : public UnitTestTimeFixture
+  {
+  protected:
+    query::QueryKey
+    makeKey(int i)
+    {
+      Json::Value query;
+      query["ensemble"] = i;
+      return query::QueryKey(query);
+    }
+
+    std::shared_ptr<ndn::Data>
+    makeAck(int i)
+    {
+      std::shared_ptr<ndn::Data> ack
+        = std::make_shared<ndn::Data>(ndn::Name("/test/query").appendNumber(i).append("OK"));
+      keyChain.signWithSha256(*ack);
+      return ack;
+    }
+
+  protected:
+    ndn::KeyChain keyChain;
+  };
+
+  BOOST_FIXTURE_TEST_SUITE(ActiveQueryTableTestSuite, ActiveQueryTableFixture)
+
+  BOOST_AUTO_TEST_CASE(ActiveQueryTableInsertFind)
+  {
+    query::ActiveQueryTable table(4, 1024 * 1024, ndn::time::seconds(10),
+                                  ndn::time::seconds(60));
+    BOOST_CHECK(!table.find(makeKey(1)));
+
+    std::shared_ptr<ndn::Data> ack1 = makeAck(1);
+    BOOST_CHECK(!table.insert(makeKey(1), ack1));
+    BOOST_CHECK(table.find(makeKey(1)) == ack1);
+
+    // the first ACK wins
+    BOOST_CHECK(table.insert(makeKey(1), makeAck(2)) == ack1);
+    BOOST_CHECK_EQUAL(table.size(), 1);
+    BOOST_CHECK_GT(table.getMemoryUsage(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(ActiveQueryTableExpiry)
+  {
+    query::ActiveQueryTable table(4, 1024 * 1024, ndn::time::seconds(10),
+                                  ndn::time::seconds(60));
+    std::shared_ptr<ndn::Data> ack1 = makeAck(1);
+    table.insert(makeKey(1), ack1);
+    table.markReady(makeKey(1), ack1);
+    advanceClocks(ndn::time::seconds(5));
+    std::shared_ptr<ndn::Data> ack2 = makeAck(2);
+    table.insert(makeKey(2), ack2);
+    table.markReady(makeKey(2), ack2);
+
+    advanceClocks(ndn::time::seconds(6));
+    BOOST_CHECK(!table.find(makeKey(1)));
+    BOOST_CHECK(table.find(makeKey(2)));
+
+    // an expired query can be made active again
+    BOOST_CHECK(!table.insert(makeKey(1), makeAck(1)));
+    BOOST_CHECK(table.find(makeKey(1)));
+  }
+
+  BOOST_AUTO_TEST_CASE(ActiveQueryTableLongExecution)
+  {
+    query::ActiveQueryTable table(4, 1024 * 1024, ndn::time::seconds(10),
+                                  ndn::time::seconds(60));
+    std::shared_ptr<ndn::Data> ack1 = makeAck(1);
+    table.insert(makeKey(1), ack1);
+    table.insert(makeKey(2), makeAck(2));
+
+    // a query that runs for longer than the lifetime of its results is still pending
+    advanceClocks(ndn::time::seconds(30));
+    BOOST_CHECK(table.find(makeKey(1)) == ack1);
+    bool isWaiting = false;
+    BOOST_CHECK(!table.join(makeKey(1), std::make_shared<ndn::Interest>("/test/query"),
+                            isWaiting));
+    BOOST_CHECK(isWaiting);
+
+    // and its results are served for the whole lifetime once they are ready
+    BOOST_CHECK_EQUAL(table.markReady(makeKey(1), ack1).size(), 1);
+    advanceClocks(ndn::time::seconds(9));
+    BOOST_CHECK(table.find(makeKey(1)) == ack1);
+    advanceClocks(ndn::time::seconds(2));
+    BOOST_CHECK(!table.find(makeKey(1)));
+
+    // a query that never finishes is given up on
+    advanceClocks(ndn::time::seconds(20));
+    BOOST_CHECK(!table.find(makeKey(2)));
+    BOOST_CHECK_EQUAL(table.size(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(ActiveQueryTableSingleFlight)
+  {
+    query::ActiveQueryTable table(4, 1024 * 1024, ndn::time::seconds(10),
+                                  ndn::time::seconds(60));
+    std::shared_ptr<ndn::Data> ack1 = makeAck(1);
+    BOOST_CHECK(!table.insert(makeKey(1), ack1));
+    const size_t usedSize = table.getMemoryUsage();
+
+    // Interests for the pending query wait for it
+    bool isWaiting = false;
+    for (int i = 0; i < 3; ++i) {
+      auto interest = std::make_shared<ndn::Interest>(ndn::Name("/test/query").appendNumber(i));
+      BOOST_CHECK(!table.join(makeKey(1), interest, isWaiting));
+      BOOST_CHECK(isWaiting);
+    }
+    BOOST_CHECK_GT(table.getMemoryUsage(), usedSize);
+    BOOST_CHECK(!table.join(makeKey(2), std::make_shared<ndn::Interest>("/test/query"),
+                            isWaiting));
+    BOOST_CHECK(!isWaiting);
+
+    // another execution's ACK does not make the query ready
+    BOOST_CHECK(table.markReady(makeKey(1), makeAck(1)).empty());
+    BOOST_CHECK_EQUAL(table.markReady(makeKey(1), ack1).size(), 3);
+    BOOST_CHECK_EQUAL(table.getMemoryUsage(), usedSize);
+
+    // later Interests get the ACK right away
+    BOOST_CHECK(table.join(makeKey(1), std::make_shared<ndn::Interest>("/test/query"),
+                           isWaiting) == ack1);
+    BOOST_CHECK(!isWaiting);
+    BOOST_CHECK(table.markReady(makeKey(1), ack1).empty());
+  }
+
+  BOOST_AUTO_TEST_CASE(ActiveQueryTableEraseFailed)
+  {
+    query::ActiveQueryTable table(4, 1024 * 1024, ndn::time::seconds(10),
+                                  ndn::time::seconds(60));
+    std::shared_ptr<ndn::Data> ack1 = makeAck(1);
+    table.insert(makeKey(1), ack1);
+    bool isWaiting = false;
+    table.join(makeKey(1), std::make_shared<ndn::Interest>("/test/query"), isWaiting);
+
+    BOOST_CHECK(table.erase(makeKey(1), makeAck(1)).empty());
+    BOOST_CHECK(table.find(makeKey(1)) == ack1);
+    BOOST_CHECK_EQUAL(table.erase(makeKey(1), ack1).size(), 1);
+    BOOST_CHECK(!table.find(makeKey(1)));
+    BOOST_CHECK_EQUAL(table.size(), 0);
+    BOOST_CHECK_EQUAL(table.getMemoryUsage(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(ActiveQueryTableWaitingInterestLifetime)
+  {
+    query::ActiveQueryTable table(4, 1024 * 1024, ndn::time::seconds(10),
+                                  ndn::time::seconds(60));
+    std::shared_ptr<ndn::Data> ack1 = makeAck(1);
+    table.insert(makeKey(1), ack1);
+    const size_t usedSize = table.getMemoryUsage();
+
+    bool isWaiting = false;
+    auto shortInterest = std::make_shared<ndn::Interest>(ndn::Name("/test/query").appendNumber(1));
+    shortInterest->setInterestLifetime(ndn::time::seconds(1));
+    table.join(makeKey(1), shortInterest, isWaiting);
+    auto longInterest = std::make_shared<ndn::Interest>(ndn::Name("/test/query").appendNumber(2));
+    longInterest->setInterestLifetime(ndn::time::seconds(8));
+    table.join(makeKey(1), longInterest, isWaiting);
+
+    // the consumer of an Interest whose lifetime has passed no longer waits for the answer
+    advanceClocks(ndn::time::seconds(2));
+    query::ActiveQueryTable::InterestList interests = table.erase(makeKey(1), ack1);
+    BOOST_REQUIRE_EQUAL(interests.size(), 1);
+    BOOST_CHECK(interests[0] == longInterest);
+
+    // and is dropped by the next Interest that waits
+    table.insert(makeKey(1), ack1);
+    table.join(makeKey(1), shortInterest, isWaiting);
+    const size_t shortUsedSize = table.getMemoryUsage();
+    advanceClocks(ndn::time::seconds(2));
+    table.join(makeKey(1), longInterest, isWaiting);
+    BOOST_CHECK_EQUAL(table.getMemoryUsage(), shortUsedSize - shortInterest->wireEncode().size() +
+                                              longInterest->wireEncode().size());
+    BOOST_REQUIRE_EQUAL(table.markReady(makeKey(1), ack1).size(), 1);
+    BOOST_CHECK_EQUAL(table.getMemoryUsage(), usedSize);
+  }
+
+  BOOST_AUTO_TEST_CASE(ActiveQueryTableMemoryCap)
+  {
+    const size_t maxSize = 8 * 1024;
+    query::ActiveQueryTable table(1, maxSize, ndn::time::seconds(10), ndn::time::seconds(60));
+    for (int i = 0; i < 1000; ++i) {
+      table.insert(makeKey(i), makeAck(i));
+      BOOST_CHECK_LE(table.getMemoryUsage(), maxSize);
+    }
+    BOOST_CHECK_LT(table.size(), 1000);
+    // the oldest queries go first
+    BOOST_CHECK(!table.find(makeKey(0)));
+    BOOST_CHECK(table.find(makeKey(999)));
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
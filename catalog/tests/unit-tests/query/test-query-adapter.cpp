@@ -24,8 +24,11 @@
 #include <boost/mpl/list.hpp>
 #include <boost/thread.hpp>
 #include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/encoding/block-helpers.hpp>
 #include <boost/property_tree/info_parser.hpp>
 
+#include <iomanip>
+
 namespace atmos{
 namespace tests{
   using ndn::util::DummyClientFace;
@@ -55,6 +58,11 @@ namespace tests{
       m_signingId = signingId;
     }
 
+    void setSignManifest(bool signManifest)
+    {
+      m_signManifest = signManifest;
+    }
+
     const ndn::Name
     getPrefix()
     {
@@ -75,11 +83,12 @@ namespace tests{
 
     void
     parseJsonTest(std::string& targetSql,
+                  std::vector<std::string>& sqlValues,
                   Json::Value& parsedFromString,
                   bool& autocomplete)
     {
       std::stringstream resultSql;
-      json2Sql(resultSql, parsedFromString, autocomplete);
+      json2Sql(resultSql, sqlValues, parsedFromString, autocomplete);
       targetSql.assign(resultSql.str());
     }
 
@@ -88,9 +97,37 @@ namespace tests{
                  const Json::Value& value,
                  uint64_t segmentNo,
                  bool isFinalBlock,
-                 bool isAutocomplete)
+                 bool isAutocomplete,
+                 bool isInManifest = false)
     {
-      return makeReplyData(segmentPrefix, value, segmentNo, isFinalBlock, isAutocomplete);
+      query::SegmentEncoder encoder(isAutocomplete);
+      for (const auto& name : value) {
+        encoder.append(name.asString());
+      }
+      return makeReplyData(segmentPrefix, encoder, segmentNo, isFinalBlock, isInManifest);
+    }
+
+    void
+    signInParallel(const ndn::Name& segmentPrefix, uint64_t nSegments, size_t nSigningThreads)
+    {
+      setThreadPool(1, 1, nSigningThreads);
+      SigningQueue queue;
+      query::SegmentEncoder encoder(false);
+      for (uint64_t segmentNo = 0; segmentNo < nSegments; ++segmentNo) {
+        encoder.append("/ndn/test1");
+        queueSegment(queue, makeUnsignedReplyData(segmentPrefix, encoder, segmentNo,
+                                                  segmentNo + 1 == nSegments));
+        BOOST_CHECK_LE(queue.size(), 4 * nSigningThreads);
+      }
+      drainSigningQueue(queue, 0);
+      BOOST_CHECK(queue.empty());
+    }
+
+    std::vector<std::shared_ptr<ndn::Data>>
+    getManifestData(const ndn::Name& segmentPrefix,
+                    const std::vector<ndn::name::Component>& digests)
+    {
+      return makeManifestData(segmentPrefix, digests);
     }
 
     void
@@ -99,46 +136,129 @@ namespace tests{
       runJsonQuery(interest);
     }
 
-    void
+    bool
     prepareSegments(const ndn::Name& segmentPrefix,
                     const std::string& sqlString,
-                    bool autocomplete)
+                    const std::vector<std::string>& sqlValues,
+                    bool autocomplete,
+                    const query::ResultFormat& format)
     {
-      BOOST_CHECK_EQUAL(sqlString, "SELECT name FROM cmip5 WHERE name=\'test\';");
-      Json::Value fileList;
-      fileList.append("/ndn/test1");
-      fileList.append("/ndn/test2");
-      fileList.append("/ndn/test3");
+      BOOST_CHECK_EQUAL(sqlString, "SELECT name FROM cmip5 WHERE `name`=?;");
+      BOOST_REQUIRE_EQUAL(sqlValues.size(), 1);
+      BOOST_CHECK_EQUAL(sqlValues[0], "test");
+      query::SegmentEncoder encoder(false);
+      encoder.append("/ndn/test1");
+      encoder.append("/ndn/test2");
+      encoder.append("/ndn/test3");
 
       std::shared_ptr<ndn::Data> data = makeReplyData(segmentPrefix,
-                                                      fileList,
+                                                      encoder,
                                                       0,
-                                                      true,
-                                                      false);
+                                                      true);
       m_mutex.lock();
-      m_cache.insert(*data);
+      m_cache->insert(*data);
       m_mutex.unlock();
+      return true;
+    }
+
+    void
+    resultsTest(const ndn::Interest& interest)
+    {
+      onQueryResultsInterest(ndn::InterestFilter(ndn::Name(m_prefix).append("query-results")),
+                             interest);
+    }
+
+    void
+    statusTest(const ndn::Interest& interest)
+    {
+      onStatusInterest(ndn::InterestFilter(ndn::Name(m_prefix).append("status")), interest);
+    }
+
+    void
+    stopThreadPool()
+    {
+      // segments are then generated on the calling thread
+      m_queryPool.reset();
+    }
+
+    bool
+    fetchNames(const std::string& sqlCondition,
+               const std::vector<std::string>& sqlValues,
+               const std::string& lastName,
+               size_t limit,
+               std::vector<std::string>& names)
+    {
+      lastSqlCondition = sqlCondition;
+      lastSqlValues = sqlValues;
+      ++nFetches;
+      if (isFetchFailing) {
+        return false;
+      }
+      for (const auto& name : catalogNames) {
+        if (name > lastName && names.size() < limit) {
+          names.push_back(name);
+        }
+      }
+      return true;
+    }
+
+    bool
+    countNames(const std::string& sqlCondition,
+               const std::vector<std::string>& sqlValues,
+               uint64_t& count)
+    {
+      ++nCounts;
+      count = catalogNames.size();
+      return true;
     }
 
     std::shared_ptr<const ndn::Data>
     getDataFromActiveQuery(const std::string& jsonQuery)
     {
-      m_mutex.lock();
-      if (m_activeQueryToFirstResponse.find(jsonQuery) != m_activeQueryToFirstResponse.end()) {
-        auto iter = m_activeQueryToFirstResponse.find(jsonQuery);
-        if (iter != m_activeQueryToFirstResponse.end()) {
-          m_mutex.unlock();
-          return iter->second;
-        }
+      Json::Value parsedFromString;
+      Json::Reader reader;
+      if (!reader.parse(jsonQuery, parsedFromString)) {
+        return std::shared_ptr<const ndn::Data>();
       }
-      m_mutex.unlock();
-      return std::shared_ptr<const ndn::Data>();
+      return m_activeQueries->find(query::QueryKey(parsedFromString));
     }
 
     std::shared_ptr<const ndn::Data>
     getDataFromCache(const ndn::Interest& interest)
     {
-      return m_cache.find(interest);
+      return m_cache->find(interest);
+    }
+
+    void
+    evictFromCache(const ndn::Name& name)
+    {
+      m_cache->erase(name);
+    }
+
+    void
+    loadNames(const std::vector<std::string>& names)
+    {
+      for (const auto& name : names) {
+        m_nameTrie->insert(name);
+      }
+      m_isNameTrieLoaded = true;
+    }
+
+    void
+    loadFacets(const std::vector<std::string>& names,
+               const std::vector<std::vector<std::string>>& values)
+    {
+      const uint64_t token = m_facetIndex->startLoading();
+      for (size_t i = 0; i < names.size(); ++i) {
+        m_facetIndex->insert(names[i], values[i]);
+      }
+      m_facetIndex->markLoaded(token);
+    }
+
+    size_t
+    getSegmentPayloadLimit()
+    {
+      return getPayloadLimit();
     }
 
     void
@@ -147,6 +267,15 @@ namespace tests{
     {
       onConfig(section, false, std::string("test.txt"), prefix);
     }
+
+  public:
+    // sorted names that fetchNames serves the on-demand queries from
+    std::vector<std::string> catalogNames;
+    size_t nFetches = 0;
+    size_t nCounts = 0;
+    bool isFetchFailing = false;
+    std::string lastSqlCondition;
+    std::vector<std::string> lastSqlValues;
   };
 
   class QueryAdapterFixture : public UnitTestTimeFixture
@@ -157,6 +286,7 @@ namespace tests{
       , keyChain(new ndn::KeyChain())
       , queryAdapterTest1(face, keyChain)
       , queryAdapterTest2(face, keyChain)
+      , queryAdapterTest3(face, keyChain)
     {
     }
 
@@ -209,11 +339,36 @@ namespace tests{
       queryAdapterTest2.configAdapter(section, ndn::Name("/test"));
     }
 
+    void
+    initializeQueryAdapterTest3(const std::string& extraConfig = "")
+    {
+      util::ConfigSection section;
+      try {
+        std::stringstream ss;
+        ss << "database\
+             {                                  \
+              dbServer localhost                \
+              dbName testdb                     \
+              dbUser testuser                   \
+              dbPasswd testpwd                  \
+             }                                  \
+             lazySegments yes                   \
+             readAhead 1 " << extraConfig;
+        boost::property_tree::read_info(ss, section);
+      }
+      catch (boost::property_tree::info_parser_error &e) {
+        std::cout << "Failed to read config file " << e.what() << std::endl;;
+      }
+      queryAdapterTest3.configAdapter(section, ndn::Name("/test"));
+      queryAdapterTest3.stopThreadPool();
+    }
+
   protected:
     std::shared_ptr<DummyClientFace> face;
     std::shared_ptr<ndn::KeyChain> keyChain;
     QueryAdapterTest queryAdapterTest1;
     QueryAdapterTest queryAdapterTest2;
+    QueryAdapterTest queryAdapterTest3;
   };
 
   BOOST_FIXTURE_TEST_SUITE(QueryAdapterTestSuite, QueryAdapterFixture)
@@ -239,10 +394,14 @@ namespace tests{
     testJson["product"] = "testProduct";
 
     std::string dstString;
+    std::vector<std::string> values;
     bool autocomplete = false;
-    queryAdapterTest1.parseJsonTest(dstString, testJson, autocomplete);
+    queryAdapterTest1.parseJsonTest(dstString, values, testJson, autocomplete);
     BOOST_CHECK_EQUAL(dstString, "SELECT name FROM cmip5 WHERE\
- activity=\'testActivity\' AND name='test\' AND product=\'testProduct\';");
+ `activity`=? AND `name`=? AND `product`=?;");
+    std::vector<std::string> expectedValues = {"testActivity", "test", "testProduct"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(values.begin(), values.end(),
+                                  expectedValues.begin(), expectedValues.end());
     BOOST_CHECK_EQUAL(autocomplete, false);
   }
 
@@ -251,9 +410,11 @@ namespace tests{
     Json::Value testJson;
 
     std::string dstString;
+    std::vector<std::string> values;
     bool autocomplete = false;
-    queryAdapterTest1.parseJsonTest(dstString, testJson, autocomplete);
+    queryAdapterTest1.parseJsonTest(dstString, values, testJson, autocomplete);
     BOOST_CHECK_EQUAL(dstString, "SELECT name FROM cmip5 limit 0;");
+    BOOST_CHECK(values.empty());
     BOOST_CHECK_EQUAL(autocomplete, false);
   }
 
@@ -280,17 +441,18 @@ namespace tests{
     testJson["timestamp"] = "testTimestamp";
 
     std::string dstString;
+    std::vector<std::string> values;
     bool autocomplete = false;
-    queryAdapterTest1.parseJsonTest(dstString, testJson, autocomplete);
-    BOOST_CHECK_EQUAL(dstString, "SELECT name FROM cmip5 WHERE activity=\'testActivity\' AND \
-ensemble=\'testEnsemble\' AND ensemble member=\'testEnsembleMember\' AND \
-experiment=\'testExperiment\' AND field campaign=\'testFieldCampaign\' AND \
-frequency=\'testFrenquency\' AND grid resolution=\'testGridResolution\' AND \
-model=\'testModel\' AND modeling realm=\'testModeling\' AND name=\'test\' AND \
-optical properties for radiation=\'testOptProperties\' AND origanization=\'testOrg\' AND \
-output type=\'testOutputType\' AND product=\'testProduct\' AND sample \
-granularity=\'testSampleGranularity\' AND start time=\'testStartTime\' AND \
-timestamp=\'testTimestamp\' AND variable name=\'testVarName\';");
+    queryAdapterTest1.parseJsonTest(dstString, values, testJson, autocomplete);
+    BOOST_CHECK_EQUAL(dstString, "SELECT name FROM cmip5 WHERE `activity`=? AND \
+`ensemble`=? AND `ensemble member`=? AND `experiment`=? AND `field campaign`=? AND \
+`frequency`=? AND `grid resolution`=? AND `model`=? AND `modeling realm`=? AND `name`=? AND \
+`optical properties for radiation`=? AND `origanization`=? AND `output type`=? AND \
+`product`=? AND `sample granularity`=? AND `start time`=? AND `timestamp`=? AND \
+`variable name`=?;");
+    BOOST_REQUIRE_EQUAL(values.size(), 18);
+    BOOST_CHECK_EQUAL(values[0], "testActivity");
+    BOOST_CHECK_EQUAL(values[17], "testVarName");
     BOOST_CHECK_EQUAL(autocomplete, false);
   }
 
@@ -301,13 +463,34 @@ timestamp=\'testTimestamp\' AND variable name=\'testVarName\';");
     testJson["?"] = "serchTest";
 
     std::string dstString;
+    std::vector<std::string> values;
     bool autocomplete = false;
-    queryAdapterTest1.parseJsonTest(dstString, testJson, autocomplete);
-    BOOST_CHECK_EQUAL(dstString,
-      "SELECT name FROM cmip5 WHERE name REGEXP \'^serchTest\' AND name=\'test\';");
+    queryAdapterTest1.parseJsonTest(dstString, values, testJson, autocomplete);
+    BOOST_CHECK_EQUAL(dstString, "SELECT name FROM cmip5 WHERE name REGEXP ? AND `name`=?;");
+    std::vector<std::string> expectedValues = {"^serchTest", "test"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(values.begin(), values.end(),
+                                  expectedValues.begin(), expectedValues.end());
     BOOST_CHECK_EQUAL(autocomplete, true);
   }
 
+  BOOST_AUTO_TEST_CASE(QueryAdapterJsonParseQuotingTest)
+  {
+    // neither values nor columns can end the condition they are in
+    Json::Value testJson;
+    testJson["name"] = "test' OR '1'='1";
+    testJson["x` OR 1 OR `y"] = "test";
+
+    std::string dstString;
+    std::vector<std::string> values;
+    bool autocomplete = false;
+    queryAdapterTest1.parseJsonTest(dstString, values, testJson, autocomplete);
+    BOOST_CHECK_EQUAL(dstString,
+      "SELECT name FROM cmip5 WHERE `name`=? AND `x`` OR 1 OR ``y`=?;");
+    std::vector<std::string> expectedValues = {"test' OR '1'='1", "test"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(values.begin(), values.end(),
+                                  expectedValues.begin(), expectedValues.end());
+  }
+
   BOOST_AUTO_TEST_CASE(QueryAdapterMakeAckDataTest)
   {
     ndn::Interest interest(ndn::Name("/test/ack/data/json"));
@@ -321,6 +504,68 @@ timestamp=\'testTimestamp\' AND variable name=\'testVarName\';");
     std::shared_ptr<ndn::Data> data = queryAdapterTest2.getAckData(interestPtr, version);
     BOOST_CHECK_EQUAL(data->getName().toUri(), "/test/ack/data/json/%FD%01/OK");
     BOOST_CHECK_EQUAL(data->getContent().value_size(), 0);
+
+    // with a manifest, the ACK names it
+    queryAdapterTest2.setSignManifest(true);
+    data = queryAdapterTest2.getAckData(interestPtr, version);
+    ndn::Block content = data->getContent();
+    content.parse();
+    BOOST_REQUIRE_EQUAL(content.elements().size(), 1);
+    BOOST_CHECK_EQUAL(ndn::Name(content.elements()[0]),
+                      ndn::Name(queryAdapterTest2.getPrefix())
+                        .append("query-results").append(version).append("manifest"));
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterSigningAlgorithmTest)
+  {
+    const ndn::Name identity("/test/query-adapter/ecdsa");
+    keyChain->createIdentity(identity);
+    const ndn::Name keyName = keyChain->generateEcdsaKeyPair(identity);
+    keyChain->addCertificateAsKeyDefault(*keyChain->selfSign(keyName));
+
+    util::ConfigSection section;
+    std::stringstream ss;
+    ss << "signingId /test/query-adapter/ecdsa\
+           signingAlgorithm ecdsa";
+    boost::property_tree::read_info(ss, section);
+    queryAdapterTest1.configAdapter(section, ndn::Name("/test"));
+
+    // the ECDSA key is picked although the default key of the identity is RSA
+    ndn::Interest interest(ndn::Name("/test/query/json"));
+    std::shared_ptr<const ndn::Interest> interestPtr = std::make_shared<ndn::Interest>(interest);
+    for (uint64_t i = 0; i < 3; ++i) {
+      std::shared_ptr<ndn::Data> data
+        = queryAdapterTest1.getAckData(interestPtr, ndn::name::Component::fromVersion(i));
+      BOOST_CHECK_EQUAL(data->getSignature().getType(), ndn::tlv::SignatureSha256WithEcdsa);
+    }
+    keyChain->deleteIdentity(identity);
+
+    util::ConfigSection invalidSection;
+    std::stringstream invalid;
+    invalid << "signingAlgorithm hmac";
+    boost::property_tree::read_info(invalid, invalidSection);
+    BOOST_CHECK_THROW(queryAdapterTest2.configAdapter(invalidSection, ndn::Name("/test")),
+                      util::CatalogAdapter::Error);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterDefaultSigningKeyTest)
+  {
+    // without signingAlgorithm, the default key of the identity signs, whatever its type
+    const ndn::Name identity("/test/query-adapter/default-ecdsa");
+    keyChain->createIdentity(identity, ndn::EcdsaKeyParams());
+
+    util::ConfigSection section;
+    std::stringstream ss;
+    ss << "signingId /test/query-adapter/default-ecdsa";
+    boost::property_tree::read_info(ss, section);
+    queryAdapterTest1.configAdapter(section, ndn::Name("/test"));
+
+    ndn::Interest interest(ndn::Name("/test/query/json"));
+    std::shared_ptr<const ndn::Interest> interestPtr = std::make_shared<ndn::Interest>(interest);
+    std::shared_ptr<ndn::Data> data
+      = queryAdapterTest1.getAckData(interestPtr, ndn::name::Component::fromVersion(1));
+    BOOST_CHECK_EQUAL(data->getSignature().getType(), ndn::tlv::SignatureSha256WithEcdsa);
+    keyChain->deleteIdentity(identity);
   }
 
   BOOST_AUTO_TEST_CASE(QueryAdapterMakeReplyDataTest1)
@@ -369,6 +614,65 @@ timestamp=\'testTimestamp\' AND variable name=\'testVarName\';");
     BOOST_CHECK_EQUAL(parsedFromString["next"][0], "/ndn/test1");
   }
 
+  BOOST_AUTO_TEST_CASE(QueryAdapterManifestTest)
+  {
+    const ndn::Name prefix("/atmos/test/prefix");
+    std::vector<ndn::name::Component> digests;
+    for (uint64_t segmentNo = 0; segmentNo < 300; ++segmentNo) {
+      Json::Value fileList;
+      fileList.append("/ndn/test1");
+      std::shared_ptr<ndn::Data> data = queryAdapterTest2.getReplyData(prefix, fileList, segmentNo,
+                                                                       segmentNo == 299, false,
+                                                                       true);
+      BOOST_CHECK_EQUAL(data->getSignature().getType(), ndn::tlv::DigestSha256);
+      digests.push_back(data->getFullName().get(-1));
+    }
+
+    std::vector<std::shared_ptr<ndn::Data>> manifest
+      = queryAdapterTest2.getManifestData(prefix, digests);
+    BOOST_REQUIRE_GT(manifest.size(), 1);
+
+    std::vector<ndn::name::Component> manifestDigests;
+    for (size_t i = 0; i < manifest.size(); ++i) {
+      BOOST_CHECK_EQUAL(manifest[i]->getName(),
+                        ndn::Name(prefix).append("manifest").appendSegment(i));
+      BOOST_CHECK_LE(manifest[i]->getContent().value_size(), query::PAYLOAD_LIMIT + 34);
+      BOOST_CHECK_NE(manifest[i]->getSignature().getType(), ndn::tlv::DigestSha256);
+
+      ndn::Block content = manifest[i]->getContent();
+      content.parse();
+      for (const auto& element : content.elements()) {
+        BOOST_CHECK_EQUAL(element.type(), ndn::tlv::ImplicitSha256DigestComponent);
+        manifestDigests.push_back(ndn::name::Component(element));
+      }
+    }
+    BOOST_CHECK_EQUAL(manifest.back()->getFinalBlockId(),
+                      ndn::Name::Component::fromSegment(manifest.size() - 1));
+    BOOST_CHECK(manifestDigests == digests);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterParallelSigningTest)
+  {
+    initializeQueryAdapterTest1();
+    const ndn::Name prefix("/atmos/test/prefix");
+    queryAdapterTest1.signInParallel(prefix, 50, 3);
+
+    for (uint64_t segmentNo = 0; segmentNo < 50; ++segmentNo) {
+      ndn::Name segmentName(prefix);
+      segmentName.appendSegment(segmentNo);
+      std::shared_ptr<const ndn::Data> data
+        = queryAdapterTest1.getDataFromCache(ndn::Interest(segmentName));
+      BOOST_REQUIRE(data != nullptr);
+      BOOST_CHECK_EQUAL(data->getName(), segmentName);
+      BOOST_CHECK_NE(data->getSignature().getType(), ndn::tlv::DigestSha256);
+    }
+    ndn::Name lastName(prefix);
+    lastName.appendSegment(49);
+    std::shared_ptr<const ndn::Data> lastData
+      = queryAdapterTest1.getDataFromCache(ndn::Interest(lastName));
+    BOOST_CHECK_EQUAL(lastData->getFinalBlockId(), ndn::Name::Component::fromSegment(49));
+  }
+
   BOOST_AUTO_TEST_CASE(QueryAdapterQueryProcessTest)
   {
     initializeQueryAdapterTest2();
@@ -408,6 +712,719 @@ timestamp=\'testTimestamp\' AND variable name=\'testVarName\';");
     }
   }
 
+  BOOST_AUTO_TEST_CASE(QueryAdapterNameTrieTest)
+  {
+    initializeQueryAdapterTest2();
+    std::vector<std::string> names;
+    names.push_back("/CMIP5/output1/MOHC/HadCM3");
+    names.push_back("/CMIP5/output1/MOHC/HadGEM2");
+    names.push_back("/CMIP5/output1/NASA/GISS");
+    names.push_back("/CMIP5/output2/MOHC/HadCM3");
+    queryAdapterTest2.loadNames(names);
+
+    // answered without SQL, which prepareSegments would check
+    Json::Value query;
+    query["?"] = "/CMIP5/output1/";
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    std::shared_ptr<ndn::Interest> queryInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str()));
+    queryAdapterTest2.queryTest(queryInterest);
+    auto ackData = queryAdapterTest2.getDataFromActiveQuery(jsonMessage);
+    BOOST_REQUIRE(ackData);
+
+    ndn::Name segmentName("/test/query-results");
+    segmentName.append(ackData->getName()[3]).appendSegment(0);
+    auto replyData = queryAdapterTest2.getDataFromCache(ndn::Interest(segmentName));
+    BOOST_REQUIRE(replyData);
+    BOOST_CHECK_EQUAL(replyData->getFinalBlockId(), ndn::Name::Component::fromSegment(0));
+    const std::string jsonRes(reinterpret_cast<const char*>(replyData->getContent().value()));
+    Json::Value parsedFromString;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+    BOOST_REQUIRE_EQUAL(parsedFromString["next"].size(), 2);
+    BOOST_CHECK_EQUAL(parsedFromString["next"][0], "/CMIP5/output1/MOHC/");
+    BOOST_CHECK_EQUAL(parsedFromString["next"][1], "/CMIP5/output1/NASA/");
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterTopKAutocompleteTest)
+  {
+    util::ConfigSection section;
+    std::stringstream ss;
+    ss << "autocompleteTopK 2";
+    boost::property_tree::read_info(ss, section);
+    queryAdapterTest2.configAdapter(section, ndn::Name("/test"));
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; ++i) {
+      names.push_back("/CMIP5/model" + std::to_string(i % 100) + "/" + std::to_string(i));
+    }
+    // the models with more names come first
+    names.push_back("/CMIP5/model42/extra");
+    names.push_back("/CMIP5/model7/extra1");
+    names.push_back("/CMIP5/model7/extra2");
+    queryAdapterTest2.loadNames(names);
+
+    Json::Value query;
+    query["?"] = "/CMIP5/";
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    std::shared_ptr<ndn::Interest> queryInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str()));
+    queryAdapterTest2.queryTest(queryInterest);
+    auto ackData = queryAdapterTest2.getDataFromActiveQuery(jsonMessage);
+    BOOST_REQUIRE(ackData);
+
+    // a single small segment
+    ndn::Name segmentName("/test/query-results");
+    segmentName.append(ackData->getName()[3]).appendSegment(0);
+    auto replyData = queryAdapterTest2.getDataFromCache(ndn::Interest(segmentName));
+    BOOST_REQUIRE(replyData);
+    BOOST_CHECK_EQUAL(replyData->getFinalBlockId(), ndn::Name::Component::fromSegment(0));
+    const std::string jsonRes(reinterpret_cast<const char*>(replyData->getContent().value()));
+    Json::Value parsedFromString;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+    BOOST_REQUIRE_EQUAL(parsedFromString["next"].size(), 2);
+    BOOST_CHECK_EQUAL(parsedFromString["next"][0], "/CMIP5/model7/");
+    BOOST_CHECK_EQUAL(parsedFromString["next"][1], "/CMIP5/model42/");
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterNextComponentsTest)
+  {
+    initializeQueryAdapterTest3();
+    std::vector<std::string> names;
+    names.push_back("/CMIP5/output1/MOHC/HadCM3");
+    names.push_back("/CMIP5/output1/MOHC/HadGEM2");
+    names.push_back("/CMIP5/output1/NASA/GISS");
+    names.push_back("/CMIP5/output1/NCAR/CCSM4");
+    queryAdapterTest3.catalogNames = names;
+
+    auto runQuery = [this] (const Json::Value& query) -> Json::Value {
+      Json::FastWriter fastWriter;
+      std::string jsonMessage = fastWriter.write(query);
+      jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'),
+                        jsonMessage.end());
+      queryAdapterTest3.queryTest(
+        std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str())));
+      auto ackData = queryAdapterTest3.getDataFromActiveQuery(jsonMessage);
+      BOOST_REQUIRE(ackData);
+
+      ndn::Name segmentName("/test/query-results");
+      segmentName.append(ackData->getName()[3]).appendSegment(0);
+      auto replyData = queryAdapterTest3.getDataFromCache(ndn::Interest(segmentName));
+      BOOST_REQUIRE(replyData);
+      const std::string jsonRes(reinterpret_cast<const char*>(replyData->getContent().value()));
+      Json::Value parsedFromString;
+      Json::Reader reader;
+      BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+      return parsedFromString;
+    };
+
+    // until the names are loaded, those under the prefix are fetched and completed the same way
+    Json::Value query;
+    query["?"] = "/CMIP5/output1_";
+    Json::Value reply = runQuery(query);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 1);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.lastSqlCondition, " name LIKE BINARY ?");
+    BOOST_REQUIRE_EQUAL(queryAdapterTest3.lastSqlValues.size(), 1);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.lastSqlValues[0], "/CMIP5/output1\\_%");
+    BOOST_CHECK_EQUAL(reply["next"].size(), 0);
+
+    query["?"] = "/CMIP5/output1/";
+    reply = runQuery(query);
+    BOOST_REQUIRE_EQUAL(reply["next"].size(), 3);
+    BOOST_CHECK_EQUAL(reply["next"][0], "/CMIP5/output1/MOHC/");
+    BOOST_CHECK_EQUAL(reply["next"][1], "/CMIP5/output1/NASA/");
+    BOOST_CHECK_EQUAL(reply["next"][2], "/CMIP5/output1/NCAR/");
+
+    // pages of completions are cut after the cursor, from the loaded names as well
+    queryAdapterTest3.loadNames(names);
+    query["pageSize"] = 2;
+    reply = runQuery(query);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 2);
+    BOOST_REQUIRE_EQUAL(reply["next"].size(), 2);
+    BOOST_CHECK_EQUAL(reply["next"][1], "/CMIP5/output1/NASA/");
+    BOOST_CHECK_EQUAL(reply["cursor"].asString(), "/CMIP5/output1/NASA/");
+    BOOST_CHECK_EQUAL(reply["total"].asUInt64(), 3);
+
+    query["cursor"] = "/CMIP5/output1/NASA/";
+    reply = runQuery(query);
+    BOOST_REQUIRE_EQUAL(reply["next"].size(), 1);
+    BOOST_CHECK_EQUAL(reply["next"][0], "/CMIP5/output1/NCAR/");
+    BOOST_CHECK(!reply.isMember("cursor"));
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterFacetIndexTest)
+  {
+    util::ConfigSection section;
+    std::stringstream ss;
+    ss << "facetIndex yes";
+    boost::property_tree::read_info(ss, section);
+    queryAdapterTest2.configAdapter(section, ndn::Name("/test"));
+
+    // facets in the order of the indexed columns: activity, product, organization, model, ...
+    std::vector<std::string> names;
+    std::vector<std::vector<std::string>> values;
+    const char* models[] = {"HadCM3", "GISS", "HadCM3"};
+    const char* experiments[] = {"decadal1990", "decadal1990", "decadal2000"};
+    for (int i = 0; i < 3; ++i) {
+      names.push_back("/CMIP5/output1/" + std::to_string(i));
+      std::vector<std::string> facets(9, "any");
+      facets[3] = models[i];
+      facets[4] = experiments[i];
+      values.push_back(facets);
+    }
+    queryAdapterTest2.loadFacets(names, values);
+
+    // answered without SQL, which prepareSegments would check
+    Json::Value query;
+    query["model"] = "HadCM3";
+    query["experiment"] = "decadal1990";
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    std::shared_ptr<ndn::Interest> queryInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str()));
+    queryAdapterTest2.queryTest(queryInterest);
+    auto ackData = queryAdapterTest2.getDataFromActiveQuery(jsonMessage);
+    BOOST_REQUIRE(ackData);
+
+    ndn::Name segmentName("/test/query-results");
+    segmentName.append(ackData->getName()[3]).appendSegment(0);
+    auto replyData = queryAdapterTest2.getDataFromCache(ndn::Interest(segmentName));
+    BOOST_REQUIRE(replyData);
+    BOOST_CHECK_EQUAL(replyData->getFinalBlockId(), ndn::Name::Component::fromSegment(0));
+    const std::string jsonRes(reinterpret_cast<const char*>(replyData->getContent().value()));
+    Json::Value parsedFromString;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+    BOOST_REQUIRE_EQUAL(parsedFromString["results"].size(), 1);
+    BOOST_CHECK_EQUAL(parsedFromString["results"][0], "/CMIP5/output1/0");
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterFacetCountsTest)
+  {
+    util::ConfigSection section;
+    std::stringstream ss;
+    ss << "facetIndex yes";
+    boost::property_tree::read_info(ss, section);
+    queryAdapterTest2.configAdapter(section, ndn::Name("/test"));
+
+    std::vector<std::string> names;
+    std::vector<std::vector<std::string>> values;
+    const char* models[] = {"HadCM3", "GISS", "HadCM3"};
+    const char* experiments[] = {"decadal1990", "decadal1990", "decadal2000"};
+    for (int i = 0; i < 3; ++i) {
+      names.push_back("/CMIP5/output1/" + std::to_string(i));
+      std::vector<std::string> facets(9, "any");
+      facets[3] = models[i];
+      facets[4] = experiments[i];
+      values.push_back(facets);
+    }
+    queryAdapterTest2.loadFacets(names, values);
+
+    Json::Value query;
+    query["experiment"] = "decadal1990";
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    std::shared_ptr<ndn::Interest> facetsInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/facets").append(jsonMessage.c_str()));
+    queryAdapterTest2.queryTest(facetsInterest);
+    // kept apart from the query with the same filter
+    BOOST_CHECK(!queryAdapterTest2.getDataFromActiveQuery(jsonMessage));
+    auto ackData = queryAdapterTest2.getDataFromActiveQuery("{\"facets\":" + jsonMessage + "}");
+    BOOST_REQUIRE(ackData);
+    BOOST_CHECK_EQUAL(ackData->getName().getPrefix(3), facetsInterest->getName());
+
+    ndn::Name segmentName("/test/query-results");
+    segmentName.append(ackData->getName()[3]).appendSegment(0);
+    auto replyData = queryAdapterTest2.getDataFromCache(ndn::Interest(segmentName));
+    BOOST_REQUIRE(replyData);
+    BOOST_CHECK_EQUAL(replyData->getFinalBlockId(), ndn::Name::Component::fromSegment(0));
+    const std::string jsonRes(reinterpret_cast<const char*>(replyData->getContent().value()));
+    Json::Value parsedFromString;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+    const Json::Value& facets = parsedFromString["facets"];
+    BOOST_CHECK(!facets.isMember("experiment"));
+    BOOST_CHECK_EQUAL(facets["model"].size(), 2);
+    BOOST_CHECK_EQUAL(facets["model"]["HadCM3"].asUInt64(), 1);
+    BOOST_CHECK_EQUAL(facets["model"]["GISS"].asUInt64(), 1);
+    BOOST_CHECK_EQUAL(facets["activity"]["any"].asUInt64(), 2);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterEquivalentQueriesTest)
+  {
+    initializeQueryAdapterTest3();
+    std::shared_ptr<ndn::Interest> queryInterest1
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query")
+                                          .append("{\"name\":\"test\",\"model\":\"CCSM4\"}"));
+    std::shared_ptr<ndn::Interest> queryInterest2
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query")
+                                          .append("{ \"model\" : \"CCSM4\", \"name\" : \"test\" }"));
+
+    queryAdapterTest3.queryTest(queryInterest1);
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_REQUIRE_EQUAL(face->sentDatas.size(), 1);
+    const ndn::Data ack1 = face->sentDatas[0];
+
+    face->sentDatas.clear();
+    queryAdapterTest3.queryTest(queryInterest2);
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_REQUIRE_EQUAL(face->sentDatas.size(), 1);
+    const ndn::Data ack2 = face->sentDatas[0];
+
+    // the second query is answered with the results of the first one, under its own name
+    BOOST_CHECK_EQUAL(ack2.getName().getPrefix(-2), queryInterest2->getName());
+    BOOST_CHECK_EQUAL(ack2.getName()[-2], ack1.getName()[-2]);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 1);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.lastSqlCondition, " `model`=? AND `name`=?");
+    std::vector<std::string> expectedValues = {"CCSM4", "test"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(queryAdapterTest3.lastSqlValues.begin(),
+                                  queryAdapterTest3.lastSqlValues.end(),
+                                  expectedValues.begin(), expectedValues.end());
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterStatusTest)
+  {
+    initializeQueryAdapterTest3();
+    std::shared_ptr<ndn::Interest> queryInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query")
+                                          .append("{\"name\":\"test\"}"));
+    queryAdapterTest3.queryTest(queryInterest);
+    queryAdapterTest3.queryTest(queryInterest);
+    advanceClocks(ndn::time::milliseconds(10));
+
+    face->sentDatas.clear();
+    queryAdapterTest3.statusTest(ndn::Interest(ndn::Name("/test/status")));
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_REQUIRE_EQUAL(face->sentDatas.size(), 1);
+    const ndn::Data status = face->sentDatas[0];
+    BOOST_CHECK(ndn::Name("/test/status").isPrefixOf(status.getName()));
+    BOOST_CHECK(status.getName()[-2].isVersion());
+    BOOST_CHECK_EQUAL(status.getName()[-1].toSegment(), 0);
+    BOOST_CHECK_EQUAL(status.getFinalBlockId(), status.getName()[-1]);
+
+    const std::string jsonStatus(reinterpret_cast<const char*>(status.getContent().value()),
+                                 status.getContent().value_size());
+    Json::Value parsedStatus;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(jsonStatus, parsedStatus));
+    BOOST_CHECK_EQUAL(parsedStatus["counters"]["queries"].asUInt64(), 2);
+    BOOST_CHECK_EQUAL(parsedStatus["counters"]["coalesced"].asUInt64(), 1);
+    BOOST_CHECK_EQUAL(parsedStatus["counters"]["executions"].asUInt64(), 1);
+    BOOST_CHECK_EQUAL(parsedStatus["stages"]["jsonParse"]["count"].asUInt64(), 2);
+    BOOST_CHECK_EQUAL(parsedStatus["stages"]["sqlBuild"]["count"].asUInt64(), 1);
+    BOOST_CHECK(parsedStatus["stages"]["cacheInsert"]["count"].asUInt64() > 0);
+    BOOST_CHECK(parsedStatus["cache"]["segments"].asUInt64() > 0);
+
+    // the same version is served until it goes stale, also by its full name
+    face->sentDatas.clear();
+    queryAdapterTest3.statusTest(ndn::Interest(status.getName()));
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_REQUIRE_EQUAL(face->sentDatas.size(), 1);
+    BOOST_CHECK_EQUAL(face->sentDatas[0].getName(), status.getName());
+
+    // and a replaced version is NACKed rather than left unanswered
+    advanceClocks(ndn::time::milliseconds(1000));
+    face->sentDatas.clear();
+    queryAdapterTest3.statusTest(ndn::Interest(status.getName()));
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_CHECK(face->sentDatas.empty());
+    BOOST_CHECK_EQUAL(face->sentNacks.size(), 1);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterLazySegmentsTest)
+  {
+    initializeQueryAdapterTest3();
+    for (int i = 0; i < 3000; ++i) {
+      std::stringstream name;
+      name << "/ndn/test/" << std::setw(4) << std::setfill('0') << i;
+      queryAdapterTest3.catalogNames.push_back(name.str());
+    }
+
+    Json::Value query;
+    query["activity"] = "testActivity";
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    std::shared_ptr<ndn::Interest> queryInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str()));
+
+    queryAdapterTest3.queryTest(queryInterest);
+    // deliver the ACK
+    advanceClocks(ndn::time::milliseconds(10));
+    auto ackData = queryAdapterTest3.getDataFromActiveQuery(jsonMessage);
+    BOOST_REQUIRE(ackData);
+    ndn::Name segmentPrefix("/test/query-results");
+    segmentPrefix.append(ackData->getName()[3]);
+
+    // only the first segment and the read-ahead window are generated up front
+    BOOST_CHECK(queryAdapterTest3.getDataFromCache(
+                  ndn::Interest(ndn::Name(segmentPrefix).appendSegment(0))));
+    BOOST_CHECK(queryAdapterTest3.getDataFromCache(
+                  ndn::Interest(ndn::Name(segmentPrefix).appendSegment(1))));
+    BOOST_CHECK(!queryAdapterTest3.getDataFromCache(
+                  ndn::Interest(ndn::Name(segmentPrefix).appendSegment(2))));
+
+    // fetching the segments one by one generates the rest, in order and without gaps
+    std::vector<std::string> fetchedNames;
+    bool isFinal = false;
+    uint64_t finalSegment = 0;
+    for (uint64_t segmentNo = 0; !isFinal && segmentNo < 20; ++segmentNo) {
+      ndn::Interest interest(ndn::Name(segmentPrefix).appendSegment(segmentNo));
+      face->sentDatas.clear();
+      queryAdapterTest3.resultsTest(interest);
+      advanceClocks(ndn::time::milliseconds(10));
+      BOOST_REQUIRE_EQUAL(face->sentDatas.size(), 1);
+      const ndn::Data& data = face->sentDatas[0];
+      BOOST_CHECK_EQUAL(data.getName(), interest.getName());
+
+      const std::string jsonRes(reinterpret_cast<const char*>(data.getContent().value()));
+      Json::Value parsedFromString;
+      Json::Reader reader;
+      BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+      for (const auto& name : parsedFromString["results"]) {
+        fetchedNames.push_back(name.asString());
+      }
+      isFinal = data.getFinalBlockId() == ndn::Name::Component::fromSegment(segmentNo);
+      finalSegment = segmentNo;
+    }
+    BOOST_REQUIRE(isFinal);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.lastSqlCondition, " `activity`=?");
+    BOOST_REQUIRE_EQUAL(queryAdapterTest3.lastSqlValues.size(), 1);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.lastSqlValues[0], "testActivity");
+    BOOST_CHECK(fetchedNames == queryAdapterTest3.catalogNames);
+    // each request generated at most one segment beyond the read-ahead window
+    BOOST_CHECK_LT(queryAdapterTest3.nFetches, 20);
+
+    // evicted segments are generated again as they were, the final one included
+    for (uint64_t segmentNo : {uint64_t(1), uint64_t(finalSegment)}) {
+      ndn::Interest interest(ndn::Name(segmentPrefix).appendSegment(segmentNo));
+      auto cachedData = queryAdapterTest3.getDataFromCache(interest);
+      BOOST_REQUIRE(cachedData);
+      queryAdapterTest3.evictFromCache(interest.getName());
+      BOOST_REQUIRE(!queryAdapterTest3.getDataFromCache(interest));
+
+      face->sentDatas.clear();
+      queryAdapterTest3.resultsTest(interest);
+      advanceClocks(ndn::time::milliseconds(10));
+      BOOST_REQUIRE_EQUAL(face->sentDatas.size(), 1);
+      BOOST_CHECK(face->sentDatas[0].getContent() == cachedData->getContent());
+      BOOST_CHECK(face->sentDatas[0].getFinalBlockId() == cachedData->getFinalBlockId());
+      BOOST_CHECK(queryAdapterTest3.getDataFromCache(interest));
+    }
+
+    // nothing comes after the final segment
+    face->sentDatas.clear();
+    queryAdapterTest3.resultsTest(
+      ndn::Interest(ndn::Name(segmentPrefix).appendSegment(finalSegment + 1)));
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_CHECK(face->sentDatas.empty());
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterPaginationTest)
+  {
+    initializeQueryAdapterTest3();
+    for (int i = 0; i < 25; ++i) {
+      queryAdapterTest3.catalogNames.push_back("/ndn/test/" + std::to_string(100 + i));
+    }
+
+    Json::Value query;
+    query["activity"] = "testActivity";
+    query["pageSize"] = 10;
+    std::string cursor;
+    for (int page = 0; page < 3; ++page) {
+      if (page > 0) {
+        query["cursor"] = cursor;
+      }
+      Json::FastWriter fastWriter;
+      std::string jsonMessage = fastWriter.write(query);
+      jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'),
+                        jsonMessage.end());
+      std::shared_ptr<ndn::Interest> queryInterest
+        = std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str()));
+      queryAdapterTest3.queryTest(queryInterest);
+      auto ackData = queryAdapterTest3.getDataFromActiveQuery(jsonMessage);
+      BOOST_REQUIRE(ackData);
+
+      // a page is a single segment, generated right away
+      ndn::Name segmentName("/test/query-results");
+      segmentName.append(ackData->getName()[3]).appendSegment(0);
+      auto replyData = queryAdapterTest3.getDataFromCache(ndn::Interest(segmentName));
+      BOOST_REQUIRE(replyData);
+      BOOST_CHECK_EQUAL(replyData->getFinalBlockId(), ndn::Name::Component::fromSegment(0));
+      const std::string jsonRes(reinterpret_cast<const char*>(replyData->getContent().value()));
+      Json::Value parsedFromString;
+      Json::Reader reader;
+      BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+
+      const Json::Value& results = parsedFromString["results"];
+      BOOST_REQUIRE_EQUAL(results.size(), page < 2 ? 10 : 5);
+      BOOST_CHECK_EQUAL(results[0].asString(), "/ndn/test/" + std::to_string(100 + page * 10));
+      if (page == 0) {
+        BOOST_CHECK_EQUAL(parsedFromString["total"].asUInt(), 25);
+      }
+      else {
+        BOOST_CHECK(!parsedFromString.isMember("total"));
+      }
+      if (page < 2) {
+        cursor = parsedFromString["cursor"].asString();
+        BOOST_CHECK_EQUAL(cursor, results[9].asString());
+      }
+      else {
+        BOOST_CHECK(!parsedFromString.isMember("cursor"));
+      }
+    }
+    // the conditions go to the database without the page parameters
+    BOOST_CHECK_EQUAL(queryAdapterTest3.lastSqlCondition, " `activity`=?");
+    BOOST_REQUIRE_EQUAL(queryAdapterTest3.lastSqlValues.size(), 1);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.lastSqlValues[0], "testActivity");
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 3);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nCounts, 1);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterPageSizeTest)
+  {
+    initializeQueryAdapterTest3("maxPageSize 10");
+    for (int i = 0; i < 25; ++i) {
+      queryAdapterTest3.catalogNames.push_back("/ndn/test/" + std::to_string(100 + i));
+    }
+
+    Json::FastWriter fastWriter;
+    auto makeQuery = [&fastWriter] (const Json::Value& pageSize) {
+      Json::Value query;
+      query["activity"] = "testActivity";
+      query["pageSize"] = pageSize;
+      std::string jsonMessage = fastWriter.write(query);
+      jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'),
+                        jsonMessage.end());
+      return jsonMessage;
+    };
+
+    // neither negative nor zero nor anything but digits
+    for (const Json::Value& pageSize : {Json::Value("-1"), Json::Value(-1), Json::Value(0),
+                                        Json::Value("0"), Json::Value("5x"), Json::Value("")}) {
+      const std::string jsonMessage = makeQuery(pageSize);
+      queryAdapterTest3.queryTest(std::make_shared<ndn::Interest>(
+                                    ndn::Name("/test/query").append(jsonMessage.c_str())));
+      BOOST_CHECK(!queryAdapterTest3.getDataFromActiveQuery(jsonMessage));
+    }
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 0);
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_CHECK_EQUAL(face->sentNacks.size(), 6);
+    BOOST_CHECK(face->sentDatas.empty());
+
+    // larger pages are cut down to maxPageSize, with a cursor to the rest
+    for (const Json::Value& pageSize : {Json::Value("25"), Json::Value("99999999999999999999999"),
+                                        Json::Value(20)}) {
+      const std::string jsonMessage = makeQuery(pageSize);
+      queryAdapterTest3.queryTest(std::make_shared<ndn::Interest>(
+                                    ndn::Name("/test/query").append(jsonMessage.c_str())));
+      auto ackData = queryAdapterTest3.getDataFromActiveQuery(jsonMessage);
+      BOOST_REQUIRE(ackData);
+
+      ndn::Name segmentName("/test/query-results");
+      segmentName.append(ackData->getName()[3]).appendSegment(0);
+      auto replyData = queryAdapterTest3.getDataFromCache(ndn::Interest(segmentName));
+      BOOST_REQUIRE(replyData);
+      const std::string jsonRes(reinterpret_cast<const char*>(replyData->getContent().value()));
+      Json::Value parsedFromString;
+      Json::Reader reader;
+      BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+      BOOST_CHECK_EQUAL(parsedFromString["results"].size(), 10);
+      BOOST_CHECK_EQUAL(parsedFromString["cursor"].asString(), "/ndn/test/109");
+    }
+
+    util::ConfigSection invalidSection;
+    std::stringstream invalid;
+    invalid << "maxPageSize 0";
+    boost::property_tree::read_info(invalid, invalidSection);
+    BOOST_CHECK_THROW(queryAdapterTest2.configAdapter(invalidSection, ndn::Name("/test")),
+                      util::CatalogAdapter::Error);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterFailedQueryTest)
+  {
+    initializeQueryAdapterTest3();
+    queryAdapterTest3.catalogNames.push_back("/ndn/test/1");
+
+    Json::Value query;
+    query["activity"] = "testActivity";
+    query["pageSize"] = 10;
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    std::shared_ptr<ndn::Interest> queryInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str()));
+
+    // a failed query is not active, so that the next Interest for it runs it again
+    queryAdapterTest3.isFetchFailing = true;
+    queryAdapterTest3.queryTest(queryInterest);
+    BOOST_CHECK(!queryAdapterTest3.getDataFromActiveQuery(jsonMessage));
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 1);
+
+    queryAdapterTest3.isFetchFailing = false;
+    queryAdapterTest3.queryTest(queryInterest);
+    BOOST_CHECK(queryAdapterTest3.getDataFromActiveQuery(jsonMessage));
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 2);
+
+    // a ready query is not run again
+    queryAdapterTest3.queryTest(queryInterest);
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 2);
+
+    // so is one whose segments are generated on demand, if its first ones cannot be
+    query.removeMember("pageSize");
+    jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    queryAdapterTest3.isFetchFailing = true;
+    queryAdapterTest3.queryTest(
+      std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str())));
+    BOOST_CHECK(!queryAdapterTest3.getDataFromActiveQuery(jsonMessage));
+    BOOST_CHECK_EQUAL(queryAdapterTest3.nFetches, 3);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterBinaryFormatTest)
+  {
+    initializeQueryAdapterTest3();
+    for (int i = 0; i < 25; ++i) {
+      queryAdapterTest3.catalogNames.push_back("/ndn/test/" + std::to_string(100 + i));
+    }
+
+    Json::Value query;
+    query["activity"] = "testActivity";
+    query["pageSize"] = 10;
+    query["format"] = "xml";
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    queryAdapterTest3.queryTest(
+      std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str())));
+    BOOST_CHECK(!queryAdapterTest3.getDataFromActiveQuery(jsonMessage));
+    advanceClocks(ndn::time::milliseconds(10));
+    BOOST_CHECK_EQUAL(face->sentNacks.size(), 1);
+
+    query["format"] = "tlv";
+    jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    queryAdapterTest3.queryTest(
+      std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str())));
+    auto ackData = queryAdapterTest3.getDataFromActiveQuery(jsonMessage);
+    BOOST_REQUIRE(ackData);
+
+    ndn::Name segmentName("/test/query-results");
+    segmentName.append(ackData->getName()[3]).appendSegment(0);
+    auto replyData = queryAdapterTest3.getDataFromCache(ndn::Interest(segmentName));
+    BOOST_REQUIRE(replyData);
+    ndn::Block content = replyData->getContent();
+    content.parse();
+
+    // front-coded names, then the cursor and the total of the page
+    std::vector<std::string> names;
+    std::string cursor;
+    uint64_t total = 0;
+    for (const auto& element : content.elements()) {
+      if (element.type() == query::tlv::ResultName) {
+        ndn::Buffer::const_iterator begin = element.value_begin();
+        const uint64_t shared = ndn::tlv::readVarNumber(begin, element.value_end());
+        std::string name = names.empty() ? "" : names.back().substr(0, shared);
+        name.append(begin, element.value_end());
+        names.push_back(name);
+      }
+      else if (element.type() == query::tlv::Cursor) {
+        cursor = ndn::readString(element);
+      }
+      else if (element.type() == query::tlv::Total) {
+        total = ndn::readNonNegativeInteger(element);
+      }
+    }
+    BOOST_CHECK(std::equal(names.begin(), names.end(), queryAdapterTest3.catalogNames.begin()));
+    BOOST_CHECK_EQUAL(names.size(), 10);
+    BOOST_CHECK_EQUAL(cursor, names.back());
+    BOOST_CHECK_EQUAL(total, 25);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryAdapterLinkMtuTest)
+  {
+    initializeQueryAdapterTest3("linkMtu 1500");
+    BOOST_CHECK_LT(queryAdapterTest3.getSegmentPayloadLimit(), 1500);
+    for (int i = 0; i < 1000; ++i) {
+      std::stringstream name;
+      name << "/ndn/test/\"quoted\"/" << std::setw(4) << std::setfill('0') << i;
+      queryAdapterTest3.catalogNames.push_back(name.str());
+    }
+
+    Json::Value query;
+    query["activity"] = "testActivity";
+    Json::FastWriter fastWriter;
+    std::string jsonMessage = fastWriter.write(query);
+    jsonMessage.erase(std::remove(jsonMessage.begin(), jsonMessage.end(), '\n'), jsonMessage.end());
+    std::shared_ptr<ndn::Interest> queryInterest
+      = std::make_shared<ndn::Interest>(ndn::Name("/test/query").append(jsonMessage.c_str()));
+    queryAdapterTest3.queryTest(queryInterest);
+    advanceClocks(ndn::time::milliseconds(10));
+    auto ackData = queryAdapterTest3.getDataFromActiveQuery(jsonMessage);
+    BOOST_REQUIRE(ackData);
+    ndn::Name segmentPrefix("/test/query-results");
+    segmentPrefix.append(ackData->getName()[3]);
+
+    // segments fit into the MTU, and are as full as the names allow
+    size_t nNames = 0;
+    bool isFinal = false;
+    for (uint64_t segmentNo = 0; !isFinal && segmentNo < 100; ++segmentNo) {
+      ndn::Interest interest(ndn::Name(segmentPrefix).appendSegment(segmentNo));
+      face->sentDatas.clear();
+      queryAdapterTest3.resultsTest(interest);
+      advanceClocks(ndn::time::milliseconds(10));
+      BOOST_REQUIRE_EQUAL(face->sentDatas.size(), 1);
+      const ndn::Data& data = face->sentDatas[0];
+      isFinal = data.getFinalBlockId() == ndn::Name::Component::fromSegment(segmentNo);
+
+      BOOST_CHECK_LE(data.wireEncode().size(), 1500);
+      BOOST_CHECK_LE(data.getContent().value_size(), queryAdapterTest3.getSegmentPayloadLimit());
+      if (!isFinal) {
+        // the next name with its quotes, escapes and separator would not have fit
+        BOOST_CHECK_GT(data.getContent().value_size() + 28,
+                       queryAdapterTest3.getSegmentPayloadLimit());
+      }
+
+      const std::string jsonRes(reinterpret_cast<const char*>(data.getContent().value()));
+      Json::Value parsedFromString;
+      Json::Reader reader;
+      BOOST_REQUIRE(reader.parse(jsonRes, parsedFromString));
+      nNames += parsedFromString["results"].size();
+    }
+    BOOST_CHECK(isFinal);
+    BOOST_CHECK_EQUAL(nNames, 1000);
+
+    util::ConfigSection invalidSection;
+    std::stringstream invalid;
+    invalid << "segmentSize 0";
+    boost::property_tree::read_info(invalid, invalidSection);
+    BOOST_CHECK_THROW(queryAdapterTest2.configAdapter(invalidSection, ndn::Name("/test")),
+                      util::CatalogAdapter::Error);
+
+    // payload of a whole packet leaves no room for the name and the signature
+    util::ConfigSection hugeSegmentSection;
+    std::stringstream hugeSegment;
+    hugeSegment << "segmentSize " << ndn::MAX_NDN_PACKET_SIZE;
+    boost::property_tree::read_info(hugeSegment, hugeSegmentSection);
+    BOOST_CHECK_THROW(queryAdapterTest2.configAdapter(hugeSegmentSection, ndn::Name("/test")),
+                      util::CatalogAdapter::Error);
+
+    // the name and the signature of a segment alone take more than that
+    util::ConfigSection tinyMtuSection;
+    std::stringstream tinyMtu;
+    tinyMtu << "linkMtu 100";
+    boost::property_tree::read_info(tinyMtu, tinyMtuSection);
+    BOOST_CHECK_THROW(queryAdapterTest2.configAdapter(tinyMtuSection, ndn::Name("/test")),
+                      util::CatalogAdapter::Error);
+  }
+
   BOOST_AUTO_TEST_SUITE_END()
 
 }//tests
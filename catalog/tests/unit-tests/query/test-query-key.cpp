@@ -0,0 +1,66 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/query-key.hpp"
+#include "boost-test.hpp"
+
+#include <json/reader.h>
+
+namespace atmos{
+namespace tests{
+
+  static query::QueryKey
+  makeKey(const std::string& jsonQuery)
+  {
+    Json::Value parsedFromString;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(jsonQuery, parsedFromString));
+    return query::QueryKey(parsedFromString);
+  }
+
+  BOOST_AUTO_TEST_SUITE(QueryKeyTestSuite)
+
+  BOOST_AUTO_TEST_CASE(QueryKeyCanonicalForm)
+  {
+    query::QueryKey key1 = makeKey("{\"model\":\"CCSM4\",\"modeling_realm\":\"atmos\"}");
+    query::QueryKey key2 = makeKey(" { \"modeling_realm\" : \"atmos\",\n \"model\" : \"CCSM4\" } ");
+    BOOST_CHECK(key1 == key2);
+    BOOST_CHECK_EQUAL(key1.getHash(), key2.getHash());
+    BOOST_CHECK_EQUAL(query::QueryKey::Hash()(key1), query::QueryKey::Hash()(key2));
+    BOOST_CHECK_EQUAL(key1.toString(), "{\"model\":\"CCSM4\",\"modeling_realm\":\"atmos\"}");
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryKeyNormalizedValues)
+  {
+    query::QueryKey key1 = makeKey("{\"ensemble\":1,\"time\":\"2015\"}");
+    query::QueryKey key2 = makeKey("{\"ensemble\":\"1\",\"time\":2015}");
+    BOOST_CHECK(key1 == key2);
+    BOOST_CHECK(key1.getQuery()["ensemble"].isString());
+    BOOST_CHECK_EQUAL(key1.getQuery()["time"].asString(), "2015");
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryKeyDifferentQueries)
+  {
+    BOOST_CHECK(makeKey("{\"model\":\"CCSM4\"}") != makeKey("{\"model\":\"CCSM3\"}"));
+    BOOST_CHECK(makeKey("{\"model\":\"CCSM4\"}") != makeKey("{\"?\":\"CCSM4\"}"));
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
@@ -0,0 +1,82 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/query-stats.hpp"
+#include "boost-test.hpp"
+
+#include <thread>
+
+namespace atmos{
+namespace tests{
+
+  BOOST_AUTO_TEST_SUITE(QueryStatsTestSuite)
+
+  BOOST_AUTO_TEST_CASE(QueryStatsStopwatch)
+  {
+    query::QueryStats stats;
+    {
+      query::QueryStats::Stopwatch parse(stats, query::QueryStats::STAGE_JSON_PARSE);
+      query::QueryStats::Stopwatch dedup(stats, query::QueryStats::STAGE_DEDUP, false);
+      query::QueryStats::Stopwatch unused(stats, query::QueryStats::STAGE_SIGN, false);
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      parse.handOver(dedup);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      dedup.stop();
+      // a stopped stopwatch does not count the time until it is destroyed
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    const util::LatencyHistogram& parse = stats.getHistogram(query::QueryStats::STAGE_JSON_PARSE);
+    BOOST_CHECK_EQUAL(parse.getCount(), 1);
+    BOOST_CHECK_GE(parse.getMax().count(), 2000);
+    const util::LatencyHistogram& dedup = stats.getHistogram(query::QueryStats::STAGE_DEDUP);
+    BOOST_CHECK_EQUAL(dedup.getCount(), 1);
+    BOOST_CHECK_GE(dedup.getMax().count(), 1000);
+    BOOST_CHECK_LT(dedup.getMax().count(), 5000);
+    // a stopwatch that never ran records nothing
+    BOOST_CHECK_EQUAL(stats.getHistogram(query::QueryStats::STAGE_SIGN).getCount(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(QueryStatsToJson)
+  {
+    query::QueryStats stats;
+    stats.increment(query::QueryStats::COUNTER_QUERIES);
+    stats.increment(query::QueryStats::COUNTER_QUERIES);
+    stats.increment(query::QueryStats::COUNTER_COALESCED);
+    stats.record(query::QueryStats::STAGE_DB_EXECUTE, std::chrono::microseconds(100));
+    stats.record(query::QueryStats::STAGE_DB_EXECUTE, std::chrono::microseconds(300));
+
+    Json::Value json = stats.toJson();
+    BOOST_CHECK(json.isMember("uptime"));
+    BOOST_CHECK_EQUAL(json["counters"]["queries"].asUInt64(), 2);
+    BOOST_CHECK_EQUAL(json["counters"]["coalesced"].asUInt64(), 1);
+    BOOST_CHECK_EQUAL(json["counters"]["failures"].asUInt64(), 0);
+
+    BOOST_CHECK_EQUAL(json["stages"].size(), query::QueryStats::N_STAGES);
+    const Json::Value& execute = json["stages"]["dbExecute"];
+    BOOST_CHECK_EQUAL(execute["count"].asUInt64(), 2);
+    BOOST_CHECK_EQUAL(execute["mean"].asUInt64(), 200);
+    BOOST_CHECK_EQUAL(execute["max"].asUInt64(), 300);
+    BOOST_CHECK_LE(execute["p50"].asUInt64(), 100 * 1.125);
+    BOOST_CHECK_EQUAL(execute["p99"].asUInt64(), 300);
+    BOOST_CHECK_EQUAL(json["stages"]["sign"]["count"].asUInt64(), 0);
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
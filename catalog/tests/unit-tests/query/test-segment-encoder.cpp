@@ -0,0 +1,351 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query/segment-encoder.hpp"
+#include "boost-test.hpp"
+
+#include <json/reader.h>
+#include <json/value.h>
+#include <json/writer.h>
+
+#include <ndn-cxx/encoding/tlv.hpp>
+
+#include <zlib.h>
+
+namespace atmos{
+namespace tests{
+
+  // the payload makeReplyData used to write with a Json::Value
+  static std::string
+  writeWithJsonValue(const std::vector<std::string>& names, bool isAutocomplete)
+  {
+    Json::Value array(Json::arrayValue);
+    for (const auto& name : names) {
+      array.append(name);
+    }
+    Json::Value entry;
+    entry[isAutocomplete ? "next" : "results"] = array;
+    Json::FastWriter fastWriter;
+    const std::string jsonMessage = fastWriter.write(entry);
+    return std::string(jsonMessage.c_str(), jsonMessage.size() + 1);
+  }
+
+  static std::string
+  writeWithEncoder(query::SegmentEncoder& encoder, const std::vector<std::string>& names)
+  {
+    for (const auto& name : names) {
+      encoder.append(name);
+    }
+    const size_t payloadSize = encoder.getPayloadSize();
+    ndn::Block content = encoder.finish();
+    BOOST_CHECK_EQUAL(content.type(), ndn::tlv::Content);
+    BOOST_CHECK_EQUAL(content.value_size(), payloadSize);
+    return std::string(reinterpret_cast<const char*>(content.value()), content.value_size());
+  }
+
+  // names of a binary payload, front coding undone, and what follows them
+  static void
+  readBinary(const ndn::Block& content, uint32_t entryType,
+             std::vector<std::string>& names, std::string& cursor, uint64_t& total)
+  {
+    const uint8_t* begin = content.value();
+    const uint8_t* end = begin + content.value_size();
+    std::string name;
+    while (begin != end) {
+      const uint64_t type = ndn::tlv::readVarNumber(begin, end);
+      const uint64_t length = ndn::tlv::readVarNumber(begin, end);
+      const uint8_t* valueEnd = begin + length;
+      if (type == entryType) {
+        const uint64_t shared = ndn::tlv::readVarNumber(begin, valueEnd);
+        BOOST_REQUIRE_LE(shared, name.size());
+        name.resize(shared);
+        name.append(begin, valueEnd);
+        names.push_back(name);
+      }
+      else if (type == query::tlv::Cursor) {
+        cursor.assign(begin, valueEnd);
+      }
+      else if (type == query::tlv::Total) {
+        total = ndn::tlv::readNonNegativeInteger(length, begin, valueEnd);
+      }
+      else {
+        BOOST_ERROR("unexpected TLV type " << type);
+      }
+      begin = valueEnd;
+    }
+  }
+
+  BOOST_AUTO_TEST_SUITE(SegmentEncoderTestSuite)
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderSameAsJsonValue)
+  {
+    std::vector<std::string> names;
+    names.push_back("/ndn/test1");
+    names.push_back("/ndn/test2");
+    names.push_back("/CMIP5/output/MOHC/HadCM3/decadal1990/day/atmos/tasmax/r3i2p1");
+
+    query::SegmentEncoder resultsEncoder(false);
+    BOOST_CHECK_EQUAL(writeWithEncoder(resultsEncoder, names), writeWithJsonValue(names, false));
+
+    query::SegmentEncoder nextEncoder(true);
+    BOOST_CHECK_EQUAL(writeWithEncoder(nextEncoder, names), writeWithJsonValue(names, true));
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderEscaping)
+  {
+    std::vector<std::string> names;
+    names.push_back("/ndn/\"quoted\"");
+    names.push_back("/ndn/back\\slash");
+    names.push_back("/ndn/tab\tnewline\ncr\rbs\bff\f");
+    names.push_back("/ndn/control\x01\x1f");
+
+    query::SegmentEncoder encoder(false);
+    BOOST_CHECK_EQUAL(writeWithEncoder(encoder, names), writeWithJsonValue(names, false));
+
+    for (const auto& name : names) {
+      BOOST_CHECK_EQUAL(query::SegmentEncoder::getEncodedSize(name.data(), name.size()),
+                        Json::valueToQuotedString(name.c_str()).size());
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderUtf8)
+  {
+    // UTF-8 is valid in JSON strings, so it is not escaped
+    const std::string name("/ndn/utf8/\xc3\xa9t\xc3\xa9");
+    query::SegmentEncoder encoder(true);
+    encoder.append(name);
+    const std::string payload = writeWithEncoder(encoder, std::vector<std::string>());
+    BOOST_CHECK_EQUAL(payload, "{\"next\":[\"" + name + "\"]}\n" + std::string(1, '\0'));
+    BOOST_CHECK_EQUAL(query::SegmentEncoder::getEncodedSize(name.data(), name.size()),
+                      name.size() + 2);
+
+    Json::Value parsedFromString;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(payload.c_str(), parsedFromString));
+    BOOST_CHECK_EQUAL(parsedFromString["next"][0].asString(), name);
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderSegments)
+  {
+    query::SegmentEncoder encoder(false, 16);
+    BOOST_CHECK(encoder.empty());
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; ++i) {
+      names.push_back("/ndn/test/" + std::to_string(i));
+    }
+    // grows past the reserved room
+    BOOST_CHECK_EQUAL(writeWithEncoder(encoder, names), writeWithJsonValue(names, false));
+
+    // the next segment starts empty
+    BOOST_CHECK_EQUAL(encoder.size(), 0);
+    names.resize(1);
+    BOOST_CHECK_EQUAL(writeWithEncoder(encoder, names), writeWithJsonValue(names, false));
+    BOOST_CHECK_EQUAL(writeWithEncoder(encoder, std::vector<std::string>()),
+                      writeWithJsonValue(std::vector<std::string>(), false));
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderPageInfo)
+  {
+    std::vector<std::string> names;
+    names.push_back("/ndn/test1");
+    names.push_back("/ndn/test2");
+
+    Json::Value pageInfo;
+    pageInfo["cursor"] = "/ndn/\"test2\"";
+    pageInfo["total"] = 876342;
+    query::SegmentEncoder encoder(false);
+    encoder.setPageInfo(pageInfo);
+    const std::string payload = writeWithEncoder(encoder, names);
+
+    Json::Value parsedFromString;
+    Json::Reader reader;
+    BOOST_REQUIRE(reader.parse(payload.c_str(), parsedFromString));
+    BOOST_CHECK_EQUAL(parsedFromString["results"].size(), 2);
+    BOOST_CHECK_EQUAL(parsedFromString["cursor"].asString(), "/ndn/\"test2\"");
+    BOOST_CHECK_EQUAL(parsedFromString["total"].asUInt(), 876342);
+
+    // only the segment it was set for has it
+    BOOST_CHECK_EQUAL(writeWithEncoder(encoder, names), writeWithJsonValue(names, false));
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderCompressed)
+  {
+    query::ResultFormat format;
+    format.isCompressed = true;
+    const size_t payloadLimit = 1000;
+    query::SegmentEncoder encoder(false, payloadLimit, format);
+
+    // names that share most of their components, the way catalog names do
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; ++i) {
+      names.push_back("/CMIP5/output1/MOHC/HadCM3/decadal" + std::to_string(1960 + i % 50) +
+                      "/day/atmos/tasmax/r" + std::to_string(i % 10) + "i2p1/" +
+                      std::to_string(i));
+    }
+
+    std::vector<std::string> segmentNames;
+    size_t nSegments = 0;
+    for (size_t i = 0; i <= names.size(); ++i) {
+      const bool isLast = i == names.size();
+      if (!isLast) {
+        const size_t size = encoder.getAppendedSize(names[i]);
+        if (encoder.empty() || encoder.getPayloadSize() + size <= payloadLimit) {
+          encoder.append(names[i]);
+          segmentNames.push_back(names[i]);
+          continue;
+        }
+      }
+
+      const size_t payloadSize = encoder.getPayloadSize();
+      ndn::Block content = encoder.finish();
+      BOOST_CHECK_LE(content.value_size(), payloadSize);
+      BOOST_CHECK_LE(content.value_size(), payloadLimit);
+
+      // every segment is a zlib stream of its own, of the same JSON as without compression
+      std::vector<uint8_t> payload(64 * payloadLimit);
+      uLongf payloadLength = payload.size();
+      BOOST_REQUIRE_EQUAL(uncompress(payload.data(), &payloadLength,
+                                     content.value(), content.value_size()), Z_OK);
+      BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(payload.data()), payloadLength),
+                        writeWithJsonValue(segmentNames, false));
+      ++nSegments;
+      segmentNames.clear();
+      if (!isLast) {
+        --i;
+      }
+    }
+    // uncompressed, a segment holds fewer than 13 of these names
+    BOOST_CHECK_LT(nSegments, names.size() / 13 / 3);
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderIncompressible)
+  {
+    // names that deflate cannot shrink are stored, which takes more room than they do
+    std::vector<std::string> names;
+    uint32_t random = 12345;
+    for (int i = 0; i < 2000; ++i) {
+      std::string name = "/";
+      for (int j = 0; j < 20 + i % 100; ++j) {
+        random = random * 1103515245 + 12345;
+        name += static_cast<char>(0x80 | (random >> 16));
+      }
+      names.push_back(name);
+    }
+
+    for (bool isBinary : {false, true}) {
+      query::ResultFormat format;
+      format.isCompressed = true;
+      format.isBinary = isBinary;
+      const size_t payloadLimit = 1000;
+      query::SegmentEncoder encoder(false, payloadLimit, format);
+
+      size_t nSegments = 0;
+      for (size_t i = 0; i <= names.size(); ++i) {
+        const bool isLast = i == names.size();
+        if (!isLast) {
+          const size_t size = encoder.getAppendedSize(names[i]);
+          const size_t payloadSize = encoder.getPayloadSize();
+          if (encoder.empty() || payloadSize + size <= payloadLimit) {
+            encoder.append(names[i]);
+            BOOST_CHECK_LE(encoder.getPayloadSize(), payloadSize + size);
+            continue;
+          }
+        }
+
+        // segments are filled up to the limit, and never past it
+        const size_t payloadSize = encoder.getPayloadSize();
+        ndn::Block content = encoder.finish();
+        BOOST_CHECK_LE(content.value_size(), payloadSize);
+        BOOST_CHECK_LE(content.value_size(), payloadLimit);
+        if (!isLast) {
+          BOOST_CHECK_GT(content.value_size(), payloadLimit / 2);
+        }
+
+        std::vector<uint8_t> payload(2 * payloadLimit);
+        uLongf payloadLength = payload.size();
+        BOOST_CHECK_EQUAL(uncompress(payload.data(), &payloadLength,
+                                     content.value(), content.value_size()), Z_OK);
+        ++nSegments;
+        if (!isLast) {
+          --i;
+        }
+      }
+      BOOST_CHECK_GT(nSegments, 1);
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentEncoderBinary)
+  {
+    std::vector<std::string> names;
+    names.push_back("/CMIP5/output1/MOHC/HadCM3/decadal1990/day/atmos/tasmax/r3i2p1");
+    names.push_back("/CMIP5/output1/MOHC/HadCM3/decadal1990/day/atmos/tasmax/r3i2p2");
+    names.push_back("/CMIP5/output1/MOHC/HadCM3/decadal1991/day/atmos/tasmin/r1i1p1");
+    names.push_back("/CMIP5/output1/MOHC/HadCM3/decadal1991/day/atmos/tasmin/r1i1p1/" +
+                    std::string(300, 'x'));
+    names.push_back("/ndn/\"quoted\"");
+    names.push_back("");
+
+    query::ResultFormat format;
+    format.isBinary = true;
+    query::SegmentEncoder encoder(false, 8192, format);
+    for (const auto& name : names) {
+      const size_t payloadSize = encoder.getPayloadSize();
+      const size_t size = encoder.getAppendedSize(name);
+      encoder.append(name);
+      BOOST_CHECK_EQUAL(encoder.getPayloadSize(), payloadSize + size);
+    }
+    Json::Value pageInfo;
+    pageInfo["cursor"] = names[2];
+    pageInfo["total"] = Json::Value::UInt64(70000);
+    encoder.setPageInfo(pageInfo);
+    const size_t payloadSize = encoder.getPayloadSize();
+    ndn::Block content = encoder.finish();
+    BOOST_CHECK_EQUAL(content.value_size(), payloadSize);
+
+    std::vector<std::string> decodedNames;
+    std::string cursor;
+    uint64_t total = 0;
+    readBinary(content, query::tlv::ResultName, decodedNames, cursor, total);
+    BOOST_CHECK_EQUAL_COLLECTIONS(decodedNames.begin(), decodedNames.end(),
+                                  names.begin(), names.end());
+    BOOST_CHECK_EQUAL(cursor, names[2]);
+    BOOST_CHECK_EQUAL(total, 70000);
+    // shared prefixes are written once
+    BOOST_CHECK_LT(content.value_size(), writeWithJsonValue(names, false).size());
+
+    // the next segment shares nothing with this one
+    encoder.append(names[1]);
+    decodedNames.clear();
+    readBinary(encoder.finish(), query::tlv::ResultName, decodedNames, cursor, total);
+    BOOST_REQUIRE_EQUAL(decodedNames.size(), 1);
+    BOOST_CHECK_EQUAL(decodedNames[0], names[1]);
+
+    query::SegmentEncoder nextEncoder(true, 8192, format);
+    nextEncoder.append("/CMIP5");
+    nextEncoder.append("/CMIP6");
+    decodedNames.clear();
+    readBinary(nextEncoder.finish(), query::tlv::NextComponent, decodedNames, cursor, total);
+    BOOST_REQUIRE_EQUAL(decodedNames.size(), 2);
+    BOOST_CHECK_EQUAL(decodedNames[1], "/CMIP6");
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
@@ -0,0 +1,206 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/facet-index.hpp"
+#include "boost-test.hpp"
+
+namespace atmos{
+namespace tests{
+
+  class FacetIndexFixture
+  {
+  protected:
+    FacetIndexFixture()
+      : index(makeColumns())
+    {
+    }
+
+    static std::vector<std::string>
+    makeColumns()
+    {
+      std::vector<std::string> columns;
+      columns.push_back("model");
+      columns.push_back("experiment");
+      return columns;
+    }
+
+    void
+    insert(const std::string& name, const std::string& model, const std::string& experiment)
+    {
+      std::vector<std::string> values;
+      values.push_back(model);
+      values.push_back(experiment);
+      index.insert(name, values);
+    }
+
+    static util::FacetIndex::ConditionList
+    makeConditions(const std::string& model, const std::string& experiment)
+    {
+      util::FacetIndex::ConditionList conditions;
+      if (!model.empty()) {
+        conditions.push_back(std::make_pair("model", model));
+      }
+      if (!experiment.empty()) {
+        conditions.push_back(std::make_pair("experiment", experiment));
+      }
+      return conditions;
+    }
+
+  protected:
+    util::FacetIndex index;
+  };
+
+  BOOST_FIXTURE_TEST_SUITE(FacetIndexTestSuite, FacetIndexFixture)
+
+  BOOST_AUTO_TEST_CASE(FacetIndexFind)
+  {
+    const uint64_t token = index.startLoading();
+    insert("/CMIP5/a", "HadCM3", "decadal1990");
+    insert("/CMIP5/b", "HadCM3", "decadal2000");
+    insert("/CMIP5/c", "GISS", "decadal1990");
+    insert("/CMIP5/d", "HadCM3", "decadal1990");
+
+    std::vector<std::string> names;
+    // not usable before it is loaded
+    BOOST_CHECK(!index.find(makeConditions("HadCM3", ""), names));
+    index.markLoaded(token);
+    BOOST_CHECK(index.isLoaded());
+    BOOST_CHECK_EQUAL(index.size(), 4);
+
+    BOOST_CHECK(index.find(makeConditions("HadCM3", "decadal1990"), names));
+    std::vector<std::string> expected;
+    expected.push_back("/CMIP5/a");
+    expected.push_back("/CMIP5/d");
+    BOOST_CHECK(names == expected);
+
+    names.clear();
+    BOOST_CHECK(index.find(makeConditions("GISS", "decadal2000"), names));
+    BOOST_CHECK(names.empty());
+    BOOST_CHECK(index.find(makeConditions("CCSM4", ""), names));
+    BOOST_CHECK(names.empty());
+
+    // columns that are not indexed are left to the database
+    util::FacetIndex::ConditionList conditions = makeConditions("HadCM3", "");
+    conditions.push_back(std::make_pair("name", "/CMIP5/a"));
+    BOOST_CHECK(!index.canAnswer(conditions));
+    BOOST_CHECK(!index.find(conditions, names));
+    BOOST_CHECK(!index.canAnswer(util::FacetIndex::ConditionList()));
+  }
+
+  BOOST_AUTO_TEST_CASE(FacetIndexUpdate)
+  {
+    const uint64_t token = index.startLoading();
+    insert("/CMIP5/a", "HadCM3", "decadal1990");
+    insert("/CMIP5/b", "HadCM3", "decadal2000");
+    index.markLoaded(token);
+
+    // replaced facets and removed names are not found anymore
+    insert("/CMIP5/a", "GISS", "decadal1990");
+    index.erase("/CMIP5/b");
+    BOOST_CHECK_EQUAL(index.size(), 1);
+    std::vector<std::string> names;
+    BOOST_CHECK(index.find(makeConditions("HadCM3", ""), names));
+    BOOST_CHECK(names.empty());
+    BOOST_CHECK(index.find(makeConditions("GISS", ""), names));
+    BOOST_REQUIRE_EQUAL(names.size(), 1);
+    BOOST_CHECK_EQUAL(names[0], "/CMIP5/a");
+
+    // a name published without its facets makes the index stale, even during a reload
+    index.invalidate();
+    BOOST_CHECK(!index.isLoaded());
+    const uint64_t reloadToken = index.startLoading();
+    index.invalidate();
+    index.markLoaded(reloadToken);
+    BOOST_CHECK(!index.isLoaded());
+    index.markLoaded(index.startLoading());
+    BOOST_CHECK(index.isLoaded());
+    BOOST_CHECK_EQUAL(index.size(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(FacetIndexCountValues)
+  {
+    const uint64_t token = index.startLoading();
+    insert("/CMIP5/a", "HadCM3", "decadal1990");
+    insert("/CMIP5/b", "HadCM3", "decadal2000");
+    insert("/CMIP5/c", "GISS", "decadal1990");
+    insert("/CMIP5/d", "HadCM3", "decadal1990");
+    index.erase("/CMIP5/d");
+
+    util::FacetIndex::FacetCounts counts;
+    BOOST_CHECK(!index.countValues(util::FacetIndex::ConditionList(), counts));
+    index.markLoaded(token);
+
+    BOOST_CHECK(index.countValues(util::FacetIndex::ConditionList(), counts));
+    BOOST_CHECK_EQUAL(counts.size(), 2);
+    BOOST_CHECK_EQUAL(counts["model"]["HadCM3"], 2);
+    BOOST_CHECK_EQUAL(counts["model"]["GISS"], 1);
+    BOOST_CHECK_EQUAL(counts["experiment"]["decadal1990"], 2);
+    BOOST_CHECK_EQUAL(counts["experiment"]["decadal2000"], 1);
+
+    // only the columns without a condition, and only values that are left
+    counts.clear();
+    BOOST_CHECK(index.countValues(makeConditions("", "decadal2000"), counts));
+    BOOST_CHECK_EQUAL(counts.size(), 1);
+    BOOST_CHECK_EQUAL(counts["model"].size(), 1);
+    BOOST_CHECK_EQUAL(counts["model"]["HadCM3"], 1);
+
+    counts.clear();
+    util::FacetIndex::ConditionList conditions;
+    conditions.push_back(std::make_pair("name", "/CMIP5/a"));
+    BOOST_CHECK(!index.countValues(conditions, counts));
+  }
+
+  BOOST_AUTO_TEST_CASE(FacetIndexCaseInsensitive)
+  {
+    // like a "_ci" collation, case and trailing spaces do not tell values apart
+    const uint64_t token = index.startLoading(true);
+    insert("/CMIP5/a", "HadCM3", "decadal1990");
+    insert("/CMIP5/b", "hadcm3 ", "decadal2000");
+    insert("/CMIP5/c", "GISS", "Decadal1990");
+    index.markLoaded(token);
+
+    std::vector<std::string> names;
+    BOOST_CHECK(index.find(makeConditions("HADCM3", ""), names));
+    BOOST_CHECK_EQUAL(names.size(), 2);
+    names.clear();
+    BOOST_CHECK(index.find(makeConditions("", "decadal1990  "), names));
+    BOOST_CHECK_EQUAL(names.size(), 2);
+    names.clear();
+    BOOST_CHECK(index.find(makeConditions(" HadCM3", ""), names));
+    BOOST_CHECK(names.empty());
+
+    // values are counted as they were first added
+    util::FacetIndex::FacetCounts counts;
+    BOOST_CHECK(index.countValues(util::FacetIndex::ConditionList(), counts));
+    BOOST_CHECK_EQUAL(counts["model"].size(), 2);
+    BOOST_CHECK_EQUAL(counts["model"]["HadCM3"], 2);
+    BOOST_CHECK_EQUAL(counts["experiment"]["decadal1990"], 2);
+
+    // a binary collation compares them byte for byte
+    const uint64_t binaryToken = index.startLoading(false);
+    insert("/CMIP5/a", "HadCM3", "decadal1990");
+    index.markLoaded(binaryToken);
+    names.clear();
+    BOOST_CHECK(index.find(makeConditions("hadcm3", ""), names));
+    BOOST_CHECK(names.empty());
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
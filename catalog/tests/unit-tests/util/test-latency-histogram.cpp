@@ -0,0 +1,97 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/latency-histogram.hpp"
+#include "boost-test.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace atmos{
+namespace tests{
+
+  BOOST_AUTO_TEST_SUITE(LatencyHistogramTestSuite)
+
+  BOOST_AUTO_TEST_CASE(LatencyHistogramEmpty)
+  {
+    util::LatencyHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.getCount(), 0);
+    BOOST_CHECK_EQUAL(histogram.getPercentile(0.99).count(), 0);
+    BOOST_CHECK_EQUAL(histogram.getMax().count(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(LatencyHistogramPercentiles)
+  {
+    util::LatencyHistogram histogram;
+    for (int i = 1; i <= 1000; ++i) {
+      histogram.record(std::chrono::microseconds(i));
+    }
+    BOOST_CHECK_EQUAL(histogram.getCount(), 1000);
+    BOOST_CHECK_EQUAL(histogram.getTotal().count(), 500500);
+    BOOST_CHECK_EQUAL(histogram.getMax().count(), 1000);
+
+    // percentiles are bucket bounds, at most 12.5% above the latency they stand for
+    const int64_t p50 = histogram.getPercentile(0.5).count();
+    BOOST_CHECK_GE(p50, 500);
+    BOOST_CHECK_LE(p50, 500 * 1.125);
+    const int64_t p99 = histogram.getPercentile(0.99).count();
+    BOOST_CHECK_GE(p99, 990);
+    BOOST_CHECK_LE(p99, 1000);
+    BOOST_CHECK_EQUAL(histogram.getPercentile(1).count(), 1000);
+  }
+
+  BOOST_AUTO_TEST_CASE(LatencyHistogramSmallAndLargeLatencies)
+  {
+    util::LatencyHistogram histogram;
+    histogram.record(std::chrono::microseconds(3));
+    BOOST_CHECK_EQUAL(histogram.getPercentile(0.5).count(), 3);
+
+    // an hour still lands in a bucket of its own size
+    histogram.record(std::chrono::hours(1));
+    const int64_t max = std::chrono::microseconds(std::chrono::hours(1)).count();
+    BOOST_CHECK_EQUAL(histogram.getMax().count(), max);
+    BOOST_CHECK_EQUAL(histogram.getPercentile(0.99).count(), max);
+    BOOST_CHECK_EQUAL(histogram.getPercentile(0.01).count(), 3);
+
+    // negative latencies, e.g. from an adjusted clock, count as 0
+    histogram.record(std::chrono::microseconds(-5));
+    BOOST_CHECK_EQUAL(histogram.getPercentile(0.01).count(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(LatencyHistogramConcurrentRecording)
+  {
+    util::LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&histogram, i] {
+        for (int j = 0; j < 10000; ++j) {
+          histogram.record(std::chrono::microseconds(i * 100 + j % 100));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    BOOST_CHECK_EQUAL(histogram.getCount(), 40000);
+    BOOST_CHECK_EQUAL(histogram.getMax().count(), 399);
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
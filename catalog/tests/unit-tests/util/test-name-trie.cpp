@@ -0,0 +1,132 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/name-trie.hpp"
+#include "boost-test.hpp"
+
+namespace atmos{
+namespace tests{
+
+  BOOST_AUTO_TEST_SUITE(NameTrieTestSuite)
+
+  BOOST_AUTO_TEST_CASE(NameTrieInsertErase)
+  {
+    util::NameTrie trie;
+    BOOST_CHECK(trie.insert("/CMIP5/output1/MOHC"));
+    BOOST_CHECK(trie.insert("/CMIP5/output1/MOHC/HadCM3"));
+    BOOST_CHECK(trie.insert("/CMIP5/output2/NASA"));
+    BOOST_CHECK(!trie.insert("/CMIP5/output1/MOHC"));
+    BOOST_CHECK_EQUAL(trie.size(), 3);
+
+    BOOST_CHECK(trie.contains("/CMIP5/output1/MOHC"));
+    BOOST_CHECK(!trie.contains("/CMIP5/output1/MO"));
+    BOOST_CHECK(!trie.contains("/CMIP5/output"));
+
+    BOOST_CHECK(trie.erase("/CMIP5/output1/MOHC"));
+    BOOST_CHECK(!trie.erase("/CMIP5/output1/MOHC"));
+    BOOST_CHECK(!trie.erase("/CMIP5/output1"));
+    BOOST_CHECK_EQUAL(trie.size(), 2);
+    BOOST_CHECK(!trie.contains("/CMIP5/output1/MOHC"));
+    BOOST_CHECK(trie.contains("/CMIP5/output1/MOHC/HadCM3"));
+
+    BOOST_CHECK(trie.erase("/CMIP5/output1/MOHC/HadCM3"));
+    BOOST_CHECK(trie.erase("/CMIP5/output2/NASA"));
+    BOOST_CHECK_EQUAL(trie.size(), 0);
+    BOOST_CHECK(trie.findNextComponents("").empty());
+
+    // the trie is still usable once the edges have been split and merged again
+    BOOST_CHECK(trie.insert("/CMIP5/output2/NASA"));
+    BOOST_CHECK(trie.contains("/CMIP5/output2/NASA"));
+    BOOST_CHECK_EQUAL(trie.size(), 1);
+  }
+
+  BOOST_AUTO_TEST_CASE(NameTrieNextComponents)
+  {
+    util::NameTrie trie;
+    trie.insert("/CMIP5/output1/MOHC/HadCM3/decadal1990");
+    trie.insert("/CMIP5/output1/MOHC/HadCM3/decadal2000");
+    trie.insert("/CMIP5/output1/NASA/GISS");
+    trie.insert("/CMIP5/output2/MOHC/HadCM3");
+    trie.insert("/CMIP5/out");
+    trie.insert("/other");
+
+    std::vector<std::string> expected;
+    expected.push_back("/CMIP5/output1/");
+    expected.push_back("/CMIP5/output2/");
+    // "/CMIP5/out" itself is a name, but no completion of it
+    BOOST_CHECK(trie.findNextComponents("/CMIP5/out") == expected);
+
+    expected.clear();
+    expected.push_back("/CMIP5/output1/MOHC/");
+    expected.push_back("/CMIP5/output1/NASA/");
+    BOOST_CHECK(trie.findNextComponents("/CMIP5/output1/") == expected);
+    BOOST_CHECK(trie.findNextComponents("/CMIP5/output1") == expected);
+
+    expected.clear();
+    expected.push_back("/CMIP5/output1/NASA/GISS");
+    BOOST_CHECK(trie.findNextComponents("/CMIP5/output1/NASA/") == expected);
+
+    expected.clear();
+    expected.push_back("/CMIP5/");
+    expected.push_back("/other");
+    BOOST_CHECK(trie.findNextComponents("") == expected);
+    BOOST_CHECK(trie.findNextComponents("/") == expected);
+
+    BOOST_CHECK_EQUAL(trie.findNextComponents("/CMIP5/output1/", 1).size(), 1);
+    BOOST_CHECK(trie.findNextComponents("/CMIP6").empty());
+    BOOST_CHECK(trie.findNextComponents("/CMIP5/output1/NASA/GISS").empty());
+  }
+
+  BOOST_AUTO_TEST_CASE(NameTrieTopNextComponents)
+  {
+    util::NameTrie trie;
+    for (int i = 0; i < 5; ++i) {
+      trie.insert("/CMIP5/output1/MOHC/" + std::to_string(i));
+    }
+    for (int i = 0; i < 3; ++i) {
+      trie.insert("/CMIP5/output1/NASA/" + std::to_string(i));
+      trie.insert("/CMIP5/output1/NCAR/" + std::to_string(i));
+    }
+    trie.insert("/CMIP5/output1/IPSL/0");
+    trie.insert("/CMIP5/output1/BCC");
+
+    std::vector<std::string> expected;
+    expected.push_back("/CMIP5/output1/MOHC/");
+    expected.push_back("/CMIP5/output1/NASA/");
+    expected.push_back("/CMIP5/output1/NCAR/");
+    BOOST_CHECK(trie.findTopNextComponents("/CMIP5/output1/", 3) == expected);
+
+    expected.resize(2);
+    BOOST_CHECK(trie.findTopNextComponents("/CMIP5/output1/", 2) == expected);
+
+    expected.clear();
+    expected.push_back("/CMIP5/output1/MOHC/");
+    expected.push_back("/CMIP5/output1/NASA/");
+    expected.push_back("/CMIP5/output1/NCAR/");
+    expected.push_back("/CMIP5/output1/BCC");
+    expected.push_back("/CMIP5/output1/IPSL/");
+    BOOST_CHECK(trie.findTopNextComponents("/CMIP5/output1/", 10) == expected);
+
+    BOOST_CHECK(trie.findTopNextComponents("/CMIP5/output1/", 0).empty());
+    BOOST_CHECK(trie.findTopNextComponents("/CMIP6/", 3).empty());
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
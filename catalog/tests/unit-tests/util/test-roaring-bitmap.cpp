@@ -0,0 +1,147 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/roaring-bitmap.hpp"
+#include "boost-test.hpp"
+
+namespace atmos{
+namespace tests{
+
+  BOOST_AUTO_TEST_SUITE(RoaringBitmapTestSuite)
+
+  BOOST_AUTO_TEST_CASE(RoaringBitmapAddRemove)
+  {
+    util::RoaringBitmap bitmap;
+    BOOST_CHECK(bitmap.empty());
+    bitmap.add(3);
+    bitmap.add(70000);
+    bitmap.add(3);
+    bitmap.add(1);
+    BOOST_CHECK_EQUAL(bitmap.cardinality(), 3);
+    BOOST_CHECK(bitmap.contains(70000));
+    BOOST_CHECK(!bitmap.contains(4));
+
+    std::vector<uint32_t> expected;
+    expected.push_back(1);
+    expected.push_back(3);
+    expected.push_back(70000);
+    BOOST_CHECK(bitmap.toVector() == expected);
+
+    bitmap.remove(70000);
+    bitmap.remove(5);
+    BOOST_CHECK_EQUAL(bitmap.cardinality(), 2);
+    BOOST_CHECK(!bitmap.contains(70000));
+  }
+
+  BOOST_AUTO_TEST_CASE(RoaringBitmapDenseChunk)
+  {
+    // enough members in one chunk to turn it into a bitset, and back again
+    util::RoaringBitmap bitmap;
+    for (uint32_t i = 0; i < 10000; ++i) {
+      bitmap.add(i * 2);
+    }
+    BOOST_CHECK_EQUAL(bitmap.cardinality(), 10000);
+    BOOST_CHECK(bitmap.contains(19998));
+    BOOST_CHECK(!bitmap.contains(19999));
+    BOOST_CHECK_LT(bitmap.getMemoryUsage(), 10000 * sizeof(uint16_t));
+
+    for (uint32_t i = 0; i < 9000; ++i) {
+      bitmap.remove(i * 2);
+    }
+    BOOST_CHECK_EQUAL(bitmap.cardinality(), 1000);
+    BOOST_CHECK(bitmap.contains(18000));
+    BOOST_CHECK(!bitmap.contains(0));
+    BOOST_CHECK_EQUAL(bitmap.toVector().front(), 18000);
+  }
+
+  BOOST_AUTO_TEST_CASE(RoaringBitmapIntersection)
+  {
+    util::RoaringBitmap evens, threes, sparse;
+    for (uint32_t i = 0; i < 200000; ++i) {
+      if (i % 2 == 0) {
+        evens.add(i);
+      }
+      if (i % 3 == 0) {
+        threes.add(i);
+      }
+    }
+    sparse.add(6);
+    sparse.add(7);
+    sparse.add(150000);
+    sparse.add(300000);
+
+    // bitset and bitset
+    util::RoaringBitmap sixes = evens;
+    sixes &= threes;
+    BOOST_CHECK_EQUAL(sixes.cardinality(), 200000 / 6 + 1);
+    BOOST_CHECK(sixes.contains(199998));
+    BOOST_CHECK(!sixes.contains(199999));
+
+    // bitset and array, either way around
+    util::RoaringBitmap result = sixes;
+    result &= sparse;
+    std::vector<uint32_t> expected;
+    expected.push_back(6);
+    expected.push_back(150000);
+    BOOST_CHECK(result.toVector() == expected);
+    result = sparse;
+    result &= sixes;
+    BOOST_CHECK(result.toVector() == expected);
+
+    // array and array
+    util::RoaringBitmap other;
+    other.add(7);
+    other.add(300000);
+    result = sparse;
+    result &= other;
+    expected.clear();
+    expected.push_back(7);
+    expected.push_back(300000);
+    BOOST_CHECK(result.toVector() == expected);
+
+    result &= util::RoaringBitmap();
+    BOOST_CHECK(result.empty());
+  }
+
+  BOOST_AUTO_TEST_CASE(RoaringBitmapIntersectionCardinality)
+  {
+    util::RoaringBitmap evens, threes, sparse;
+    for (uint32_t i = 0; i < 200000; ++i) {
+      if (i % 2 == 0) {
+        evens.add(i);
+      }
+      if (i % 3 == 0) {
+        threes.add(i);
+      }
+    }
+    sparse.add(6);
+    sparse.add(7);
+    sparse.add(150000);
+    sparse.add(300000);
+
+    BOOST_CHECK_EQUAL(evens.intersectionCardinality(threes), 200000 / 6 + 1);
+    BOOST_CHECK_EQUAL(evens.intersectionCardinality(sparse), 2);
+    BOOST_CHECK_EQUAL(sparse.intersectionCardinality(threes), 2);
+    BOOST_CHECK_EQUAL(sparse.intersectionCardinality(sparse), 4);
+    BOOST_CHECK_EQUAL(sparse.intersectionCardinality(util::RoaringBitmap()), 0);
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
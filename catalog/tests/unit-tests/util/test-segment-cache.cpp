@@ -0,0 +1,146 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/segment-cache.hpp"
+#include "boost-test.hpp"
+
+#include <ndn-cxx/security/key-chain.hpp>
+
+namespace atmos{
+namespace tests{
+
+  class SegmentCacheFixture
+  {
+  protected:
+    ndn::Data
+    makeSegment(const std::string& prefix, uint64_t segmentNo, size_t payloadSize = 1000)
+    {
+      ndn::Data data(ndn::Name(prefix).appendSegment(segmentNo));
+      std::vector<uint8_t> payload(payloadSize, 'a');
+      data.setContent(payload.data(), payload.size());
+      keyChain.signWithSha256(data);
+      return data;
+    }
+
+  protected:
+    ndn::KeyChain keyChain;
+  };
+
+  BOOST_FIXTURE_TEST_SUITE(SegmentCacheTestSuite, SegmentCacheFixture)
+
+  BOOST_AUTO_TEST_CASE(SegmentCacheFind)
+  {
+    util::SegmentCache cache(1024 * 1024);
+    cache.insert(makeSegment("/test/query-results/v1", 0));
+    cache.insert(makeSegment("/test/query-results/v1", 1));
+
+    auto data = cache.find(ndn::Name("/test/query-results/v1").appendSegment(1));
+    BOOST_REQUIRE(data);
+    BOOST_CHECK_EQUAL(data->getName(), ndn::Name("/test/query-results/v1").appendSegment(1));
+    // a prefix finds the first segment under it
+    data = cache.find(ndn::Interest(ndn::Name("/test/query-results")));
+    BOOST_REQUIRE(data);
+    BOOST_CHECK_EQUAL(data->getName(), ndn::Name("/test/query-results/v1").appendSegment(0));
+    BOOST_CHECK(!cache.find(ndn::Name("/test/query-results/v2")));
+
+    BOOST_CHECK_EQUAL(cache.size(), 2);
+    BOOST_CHECK_EQUAL(cache.getNHits(), 2);
+    BOOST_CHECK_EQUAL(cache.getNMisses(), 1);
+
+    cache.erase(ndn::Name("/test/query-results/v1").appendSegment(0));
+    BOOST_CHECK_EQUAL(cache.size(), 1);
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentCacheByteBudget)
+  {
+    const size_t maxSize = 64 * 1024;
+    util::SegmentCache cache(maxSize);
+    for (uint64_t i = 0; i < 500; ++i) {
+      cache.insert(makeSegment("/test/query-results/v1", i));
+      BOOST_CHECK_LE(cache.getUsedSize(), maxSize);
+    }
+    BOOST_CHECK_LT(cache.size(), 500);
+    BOOST_CHECK_GT(cache.getNEvictions() + cache.getNRejections(), 0);
+
+    // a segment larger than the whole cache is not kept
+    cache.insert(makeSegment("/test/query-results/v2", 0, 2 * maxSize));
+    BOOST_CHECK(!cache.find(ndn::Name("/test/query-results/v2")));
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentCacheScanResistance)
+  {
+    const size_t maxSize = 1024 * 1024;
+    util::SegmentCache cache(maxSize);
+
+    // popular autocomplete results
+    for (uint64_t i = 0; i < 10; ++i) {
+      cache.insert(makeSegment("/test/query-results/hot", i, 7000));
+    }
+    for (int round = 0; round < 5; ++round) {
+      for (uint64_t i = 0; i < 10; ++i) {
+        BOOST_CHECK(cache.find(ndn::Name("/test/query-results/hot").appendSegment(i)));
+      }
+    }
+
+    // a bulk query that is read once
+    for (uint64_t i = 0; i < 1000; ++i) {
+      const ndn::Data data = makeSegment("/test/query-results/bulk", i, 7000);
+      cache.insert(data);
+      cache.find(data.getName());
+    }
+
+    for (uint64_t i = 0; i < 10; ++i) {
+      BOOST_CHECK(cache.find(ndn::Name("/test/query-results/hot").appendSegment(i)));
+    }
+    BOOST_CHECK_GT(cache.getNRejections(), 0);
+  }
+
+  BOOST_AUTO_TEST_CASE(SegmentCacheLargeResult)
+  {
+    const size_t maxSize = 1024 * 1024;
+    util::SegmentCache cache(maxSize);
+
+    // results that have been read fill the main area
+    for (uint64_t i = 0; i < 200; ++i) {
+      const ndn::Data data = makeSegment("/test/query-results/read", i, 7000);
+      cache.insert(data);
+      cache.find(data.getName());
+    }
+
+    // an eager result three times the window is inserted before its first Interest
+    const uint64_t nSegments = 40;
+    for (uint64_t i = 0; i < nSegments; ++i) {
+      cache.insert(makeSegment("/test/query-results/large", i, 7000));
+      BOOST_CHECK_LE(cache.getUsedSize(), maxSize);
+    }
+    for (uint64_t i = 0; i < nSegments; ++i) {
+      BOOST_CHECK(cache.find(ndn::Name("/test/query-results/large").appendSegment(i)));
+    }
+
+    // results that are never fetched only take up part of the budget
+    for (uint64_t i = 0; i < 1000; ++i) {
+      cache.insert(makeSegment("/test/query-results/abandoned", i, 7000));
+      BOOST_CHECK_LE(cache.getUsedSize(), maxSize);
+    }
+    BOOST_CHECK(cache.find(ndn::Name("/test/query-results/large").appendSegment(0)));
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
@@ -0,0 +1,103 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "util/thread-pool.hpp"
+#include "boost-test.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
+namespace atmos{
+namespace tests{
+
+  BOOST_AUTO_TEST_SUITE(ThreadPoolTestSuite)
+
+  BOOST_AUTO_TEST_CASE(ThreadPoolRunsTasksConcurrently)
+  {
+    util::ThreadPool pool(2, 10);
+    BOOST_CHECK_EQUAL(pool.getNThreads(), 2);
+
+    // both tasks must be running at the same time to get past the barrier
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t nArrived = 0;
+    std::set<std::thread::id> threadIds;
+    auto task = [&] {
+      std::unique_lock<std::mutex> lock(mutex);
+      threadIds.insert(std::this_thread::get_id());
+      ++nArrived;
+      cv.notify_all();
+      cv.wait_for(lock, std::chrono::seconds(5), [&] { return nArrived == 2; });
+    };
+    BOOST_CHECK(pool.submit(task));
+    BOOST_CHECK(pool.submit(task));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    BOOST_CHECK(cv.wait_for(lock, std::chrono::seconds(5), [&] { return nArrived == 2; }));
+    BOOST_CHECK_EQUAL(threadIds.size(), 2);
+  }
+
+  BOOST_AUTO_TEST_CASE(ThreadPoolBoundedQueue)
+  {
+    util::ThreadPool pool(1, 1);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool isStarted = false;
+    bool isReleased = false;
+    std::atomic<int> nRuns(0);
+
+    // occupy the only worker
+    BOOST_CHECK(pool.submit([&] {
+      std::unique_lock<std::mutex> lock(mutex);
+      isStarted = true;
+      cv.notify_all();
+      cv.wait(lock, [&] { return isReleased; });
+      ++nRuns;
+    }));
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return isStarted; });
+    }
+
+    BOOST_CHECK(pool.submit([&] { ++nRuns; }));
+    BOOST_CHECK_EQUAL(pool.getQueueSize(), 1);
+    BOOST_CHECK(!pool.submit([&] { ++nRuns; }));
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      isReleased = true;
+    }
+    cv.notify_all();
+
+    for (int i = 0; i < 500 && nRuns != 2; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(nRuns, 2);
+
+    pool.stop();
+    BOOST_CHECK(!pool.submit([&] { ++nRuns; }));
+  }
+
+  BOOST_AUTO_TEST_SUITE_END()
+
+}//tests
+}//atmos
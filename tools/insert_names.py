@@ -45,7 +45,9 @@ def createTables(cursor):
     "  `variable_name` varchar(100) NOT NULL,"
     "  `ensemble` varchar(100) NOT NULL,"
     "  `time` varchar(100) NOT NULL,"
-    "  PRIMARY KEY (`id`)"
+    "  PRIMARY KEY (`id`),"
+    #prefix of the name, since an index key must be <767 bytes too
+    "  KEY `name` (`name`(255))"
     ") ENGINE=InnoDB")
 
   #check if tables exist, if not create them
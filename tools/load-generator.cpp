@@ -0,0 +1,660 @@
+/** NDN-Atmos: Cataloging Service for distributed data originally developed
+ *  for atmospheric science data
+ *  Copyright (C) 2015 Colorado State University
+ *
+ *  NDN-Atmos is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  NDN-Atmos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with NDN-Atmos.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include <ndn-cxx/face.hpp>
+#include <ndn-cxx/util/scheduler.hpp>
+#include <json/value.h>
+#include <json/writer.h>
+#include <json/reader.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <getopt.h>
+
+void
+usage(const char* fileName)
+{
+  std::cout << "\n Usage:\n " << fileName <<
+    " [-p catalogPrefix] [-f workload file] [-a share] [-r rate | -c concurrency]\n"
+    "   [-d seconds] [-n queries] [-w window] [-l lifetime] [-m retries] [-s seed] [-j] [-h]\n"
+    "   [-p catalogPrefix]  - set the catalog prefix, default /catalog/myUniqueName\n"
+    "   [-f workload file]  - replay the queries of the file in order, one JSON filter per line.\n"
+    "                         Lines that start with \"facets \" are sent as facets queries and\n"
+    "                         empty lines and lines that start with '#' are skipped. Without\n"
+    "                         it, a synthetic mix of component and autocomplete queries is sent\n"
+    "   [-a share]          - set the share of autocomplete queries in the mix, default 0.3\n"
+    "   [-r rate]           - start that many queries per second, whether or not earlier ones\n"
+    "                         are done (open loop)\n"
+    "   [-c concurrency]    - keep that many queries running at all times (closed loop),\n"
+    "                         default 1. With -r, the most queries that may run at a time\n"
+    "   [-d seconds]        - set how long queries are started for, default 10\n"
+    "   [-n queries]        - stop after starting that many queries instead\n"
+    "   [-w window]         - set the number of result segments fetched at a time, default 8\n"
+    "   [-l lifetime]       - set the Interest lifetime in milliseconds, default 1000\n"
+    "   [-m retries]        - set how many times an Interest is sent again after a timeout,\n"
+    "                         default 3\n"
+    "   [-s seed]           - set the seed of the synthetic mix, default 1\n"
+    "   [-j]                - print the report as JSON\n"
+    "   [-h]                - print help and exit\n"
+    "\n";
+}
+
+namespace ndn {
+namespace atmos {
+
+/**
+ * Sends queries to a catalog, fetches all segments of their results and reports the latency
+ * of the ACK and of the full result. The latency of a query that is sent again after a timeout
+ * counts from its first Interest.
+ */
+class LoadGenerator : noncopyable
+{
+public:
+  LoadGenerator()
+    : m_catalogPrefix("/catalog/myUniqueName")
+    , m_autocompleteShare(0.3)
+    , m_rate(0)
+    , m_concurrency(1)
+    , m_duration(10)
+    , m_maxQueries(0)
+    , m_window(8)
+    , m_interestLifetime(1000)
+    , m_maxRetries(3)
+    , m_seed(1)
+    , m_printJson(false)
+    , m_scheduler(m_face.getIoService())
+    , m_isIssuing(false)
+    , m_nextQuery(0)
+    , m_nStarted(0)
+    , m_nOutstanding(0)
+    , m_nCompleted(0)
+    , m_nFailed(0)
+    , m_nSkipped(0)
+    , m_nTimeouts(0)
+    , m_nRetransmissions(0)
+    , m_nSegments(0)
+    , m_nBytes(0)
+  {
+  }
+
+  void
+  run()
+  {
+    if (!m_workloadFile.empty()) {
+      loadWorkload();
+    }
+    m_random.seed(m_seed);
+
+    m_isIssuing = true;
+    m_start = time::steady_clock::now();
+    m_issueEnd = m_start;
+    m_lastCompletion = m_start;
+    if (m_maxQueries == 0) {
+      m_scheduler.scheduleEvent(time::seconds(m_duration), bind(&LoadGenerator::stopIssuing, this));
+    }
+    if (m_rate > 0) {
+      tick(0);
+    }
+    else {
+      for (size_t i = 0; i < m_concurrency && canIssue(); ++i) {
+        startQuery();
+      }
+    }
+
+    m_face.processEvents();
+    report();
+  }
+
+private:
+  struct Query
+  {
+    std::string filter;
+    bool isFacets;
+  };
+
+  struct Execution
+  {
+    Execution()
+      : nSegments(0)
+      , nextSegment(0)
+      , nReceived(0)
+      , nInFlight(0)
+      , nBytes(0)
+      , isDone(false)
+    {
+    }
+
+    time::steady_clock::TimePoint start;
+    Name resultPrefix;
+    // 0 until the final segment has been seen
+    uint64_t nSegments;
+    uint64_t nextSegment;
+    uint64_t nReceived;
+    size_t nInFlight;
+    uint64_t nBytes;
+    bool isDone;
+  };
+
+  typedef std::function<void(const Data&)> DataCallback;
+  typedef std::function<void()> TimeoutCallback;
+
+  void
+  loadWorkload()
+  {
+    std::ifstream file(m_workloadFile);
+    if (!file) {
+      throw std::runtime_error("cannot open " + m_workloadFile);
+    }
+    Json::Reader reader;
+    Json::FastWriter fastWriter;
+    std::string line;
+    for (size_t lineNo = 1; std::getline(file, line); ++lineNo) {
+      line.erase(0, line.find_first_not_of(" \t\r"));
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      Query query;
+      query.isFacets = line.compare(0, 7, "facets ") == 0;
+      Json::Value filter;
+      if (!reader.parse(line.substr(query.isFacets ? 7 : 0), filter) || !filter.isObject()) {
+        throw std::runtime_error(m_workloadFile + ":" + std::to_string(lineNo) +
+                                 ": not a JSON object");
+      }
+      query.filter = fastWriter.write(filter);
+      // FastWriter ends the document with a newline
+      query.filter.erase(query.filter.size() - 1);
+      m_workload.push_back(query);
+    }
+    if (m_workload.empty()) {
+      throw std::runtime_error(m_workloadFile + " has no queries");
+    }
+  }
+
+  /**
+   * Helper function that makes a query of the synthetic mix. The names of the CMIP5 datasets
+   * have a component per facet, so a component query constrains the first facets and an
+   * autocomplete query asks for the components under the first few of them.
+   */
+  Query
+  makeSyntheticQuery()
+  {
+    static const std::vector<std::pair<std::string, std::vector<std::string>>> FACETS = {
+      {"activity", {"CMIP5"}},
+      {"product", {"output1", "output2"}},
+      {"organization", {"NCAR", "NOAA-GFDL", "MOHC", "IPSL", "MPI-M", "CSIRO-BOM"}},
+      {"model", {"CCSM4", "GFDL-CM3", "HadGEM2-ES", "IPSL-CM5A-LR", "MPI-ESM-LR", "ACCESS1-0"}},
+      {"experiment", {"historical", "rcp45", "rcp85", "piControl"}},
+      {"frequency", {"mon", "day", "6hr"}},
+      {"modeling_realm", {"atmos", "ocean", "land"}},
+      {"ensemble", {"r1i1p1", "r2i1p1", "r3i1p1"}},
+    };
+
+    Query query;
+    query.isFacets = false;
+    Json::Value filter(Json::objectValue);
+    if (std::uniform_real_distribution<double>(0, 1)(m_random) < m_autocompleteShare) {
+      const size_t depth = std::uniform_int_distribution<size_t>(0, 4)(m_random);
+      std::string prefix("/");
+      for (size_t i = 0; i < depth; ++i) {
+        const std::vector<std::string>& values = FACETS[i].second;
+        prefix += values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(m_random)];
+        prefix += "/";
+      }
+      filter["?"] = prefix;
+    }
+    else {
+      const size_t depth = std::uniform_int_distribution<size_t>(1, FACETS.size())(m_random);
+      for (size_t i = 0; i < depth; ++i) {
+        const std::vector<std::string>& values = FACETS[i].second;
+        filter[FACETS[i].first]
+          = values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(m_random)];
+      }
+    }
+    Json::FastWriter fastWriter;
+    query.filter = fastWriter.write(filter);
+    query.filter.erase(query.filter.size() - 1);
+    return query;
+  }
+
+  bool
+  canIssue()
+  {
+    if (m_isIssuing && m_maxQueries != 0 && m_nStarted >= m_maxQueries) {
+      stopIssuing();
+    }
+    return m_isIssuing;
+  }
+
+  void
+  stopIssuing()
+  {
+    if (!m_isIssuing) {
+      return;
+    }
+    m_isIssuing = false;
+    m_issueEnd = time::steady_clock::now();
+    if (m_nOutstanding == 0) {
+      m_face.getIoService().stop();
+      return;
+    }
+    // gives the queries that are still running the time to send all of their Interests again
+    m_scheduler.scheduleEvent(m_interestLifetime * (2 * (m_maxRetries + 1)),
+                              [this] { m_face.getIoService().stop(); });
+  }
+
+  void
+  tick(uint64_t nTicks)
+  {
+    if (!canIssue()) {
+      return;
+    }
+    // queries that would run over the concurrency limit are not started, so that a catalog
+    // that does not keep up is not buried under Interests
+    if (m_concurrency != 0 && m_nOutstanding >= m_concurrency) {
+      ++m_nSkipped;
+    }
+    else {
+      startQuery();
+    }
+
+    // scheduled from the start, so that the rate does not drift with the time spent in here
+    const time::nanoseconds period(static_cast<int64_t>(1e9 / m_rate));
+    const time::steady_clock::TimePoint next = m_start + period * static_cast<int64_t>(nTicks + 1);
+    const time::steady_clock::TimePoint now = time::steady_clock::now();
+    m_scheduler.scheduleEvent(next > now ? time::nanoseconds(next - now) : time::nanoseconds(0),
+                              bind(&LoadGenerator::tick, this, nTicks + 1));
+  }
+
+  void
+  startQuery()
+  {
+    Query query;
+    if (m_workload.empty()) {
+      query = makeSyntheticQuery();
+    }
+    else {
+      query = m_workload[m_nextQuery];
+      m_nextQuery = (m_nextQuery + 1) % m_workload.size();
+    }
+
+    ++m_nStarted;
+    ++m_nOutstanding;
+    std::shared_ptr<Execution> execution = std::make_shared<Execution>();
+    execution->start = time::steady_clock::now();
+
+    Name name(m_catalogPrefix);
+    name.append(query.isFacets ? "facets" : "query");
+    name.append(name::Component(reinterpret_cast<const uint8_t*>(query.filter.data()),
+                                query.filter.size()));
+    sendQuery(execution, name, m_maxRetries);
+  }
+
+  void
+  sendQuery(const std::shared_ptr<Execution>& execution, const Name& name, size_t nRetries)
+  {
+    // the catalog does not answer a query it is still running, so waiting ones are sent again
+    express(name, true,
+            [this, execution] (const Data& ack) { onAck(execution, ack); },
+            [this, execution, name, nRetries] {
+              if (nRetries > 0) {
+                ++m_nRetransmissions;
+                sendQuery(execution, name, nRetries - 1);
+              }
+              else {
+                ++m_nTimeouts;
+                finish(execution, false);
+              }
+            });
+  }
+
+  void
+  onAck(const std::shared_ptr<Execution>& execution, const Data& ack)
+  {
+    // The ACK is named <query Interest>/<version>/OK
+    const Name& ackName = ack.getName();
+    if (ackName.size() < 2 || ackName[-1] != name::Component("OK")) {
+      finish(execution, false);
+      return;
+    }
+    m_ackLatencies.push_back(getMicroseconds(execution->start));
+
+    execution->resultPrefix = Name(m_catalogPrefix).append("query-results").append(ackName[-2]);
+    // the first segment tells whether there are more, before any other is asked for
+    execution->nextSegment = 1;
+    ++execution->nInFlight;
+    fetchSegment(execution, 0, m_maxRetries);
+  }
+
+  void
+  fetchSegment(const std::shared_ptr<Execution>& execution, uint64_t segmentNo, size_t nRetries)
+  {
+    // results are published while they are fetched, so segments that are not there yet are
+    // asked for again
+    express(Name(execution->resultPrefix).appendSegment(segmentNo), false,
+            [this, execution] (const Data& segment) { onSegment(execution, segment); },
+            [this, execution, segmentNo, nRetries] {
+              if (execution->isDone ||
+                  (execution->nSegments != 0 && segmentNo >= execution->nSegments)) {
+                // asked for beyond the final segment
+                --execution->nInFlight;
+              }
+              else if (nRetries > 0) {
+                ++m_nRetransmissions;
+                fetchSegment(execution, segmentNo, nRetries - 1);
+              }
+              else {
+                --execution->nInFlight;
+                ++m_nTimeouts;
+                finish(execution, false);
+              }
+            });
+  }
+
+  void
+  onSegment(const std::shared_ptr<Execution>& execution, const Data& segment)
+  {
+    --execution->nInFlight;
+    if (execution->isDone) {
+      return;
+    }
+    ++execution->nReceived;
+    execution->nBytes += segment.getContent().value_size();
+    ++m_nSegments;
+
+    const name::Component& finalBlockId = segment.getFinalBlockId();
+    if (!finalBlockId.empty()) {
+      try {
+        execution->nSegments = finalBlockId.toSegment() + 1;
+      }
+      catch (const name::Component::Error&) {
+        finish(execution, false);
+        return;
+      }
+    }
+    if (execution->nSegments != 0 && execution->nReceived >= execution->nSegments) {
+      finish(execution, true);
+      return;
+    }
+
+    while (execution->nInFlight < m_window &&
+           (execution->nSegments == 0 || execution->nextSegment < execution->nSegments)) {
+      ++execution->nInFlight;
+      fetchSegment(execution, execution->nextSegment++, m_maxRetries);
+    }
+  }
+
+  void
+  finish(const std::shared_ptr<Execution>& execution, bool isCompleted)
+  {
+    if (execution->isDone) {
+      return;
+    }
+    execution->isDone = true;
+    --m_nOutstanding;
+    if (isCompleted) {
+      ++m_nCompleted;
+      m_nBytes += execution->nBytes;
+      m_resultLatencies.push_back(getMicroseconds(execution->start));
+      m_lastCompletion = time::steady_clock::now();
+    }
+    else {
+      ++m_nFailed;
+    }
+
+    if (m_rate == 0 && canIssue()) {
+      startQuery();
+    }
+    else if (!m_isIssuing && m_nOutstanding == 0) {
+      m_face.getIoService().stop();
+    }
+  }
+
+  void
+  express(const Name& name, bool mustBeFresh,
+          const DataCallback& onData, const TimeoutCallback& onTimeout)
+  {
+    // a new Interest each time, so that one sent again gets a new nonce
+    Interest interest(name);
+    interest.setInterestLifetime(m_interestLifetime);
+    interest.setMustBeFresh(mustBeFresh);
+    m_face.expressInterest(interest,
+                           [onData] (const Interest&, const Data& data) { onData(data); },
+                           [onTimeout] (const Interest&) { onTimeout(); });
+  }
+
+  static int64_t
+  getMicroseconds(const time::steady_clock::TimePoint& start)
+  {
+    return time::duration_cast<time::microseconds>(time::steady_clock::now() - start).count();
+  }
+
+  /**
+   * Helper function that gets the latency in milliseconds that the given share of the sorted
+   * latencies does not exceed
+   */
+  static double
+  getPercentile(const std::vector<int64_t>& sortedLatencies, double share)
+  {
+    if (sortedLatencies.empty()) {
+      return 0;
+    }
+    const size_t rank = static_cast<size_t>(std::ceil(share * sortedLatencies.size()));
+    return sortedLatencies[std::min(std::max<size_t>(rank, 1), sortedLatencies.size()) - 1] / 1e3;
+  }
+
+  static Json::Value
+  summarize(std::vector<int64_t>& latencies)
+  {
+    std::sort(latencies.begin(), latencies.end());
+    Json::Value summary;
+    summary["count"] = static_cast<Json::UInt64>(latencies.size());
+    summary["p50Ms"] = getPercentile(latencies, 0.5);
+    summary["p90Ms"] = getPercentile(latencies, 0.9);
+    summary["p99Ms"] = getPercentile(latencies, 0.99);
+    summary["p999Ms"] = getPercentile(latencies, 0.999);
+    summary["maxMs"] = getPercentile(latencies, 1);
+    return summary;
+  }
+
+  void
+  report()
+  {
+    if (m_isIssuing) {
+      m_issueEnd = time::steady_clock::now();
+    }
+    // throughput is measured until the last result, which may come after the last query starts
+    const double issueSeconds = time::duration_cast<time::microseconds>(m_issueEnd -
+                                                                        m_start).count() / 1e6;
+    const double seconds = time::duration_cast<time::microseconds>(
+                             std::max(m_lastCompletion, m_issueEnd) - m_start).count() / 1e6;
+
+    Json::Value report;
+    report["started"] = static_cast<Json::UInt64>(m_nStarted);
+    report["completed"] = static_cast<Json::UInt64>(m_nCompleted);
+    report["failed"] = static_cast<Json::UInt64>(m_nFailed);
+    report["unfinished"] = static_cast<Json::UInt64>(m_nOutstanding);
+    report["skipped"] = static_cast<Json::UInt64>(m_nSkipped);
+    report["timeouts"] = static_cast<Json::UInt64>(m_nTimeouts);
+    report["retransmissions"] = static_cast<Json::UInt64>(m_nRetransmissions);
+    report["segments"] = static_cast<Json::UInt64>(m_nSegments);
+    report["bytes"] = static_cast<Json::UInt64>(m_nBytes);
+    report["seconds"] = seconds;
+    report["offeredPerSecond"] = issueSeconds > 0 ? m_nStarted / issueSeconds : 0;
+    report["queriesPerSecond"] = seconds > 0 ? m_nCompleted / seconds : 0;
+    report["segmentsPerSecond"] = seconds > 0 ? m_nSegments / seconds : 0;
+    report["bytesPerSecond"] = seconds > 0 ? m_nBytes / seconds : 0;
+    report["ack"] = summarize(m_ackLatencies);
+    report["result"] = summarize(m_resultLatencies);
+
+    if (m_printJson) {
+      Json::FastWriter fastWriter;
+      std::cout << fastWriter.write(report);
+      return;
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "queries:    " << m_nStarted << " started, " << m_nCompleted << " completed, "
+              << m_nFailed << " failed, " << m_nOutstanding << " unfinished, "
+              << m_nSkipped << " skipped\n"
+              << "interests:  " << m_nTimeouts << " timed out, "
+              << m_nRetransmissions << " sent again\n"
+              << "throughput: " << report["queriesPerSecond"].asDouble() << " queries/s ("
+              << report["offeredPerSecond"].asDouble() << " offered), "
+              << report["segmentsPerSecond"].asDouble() << " segments/s, "
+              << report["bytesPerSecond"].asDouble() / 1e6 << " MB/s over "
+              << seconds << " s\n"
+              << std::setprecision(3);
+    for (const char* latency : {"ack", "result"}) {
+      const Json::Value& summary = report[latency];
+      std::cout << std::left << std::setw(12) << (std::string(latency) + " (ms):")
+                << std::right << "p50 " << summary["p50Ms"].asDouble()
+                << "  p90 " << summary["p90Ms"].asDouble()
+                << "  p99 " << summary["p99Ms"].asDouble()
+                << "  p999 " << summary["p999Ms"].asDouble()
+                << "  max " << summary["maxMs"].asDouble()
+                << "  (" << summary["count"].asUInt64() << ")\n";
+    }
+  }
+
+public:
+  Name m_catalogPrefix;
+  std::string m_workloadFile;
+  double m_autocompleteShare;
+  double m_rate;
+  size_t m_concurrency;
+  uint64_t m_duration;
+  uint64_t m_maxQueries;
+  size_t m_window;
+  time::milliseconds m_interestLifetime;
+  size_t m_maxRetries;
+  uint32_t m_seed;
+  bool m_printJson;
+
+private:
+  Face m_face;
+  util::scheduler::Scheduler m_scheduler;
+  std::vector<Query> m_workload;
+  std::mt19937 m_random;
+
+  bool m_isIssuing;
+  size_t m_nextQuery;
+  time::steady_clock::TimePoint m_start;
+  time::steady_clock::TimePoint m_issueEnd;
+  time::steady_clock::TimePoint m_lastCompletion;
+
+  uint64_t m_nStarted;
+  uint64_t m_nOutstanding;
+  uint64_t m_nCompleted;
+  uint64_t m_nFailed;
+  uint64_t m_nSkipped;
+  uint64_t m_nTimeouts;
+  uint64_t m_nRetransmissions;
+  uint64_t m_nSegments;
+  uint64_t m_nBytes;
+  // in microseconds
+  std::vector<int64_t> m_ackLatencies;
+  std::vector<int64_t> m_resultLatencies;
+};
+
+} // namespace atmos
+} // namespace ndn
+
+int
+main(int argc, char** argv)
+{
+  ndn::atmos::LoadGenerator generator;
+  bool hasRate = false;
+  bool hasConcurrency = false;
+  int option;
+
+  try {
+    while ((option = getopt(argc, argv, "p:f:a:r:c:d:n:w:l:m:s:jh")) != -1) {
+      switch (option) {
+        case 'p':
+          generator.m_catalogPrefix = ndn::Name(optarg);
+          break;
+        case 'f':
+          generator.m_workloadFile.assign(optarg);
+          break;
+        case 'a':
+          generator.m_autocompleteShare = std::stod(optarg);
+          break;
+        case 'r':
+          generator.m_rate = std::stod(optarg);
+          hasRate = true;
+          break;
+        case 'c':
+          generator.m_concurrency = std::stoul(optarg);
+          hasConcurrency = true;
+          break;
+        case 'd':
+          generator.m_duration = std::stoull(optarg);
+          break;
+        case 'n':
+          generator.m_maxQueries = std::stoull(optarg);
+          break;
+        case 'w':
+          generator.m_window = std::stoul(optarg);
+          break;
+        case 'l':
+          generator.m_interestLifetime = ndn::time::milliseconds(std::stoull(optarg));
+          break;
+        case 'm':
+          generator.m_maxRetries = std::stoul(optarg);
+          break;
+        case 's':
+          generator.m_seed = std::stoul(optarg);
+          break;
+        case 'j':
+          generator.m_printJson = true;
+          break;
+        case 'h':
+        default:
+          usage(argv[0]);
+          return 0;
+      }
+    }
+  }
+  catch (const std::logic_error&) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (optind != argc || (hasRate && generator.m_rate <= 0) || generator.m_concurrency == 0 ||
+      generator.m_window == 0 || (generator.m_maxQueries == 0 && generator.m_duration == 0)) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (hasRate && !hasConcurrency) {
+    // without a limit, the queries that are running are only bounded by the rate
+    generator.m_concurrency = 0;
+  }
+
+  try {
+    generator.run();
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}